@@ -167,7 +167,8 @@ bool Assembler::is_opcode(uint8_t candidate)
 
 int Assembler::get_integer_value(std::string value) {
 	// if the string begins with a prefix to denote its base (i.e. $ or %), convert it
-	// else, just use std::stoi to convert the integer
+	// else, just use std::stoll to convert the integer
+	// the values are read as 64-bit integers so that a 32-bit word with its high bit set (e.g. $FFFFFFFF) is accepted; the result has the same bits as the word
 
 	// Note: the immediate value prefix (#) may be passed into the function, but should be handled BEFORE passing the value; this function will not return the addressing mode desired
 	
@@ -182,20 +183,20 @@ int Assembler::get_integer_value(std::string value) {
 		if (!isdigit(value[0])) {
 			if (value[0] == '$') {
 				value = value.substr(1);	// get the digits only (substring starting at value[1])
-				return std::stoi(value, nullptr, 16);	// return the string interpreted as a base 16 number
+				return (int)std::stoll(value, nullptr, 16);	// return the string interpreted as a base 16 number
 			}
 			else if (value[0] == '%') {
 				value = value.substr(1);	// get the digits only (substring starting at value[1])
-				return std::stoi(value, nullptr, 2);	// return the string interpreted as a base 2 number
+				return (int)std::stoll(value, nullptr, 2);	// return the string interpreted as a base 2 number
 			}
 			// if it's not $ or %, it's not a valid operator; throw an exception
 			else {
 				throw AssemblerException("The character '" + std::to_string(value[0]) + "' is not a valid value operator. Options are $ (hex) or % (binary).");
 			}
 		}
-		// if it is a digit, then just use stoi and return the value
+		// if it is a digit, then just use stoll and return the value
 		else {
-			return std::stoi(value);
+			return (int)std::stoll(value);
 		}
 	}
 	else {
@@ -102,7 +102,6 @@ class Assembler
 
 	// get the opcode/mnemonic
 	static uint8_t get_opcode(std::string mnemonic);
-	static std::string get_mnemonic(uint8_t opcode);
 	static uint8_t get_addressing_mode(std::string value, std::string offset="");
 
 	// TODO: write more assembler-related functions as needed
@@ -122,6 +121,9 @@ public:
 	// take a .sinc file and return a .sina file containing the disassembled file
 	void disassemble(std::istream& sinc_file, std::string output_file_name);
 
+	// get the mnemonic for an opcode; public so that the VM's profiler can disassemble the instructions it reports
+	static std::string get_mnemonic(uint8_t opcode);
+
 	// class constructor/destructor
 	Assembler(std::istream& asm_file, uint8_t _WORDSIZE=16);
 	~Assembler();
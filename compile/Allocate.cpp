@@ -373,23 +373,14 @@ std::stringstream Compiler::define_global_constant(Symbol* to_allocate, unsigned
 						if (to_allocate->type_information.get_primary() == STRING) {
 							/*
 
-							To allocate a string constant, we must fetch the value and then utilize memcpy to copy the data from our old location to the new one.
+							To allocate a string constant, we must fetch the value and then use MOVM to copy the data from our old location to the new one.
 
-							Usage for memcpy is as follows:
-								- Push source
-								- Push destination
-								- Push number of bytes to copy
-
-							After fetch_value is called, A will contain the number of _bytes_, B will contain the address of the string
+							MOVM copies A bytes from the address in B to the address in X. After fetch_value is called, A will already contain the number of _bytes_ and B the address of the string, so we only need the destination
 
 							*/
 
 							def_const_ss << this->fetch_value(initial_value, line_number, max_offset).str();
-							def_const_ss << this->move_sp_to_target_address(max_offset, true).str();	// increment the stack pointer to our stack frame, but preserve our register values
-
-							// push our parameters and invoke our memcpy subroutine
-							def_const_ss << "\t" << "phb" << "\n\t" << "loadb #" << to_allocate->name << "\n\t" << "phb" << "\n\t" << "pha" << std::endl;
-							def_const_ss << "\t" << "jsr __builtins_memcpy" << std::endl;
+							def_const_ss << "\t" << "loadx #" << to_allocate->name << "\n\t" << "movm" << std::endl;
 						}
 						// todo: add initializer-lists for arrays
 						else {
@@ -0,0 +1,271 @@
+/*
+
+SIN Toolchain
+ArrayLoops.cpp
+Copyright 2019 Riley Lannon
+
+Contains Compiler::is_array_loop(...) and Compiler::array_loop(...), which compile while loops that do nothing but walk a pair of global int arrays with the vector instructions (VADD, VSUB, and VSUM) instead of one element at a time.
+
+Only two loop shapes are recognized, where 'i' is an int, 'n' an int literal, 'a' and 'b' global int arrays, 's' a global int, and 'op' either + or -:
+	while (i < n) {
+		let a[i] = a[i] op b[i];
+		let i = i + 1;
+	}
+and
+	while (i < n) {
+		let s = s + b[i];
+		let i = i + 1;
+	}
+For + the operands may also be the other way around. Anything else is compiled as an ordinary while loop by while_loop(...).
+VAND and VOR are not used because the compiler does not generate code for & and | yet; there is nothing in SIN that VCMP corresponds to.
+
+*/
+
+#include "Compiler.h"
+
+
+bool Compiler::is_array_variable(std::shared_ptr<Expression> to_check, std::string index_name)
+{
+	/*
+
+	Checks whether 'to_check' is an element of a global int array indexed by the variable 'index_name' (e.g., "a[i]")
+
+	*/
+
+	if (to_check->get_expression_type() != INDEXED) {
+		return false;
+	}
+
+	Indexed* element = dynamic_cast<Indexed*>(to_check.get());
+	std::shared_ptr<Expression> index = element->get_index_value();
+	if ((index->get_expression_type() != LVALUE) || (dynamic_cast<LValue*>(index.get())->getValue() != index_name)) {
+		return false;
+	}
+
+	// the array must be an int array that lives at its label, so that its elements can be addressed as '#name + 2 * i'
+	if (!this->symbol_table.is_in_symbol_table(element->getValue(), this->current_scope_name)) {
+		return false;
+	}
+	std::shared_ptr<Symbol> array_symbol = this->symbol_table.lookup(element->getValue(), this->current_scope_name, this->current_scope);
+
+	return (array_symbol->symbol_type == VARIABLE) && array_symbol->defined &&
+		(array_symbol->scope_name == "global") && (array_symbol->scope_level == 0) &&
+		(array_symbol->type_information.get_primary() == ARRAY) && (array_symbol->type_information.get_subtype() == INT) &&
+		!array_symbol->type_information.get_qualities().is_const() && !array_symbol->type_information.get_qualities().is_dynamic();
+}
+
+bool Compiler::is_scalar_variable(std::shared_ptr<Expression> to_check, bool must_be_global)
+{
+	/*
+
+	Checks whether 'to_check' is a defined, modifiable int variable; if 'must_be_global' is set, it must also be a global
+
+	*/
+
+	if (to_check->get_expression_type() != LVALUE) {
+		return false;
+	}
+
+	LValue* variable = dynamic_cast<LValue*>(to_check.get());
+	if (!this->symbol_table.is_in_symbol_table(variable->getValue(), this->current_scope_name)) {
+		return false;
+	}
+	std::shared_ptr<Symbol> variable_symbol = this->symbol_table.lookup(variable->getValue(), this->current_scope_name, this->current_scope);
+
+	if (must_be_global && ((variable_symbol->scope_name != "global") || (variable_symbol->scope_level != 0))) {
+		return false;
+	}
+
+	return (variable_symbol->symbol_type == VARIABLE) && variable_symbol->defined && (variable_symbol->type_information.get_primary() == INT) &&
+		!variable_symbol->type_information.get_qualities().is_const() && !variable_symbol->type_information.get_qualities().is_dynamic();
+}
+
+bool Compiler::is_array_loop(WhileLoop while_statement)
+{
+	/*
+
+	Checks whether the given while loop has one of the shapes that array_loop(...) can compile (see the top of this file)
+
+	*/
+
+	// the condition must be 'i < n', with a non-negative int literal for n
+	if (while_statement.get_condition()->get_expression_type() != BINARY) {
+		return false;
+	}
+	Binary* condition = dynamic_cast<Binary*>(while_statement.get_condition().get());
+	if ((condition->get_operator() != LESS) || !this->is_scalar_variable(condition->get_left()) || (condition->get_right()->get_expression_type() != LITERAL)) {
+		return false;
+	}
+	Literal* limit = dynamic_cast<Literal*>(condition->get_right().get());
+	if ((limit->get_data_type() != INT) || (std::stoi(limit->get_value()) < 0)) {
+		return false;
+	}
+	std::string index_name = dynamic_cast<LValue*>(condition->get_left().get())->getValue();
+
+	// the body must be exactly two assignments
+	std::vector<std::shared_ptr<Statement>>& body = while_statement.get_branch()->statements_list;
+	if ((body.size() != 2) || (body[0]->get_statement_type() != ASSIGNMENT) || (body[1]->get_statement_type() != ASSIGNMENT)) {
+		return false;
+	}
+
+	// the second must be 'i = i + 1' (or 'i = 1 + i')
+	Assignment* increment = dynamic_cast<Assignment*>(body[1].get());
+	if ((increment->get_lvalue()->get_expression_type() != LVALUE) || (dynamic_cast<LValue*>(increment->get_lvalue().get())->getValue() != index_name) ||
+		(increment->get_rvalue()->get_expression_type() != BINARY)) {
+		return false;
+	}
+	Binary* step = dynamic_cast<Binary*>(increment->get_rvalue().get());
+	std::shared_ptr<Expression> step_operands[2] = { step->get_left(), step->get_right() };
+	bool is_increment = false;
+	for (size_t i = 0; i < 2; i++) {
+		std::shared_ptr<Expression> variable = step_operands[i];
+		std::shared_ptr<Expression> amount = step_operands[1 - i];
+		if ((variable->get_expression_type() == LVALUE) && (dynamic_cast<LValue*>(variable.get())->getValue() == index_name) &&
+			(amount->get_expression_type() == LITERAL) && (dynamic_cast<Literal*>(amount.get())->get_data_type() == INT) &&
+			(std::stoi(dynamic_cast<Literal*>(amount.get())->get_value()) == 1)) {
+			is_increment = true;
+		}
+	}
+	if ((step->get_operator() != PLUS) || !is_increment) {
+		return false;
+	}
+
+	// the first must be 'a[i] = a[i] op b[i]' or 's = s + b[i]'
+	Assignment* element_assignment = dynamic_cast<Assignment*>(body[0].get());
+	if (element_assignment->get_rvalue()->get_expression_type() != BINARY) {
+		return false;
+	}
+	Binary* operation = dynamic_cast<Binary*>(element_assignment->get_rvalue().get());
+	exp_operator op = operation->get_operator();
+	std::shared_ptr<Expression> target = element_assignment->get_lvalue();
+
+	if (this->is_array_variable(target, index_name)) {
+		if ((op != PLUS) && (op != MINUS)) {
+			return false;
+		}
+
+		// the target array must be one of the operands -- the left one, unless it is an addition
+		std::string target_name = dynamic_cast<Indexed*>(target.get())->getValue();
+		std::shared_ptr<Expression> left = operation->get_left();
+		std::shared_ptr<Expression> right = operation->get_right();
+		if (!this->is_array_variable(left, index_name) || !this->is_array_variable(right, index_name)) {
+			return false;
+		}
+
+		return (dynamic_cast<Indexed*>(left.get())->getValue() == target_name) ||
+			((op == PLUS) && (dynamic_cast<Indexed*>(right.get())->getValue() == target_name));
+	}
+	else if (this->is_scalar_variable(target, true)) {
+		// a sum; the accumulator must be a global int other than the counter
+		std::string sum_name = dynamic_cast<LValue*>(target.get())->getValue();
+		if ((op != PLUS) || (sum_name == index_name)) {
+			return false;
+		}
+
+		std::shared_ptr<Expression> left = operation->get_left();
+		std::shared_ptr<Expression> right = operation->get_right();
+		return ((left->get_expression_type() == LVALUE) && (dynamic_cast<LValue*>(left.get())->getValue() == sum_name) && this->is_array_variable(right, index_name)) ||
+			((right->get_expression_type() == LVALUE) && (dynamic_cast<LValue*>(right.get())->getValue() == sum_name) && this->is_array_variable(left, index_name));
+	}
+	else {
+		return false;
+	}
+}
+
+std::stringstream Compiler::array_loop(WhileLoop while_statement, size_t max_offset)
+{
+	/*
+
+	Compiles a loop that is_array_loop(...) accepted. Rather than going around the loop n - i times, the generated code:
+		- evaluates the condition once, exactly as while_loop(...) would, and skips everything if it is false;
+		- gets i into Y and the number of elements left, n - i, into A;
+		- points X at a[i] and B at b[i] (the destination is always the array being assigned to);
+		- executes the vector instruction (for a sum, VSUM and then adds A to s);
+		- assigns n to i, which is where the loop would have left it.
+	Since the vector instructions act as if the words were done one at a time in ascending order, the result is the same as the ordinary loop's.
+
+	*/
+
+	std::stringstream array_loop_ss;
+
+	std::string while_label_name = "__" + this->current_scope_name + "_" + std::to_string(this->current_scope) + "__WHILE_" + std::to_string(this->branch_number) + "__";
+	this->branch_number += 1;
+
+	Binary* condition = dynamic_cast<Binary*>(while_statement.get_condition().get());
+	Literal* limit = dynamic_cast<Literal*>(condition->get_right().get());
+	std::string index_name = dynamic_cast<LValue*>(condition->get_left().get())->getValue();
+
+	Assignment* element_assignment = dynamic_cast<Assignment*>(while_statement.get_branch()->statements_list[0].get());
+	Binary* operation = dynamic_cast<Binary*>(element_assignment->get_rvalue().get());
+
+	// evaluate the condition; if it is false, the loop is never entered
+	array_loop_ss << while_label_name << ":" << std::endl;
+	array_loop_ss << this->evaluate_binary_tree(*condition, while_statement.get_line_number(), max_offset).str();
+	array_loop_ss << "\t" << "cmpa #$00" << std::endl;
+	array_loop_ss << "\t" << "breq " << while_label_name << ".done" << std::endl;
+	size_t condition_offset = this->stack_offset;	// where the SP is when we branch to .done
+
+	// get the index in Y and twice the index (the offset of the element in bytes) in A
+	array_loop_ss << this->fetch_value(condition->get_left(), while_statement.get_line_number(), max_offset).str();
+	array_loop_ss << "\t" << "tay" << std::endl;
+	array_loop_ss << "\t" << "lsl a" << std::endl;
+
+	if (element_assignment->get_lvalue()->get_expression_type() == INDEXED) {
+		// the destination is the array being assigned to; the source is whichever operand is not (or the right one, if both are the same array)
+		std::string destination_name = dynamic_cast<Indexed*>(element_assignment->get_lvalue().get())->getValue();
+		std::string source_name = dynamic_cast<Indexed*>(operation->get_right().get())->getValue();
+		if (dynamic_cast<Indexed*>(operation->get_left().get())->getValue() != destination_name) {
+			source_name = dynamic_cast<Indexed*>(operation->get_left().get())->getValue();
+		}
+
+		// X = #destination + 2i, B = #source + 2i
+		array_loop_ss << "\t" << "tab" << std::endl;
+		array_loop_ss << "\t" << "clc" << std::endl;
+		array_loop_ss << "\t" << "addca #" << destination_name << std::endl;
+		array_loop_ss << "\t" << "tax" << std::endl;
+		array_loop_ss << "\t" << "tba" << std::endl;
+		array_loop_ss << "\t" << "clc" << std::endl;
+		array_loop_ss << "\t" << "addca #" << source_name << std::endl;
+		array_loop_ss << "\t" << "tab" << std::endl;
+	}
+	else {
+		// B = #source + 2i; X is not used by VSUM
+		std::shared_ptr<Expression> element = (operation->get_left()->get_expression_type() == INDEXED) ? operation->get_left() : operation->get_right();
+		array_loop_ss << "\t" << "clc" << std::endl;
+		array_loop_ss << "\t" << "addca #" << dynamic_cast<Indexed*>(element.get())->getValue() << std::endl;
+		array_loop_ss << "\t" << "tab" << std::endl;
+	}
+
+	// A = n - i, computed as n + ~i + 1 so that B, X, and Y are left alone
+	array_loop_ss << "\t" << "tya" << std::endl;
+	array_loop_ss << "\t" << "xora #$FFFF" << std::endl;
+	array_loop_ss << "\t" << "sec" << std::endl;
+	array_loop_ss << "\t" << "addca #$" << std::hex << std::stoi(limit->get_value()) << std::endl;
+
+	if (element_assignment->get_lvalue()->get_expression_type() == INDEXED) {
+		if (operation->get_operator() == PLUS) {
+			array_loop_ss << "\t" << "vadd" << std::endl;
+		}
+		else {
+			array_loop_ss << "\t" << "vsub" << std::endl;
+		}
+	}
+	else {
+		std::string sum_name = dynamic_cast<LValue*>(element_assignment->get_lvalue().get())->getValue();
+		array_loop_ss << "\t" << "vsum" << std::endl;
+		array_loop_ss << "\t" << "clc" << std::endl;
+		array_loop_ss << "\t" << "addca " << sum_name << std::endl;
+		array_loop_ss << "\t" << "storea " << sum_name << std::endl;
+	}
+
+	// the loop would have finished with i = n
+	Assignment counter_assignment(LValue(index_name), condition->get_right());
+	counter_assignment.set_line_number(while_statement.get_line_number());
+	array_loop_ss << this->assign(counter_assignment, max_offset).str();
+
+	// both ways of getting to .done must leave the SP in the same place
+	array_loop_ss << this->move_sp_to_target_address(condition_offset).str();
+	array_loop_ss << while_label_name << ".done:" << std::endl;
+
+	return array_loop_ss;
+}
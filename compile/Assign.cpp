@@ -172,21 +172,14 @@ std::stringstream Compiler::string_assignment(Symbol* target_symbol, std::shared
 		string_assign_ss << "\t" << "loady #$00" << std::endl;
 		string_assign_ss << "\t" << "storea ($" << _LOCAL_DYNAMIC_POINTER << "), y" << std::endl;
 
-		// next, get the value of our pointer and increment by 2 for memcpy
+		// next, get the value of our pointer and increment by 2; this is the destination for MOVM, which goes in X
 		string_assign_ss << "\t" << "loada $" << _LOCAL_DYNAMIC_POINTER << std::endl;
 		string_assign_ss << "\t" << "clc" << std::endl;
 		string_assign_ss << "\t" << "addca #$02" << std::endl;
+		string_assign_ss << "\t" << "tax" << std::endl;
 
-		// the address of the string variable has already been pushed, so the next thing to push is the address of our destination
-		string_assign_ss << "\t" << "pha" << std::endl;
-		this->stack_offset += 1;
-		max_offset += 1;
-
-		// next, we need to push the length of the string, which we will get from our pointer variable
+		// the number of bytes to copy is the length of the string, which we will get from our pointer variable
 		string_assign_ss << "\t" << "loada ($" << _LOCAL_DYNAMIC_POINTER << "), y" << std::endl;
-		string_assign_ss << "\t" << "pha" << std::endl;
-		this->stack_offset += 1;
-		max_offset += 1;
 	}
 	else {
 		size_t previous_offset = this->stack_offset;	// we want to ensure that we know exactly where to return back to
@@ -241,27 +234,19 @@ std::stringstream Compiler::string_assignment(Symbol* target_symbol, std::shared
 		string_assign_ss << "\t" << "loady #$00" << std::endl;
 		string_assign_ss << "\t" << "storea ($" << std::hex << _LOCAL_DYNAMIC_POINTER << "), y" << std::endl;
 
-		// get the address of the dynamic memory and increment it by 2, for memcpy
+		// get the address of the dynamic memory and increment it by 2 for the destination, and load the length
 		string_assign_ss << "\t" << "loada $" << _LOCAL_DYNAMIC_POINTER << std::endl;
 		string_assign_ss << "\t" << "clc" << std::endl;
 		string_assign_ss << "\t" << "addca #$02" << std::endl;
-
-		// push the arguments to the stack
-		string_assign_ss << "\t" << "pha" << std::endl;
-		this->stack_offset += 1;
-		max_offset += 1;
+		string_assign_ss << "\t" << "tax" << std::endl;
 
 		string_assign_ss << "\t" << "loada ($" << std::hex << _LOCAL_DYNAMIC_POINTER << "), y" << std::endl;
-		string_assign_ss << "\t" << "pha" << std::endl;
-		this->stack_offset += 1;
-		max_offset += 1;
 	}
 
-	// finally, invoke the subroutine
-	string_assign_ss << "\t" << "jsr __builtins_memcpy" << std::endl;
-
-	// move the stack offset back -- the memcpy routine pulls thrice from the stack
-	this->stack_offset -= 3;
+	// finally, pull the address of the string we pushed at the start into B and copy it
+	string_assign_ss << "\t" << "plb" << std::endl;
+	this->stack_offset -= 1;
+	string_assign_ss << "\t" << "movm" << std::endl;
 
 	// reset the pointers we used for string assignment
 	string_assign_ss << "\t" << "loada #$00" << std::endl;
@@ -329,6 +329,11 @@ std::stringstream Compiler::while_loop(WhileLoop while_statement, size_t max_off
 
 	*/
 	
+	// a loop that only walks a pair of global arrays is done with a single vector instruction
+	if (this->is_array_loop(while_statement)) {
+		return this->array_loop(while_statement, max_offset);
+	}
+
 	std::stringstream while_ss;
 
 	std::string parent_scope_name = this->current_scope_name;
@@ -97,6 +97,12 @@ class Compiler
 
 	std::stringstream ite(IfThenElse ite_statement, size_t max_offset = 0);
 	std::stringstream while_loop(WhileLoop while_statement, size_t max_offset = 0);
+
+	// loops over whole global arrays that can use the vector instructions instead (see ArrayLoops.cpp)
+	bool is_array_variable(std::shared_ptr<Expression> to_check, std::string index_name);
+	bool is_scalar_variable(std::shared_ptr<Expression> to_check, bool must_be_global = false);
+	bool is_array_loop(WhileLoop while_statement);
+	std::stringstream array_loop(WhileLoop while_statement, size_t max_offset = 0);
 	std::stringstream return_value(ReturnStatement return_statement, size_t previous_offset, unsigned int line_number = 0);
 
 	std::stringstream compile_to_sinasm(StatementBlock AST, unsigned int local_scope_level, std::string local_scope_name = "global", size_t max_offset = 0, size_t stack_frame_base = 0);	// compiles SIN code and writes SINASM code to output_file; modifies the member's vector pointer to list the dependencies
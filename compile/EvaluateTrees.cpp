@@ -208,39 +208,27 @@ std::stringstream Compiler::evaluate_binary_tree(Binary bin_exp, unsigned int li
 
 			// if our left expression is binary, we don't need to do this -- the string data is already in the buffer from the evaluation of that tree
 			if (bin_exp.get_left()->get_expression_type() != BINARY) {
-				// copy the left argument into the string buffer
-				binary_ss << "\t" << "phb" << std::endl;	// push the source
-				binary_ss << "\t" << "loadb __INPUT_BUFFER_START_ADDR" << std::endl;	// get the destination and push it
-				binary_ss << "\t" << "phb" << std::endl;
-				binary_ss << "\t" << "pha" << std::endl;	// push the length
-
-				// call __builtins_memcpy
-				binary_ss << "\t" << "jsr __builtins_memcpy" << std::endl;
+				// copy the left argument into the string buffer; B already holds the source and A the length
+				binary_ss << "\t" << "loadx __INPUT_BUFFER_START_ADDR" << std::endl;	// get the destination
+				binary_ss << "\t" << "movm" << std::endl;
 			}
 
-			// load A with the length of the last string written and add the address of _STRING_BUFFER_START; this is our destination
+			// load A with the length of the last string written and add the address of _STRING_BUFFER_START; this is our destination, which goes in X
 			binary_ss << "\t" << "loada __INPUT_LEN" << std::endl;
 			binary_ss << "\t" << "clc" << std::endl;
 			binary_ss << "\t" << "addca __INPUT_BUFFER_START_ADDR" << std::endl;
+			binary_ss << "\t" << "tax" << std::endl;
 
-			// load B with the source address
+			// load B with the source address and A with the length, and copy the memory
 			binary_ss << "\t" << "loadb __TEMP_B" << std::endl;
-
-			// push the addresses -- B has the source, A has the destination
-			binary_ss << "\t" << "phb" << "\n\t" << "pha" << std::endl;
-
-			// push the length
 			binary_ss << "\t" << "loada __TEMP_A" << std::endl;
-			binary_ss << "\t" << "pha" << std::endl;
+			binary_ss << "\t" << "movm" << std::endl;
 
 			// add that length to the length of the other string, which is in __INPUT_LEN
 			binary_ss << "\t" << "clc" << std::endl;
 			binary_ss << "\t" << "addca __INPUT_LEN" << std::endl;
 			binary_ss << "\t" << "storea __INPUT_LEN" << std::endl;
 
-			// copy the memory
-			binary_ss << "\t" << "jsr __builtins_memcpy" << std::endl;
-
 			// we are done; the concatenated string is at the string buffer and __INPUT_LEN contains the new length
 			// all we need to do is load our A and B registers
 			binary_ss << "\t" << "loadb __INPUT_BUFFER_START_ADDR" << std::endl;
@@ -1,4 +1,7 @@
 #include "Linker.h"
+#include "../util/OpcodeConstants.h"
+#include "../util/AddressingModeConstants.h"
+#include "../util/SyscallConstants.h"
 
 
 
@@ -36,15 +39,160 @@ void Linker::get_metadata() {
 }
 
 
+size_t Linker::get_file_size(const SinObjectFile& file) {
+	size_t size = file.program_data.size();
+	for (std::list<std::tuple<std::string, size_t, std::vector<uint8_t>>>::const_iterator data_it = file.data_table.begin(); data_it != file.data_table.end(); data_it++) {
+		size += std::get<2>(*data_it).size();
+	}
+	return size;
+}
+
+size_t Linker::get_trampoline_size() {
+	// two syscalls and an RTS, with the bank and address in between
+	size_t wordsize_bytes = (size_t)this->_wordsize / 8;
+	return 2 * (2 + wordsize_bytes) + 2 * wordsize_bytes + 1;
+}
+
+void Linker::place_object_files() {
+	/*
+
+	Decides which object files are resident -- that is, always in memory, from _PRG_BOTTOM up -- and which are put in banks (see vm/ProgramImage.h).
+	If the whole program fits in conventional memory, every file is resident, and the program is linked just as it would be without banks. Otherwise, as many files as possible are kept resident, in order, and the rest are packed into 4k banks; the first file holds the entry point, so it must be resident.
+
+	A bank is only visible while it is selected, so a JSR from outside a bank to a function in it is pointed at a trampoline instead (see write_trampoline(...)). The trampolines go after the resident files, so they must fit in the resident part of memory as well; if they don't, the last resident file is moved into a bank, and we try again.
+	Only object files are placed, not single functions, as the linker can't tell where one function ends and the next begins; references within a file are therefore always to the same bank.
+
+	*/
+
+	std::vector<size_t> file_sizes;
+	size_t total_size = 0;
+	for (std::vector<SinObjectFile>::iterator file_iter = this->object_files.begin(); file_iter != this->object_files.end(); file_iter++) {
+		file_sizes.push_back(this->get_file_size(*file_iter));
+		total_size += file_sizes.back();
+	}
+
+	this->file_banks = std::vector<size_t>(this->object_files.size(), 0);
+	this->num_banks = 0;
+	this->symbol_banks.clear();
+	this->far_symbols.clear();
+
+	if (total_size <= (_PRG_TOP - _PRG_BOTTOM)) {
+		return;
+	}
+
+	// find the file that defines each symbol
+	std::map<std::string, size_t> definitions;
+	for (size_t file = 0; file < this->object_files.size(); file++) {
+		for (std::list<AssemblerSymbol>::iterator symbol_iter = this->object_files[file].symbol_table.begin(); symbol_iter != this->object_files[file].symbol_table.end(); symbol_iter++) {
+			if ((symbol_iter->symbol_class == D) || (symbol_iter->symbol_class == C)) {
+				definitions.insert(std::make_pair(symbol_iter->name, file));	// like the master symbol table, the first definition wins
+			}
+		}
+	}
+
+	// the resident files must end before the bank window
+	size_t resident_limit = _BANK_WINDOW_START - _PRG_BOTTOM;
+	size_t num_resident = 0;
+	size_t resident_size = 0;
+	while ((num_resident < file_sizes.size()) && (resident_size + file_sizes[num_resident] <= resident_limit)) {
+		resident_size += file_sizes[num_resident];
+		num_resident++;
+	}
+
+	while (true) {
+		if (num_resident == 0) {
+			throw std::runtime_error("**** Memory Exception: The first object file must fit in conventional memory.");
+		}
+
+		// pack the rest of the files into the first bank that has room for them
+		std::vector<size_t> bank_sizes;
+		for (size_t file = num_resident; file < file_sizes.size(); file++) {
+			if (file_sizes[file] > bank_size) {
+				throw std::runtime_error("**** Memory Exception: An object file is too large to fit in a bank (" + std::to_string(file_sizes[file]) + " bytes; the limit is " + std::to_string(bank_size) + ").");
+			}
+
+			size_t bank = 0;
+			while ((bank < bank_sizes.size()) && (bank_sizes[bank] + file_sizes[file] > bank_size)) {
+				bank++;
+			}
+			if (bank == bank_sizes.size()) {
+				bank_sizes.push_back(0);
+			}
+
+			bank_sizes[bank] += file_sizes[file];
+			this->file_banks[file] = bank + 1;
+		}
+
+		// every symbol in a bank that is referenced from outside of it needs a trampoline
+		this->far_symbols.clear();
+		for (size_t file = 0; file < this->object_files.size(); file++) {
+			for (std::list<RelocationSymbol>::iterator relocation_iter = this->object_files[file].relocation_table.begin(); relocation_iter != this->object_files[file].relocation_table.end(); relocation_iter++) {
+				std::map<std::string, size_t>::iterator definition = definitions.find(relocation_iter->name);
+				if ((definition != definitions.end()) && (this->file_banks[definition->second] != 0) && (this->file_banks[definition->second] != this->file_banks[file])) {
+					this->far_symbols.insert(relocation_iter->name);
+				}
+			}
+		}
+
+		if (resident_size + this->far_symbols.size() * this->get_trampoline_size() <= resident_limit) {
+			this->num_banks = bank_sizes.size();
+			break;
+		}
+
+		// make room for the trampolines
+		num_resident--;
+		resident_size -= file_sizes[num_resident];
+	}
+
+	for (std::map<std::string, size_t>::iterator definition = definitions.begin(); definition != definitions.end(); definition++) {
+		if (this->file_banks[definition->second] != 0) {
+			this->symbol_banks[definition->first] = this->file_banks[definition->second];
+		}
+	}
+}
+
+void Linker::write_word(std::vector<uint8_t>& sml_data, size_t value) {
+	size_t wordsize_bytes = (size_t)this->_wordsize / 8;
+	for (size_t i = wordsize_bytes; i > 0; i--) {
+		sml_data.push_back((uint8_t)(value >> ((i - 1) * 8)));
+	}
+}
+
+void Linker::write_trampoline(std::vector<uint8_t>& sml_data, size_t bank, size_t address) {
+	/*
+
+	Appends a trampoline for the function at 'address' in 'bank'; SINVM::far_call() explains how it works.
+
+	*/
+
+	sml_data.push_back(SYSCALL);
+	sml_data.push_back(addressingmode::immediate);
+	this->write_word(sml_data, SYS_FARCALL);
+	this->write_word(sml_data, bank);
+	this->write_word(sml_data, address);
+
+	sml_data.push_back(SYSCALL);
+	sml_data.push_back(addressingmode::immediate);
+	this->write_word(sml_data, SYS_FARRETURN);
+	sml_data.push_back(RTS);
+}
+
+
 // create a .sml file from all of our objects
 void Linker::create_sml_file(std::string file_name) {
 
+	// decide which files go in banks, if the program is too large for conventional memory
+	this->place_object_files();
+
 	// first, update all the memory offsets
-	size_t current_offset = this->_start_offset;	// current offset starts at the start address of VM memory
+	std::vector<size_t> bank_offsets(this->num_banks + 1, _BANK_WINDOW_START);	// the next address in each bank; files in a bank are placed in the bank window
+	bank_offsets[0] = this->_start_offset;	// resident files start at the start address of VM memory
 	size_t current_rs_address = this->_rs_start;	// the next available address for a @rs directive starts at Linker::_rs_start
 
 	// iterate over the whole vector
 	for (std::vector<SinObjectFile>::iterator file_iter = this->object_files.begin(); file_iter != this->object_files.end(); file_iter++) {
+		size_t& current_offset = bank_offsets[this->file_banks[file_iter - this->object_files.begin()]];
+
 		// _text_start holds the start address, from which all control flow addresses in the file are offset
 		file_iter->_text_start = current_offset;
 
@@ -121,10 +269,18 @@ void Linker::create_sml_file(std::string file_name) {
 		current_offset += data_section_offset;
 	}
 
+	// the trampolines come after the resident files
+	this->trampolines.clear();
+	size_t trampoline_address = bank_offsets[0];
+	for (std::set<std::string>::iterator symbol_iter = this->far_symbols.begin(); symbol_iter != this->far_symbols.end(); symbol_iter++) {
+		this->trampolines[*symbol_iter] = trampoline_address;
+		trampoline_address += this->get_trampoline_size();
+	}
+
 	// now that our initial offsets and defined label offsets have been adjusted, we can construct the master symbol table
 
-	// first, create the vector to hold the table
-	std::vector<AssemblerSymbol> master_symbol_table;
+	// first, clear the table in case we have linked before; it is kept so that the symbol map may be written
+	this->master_symbol_table.clear();
 	// iterate through our object files' symbol tables to add to the master table
 
 	for (std::vector<SinObjectFile>::iterator file_iter = this->object_files.begin(); file_iter != this->object_files.end(); file_iter++) {
@@ -132,7 +288,7 @@ void Linker::create_sml_file(std::string file_name) {
 		// find them by iterating through each symbol table and adding the defined symbols to the master table
 		for (std::list<AssemblerSymbol>::iterator symbol_iter = file_iter->symbol_table.begin(); symbol_iter != file_iter->symbol_table.end(); symbol_iter++) {
 			if (symbol_iter->symbol_class == D || symbol_iter->symbol_class == C || symbol_iter->symbol_class == R || symbol_iter->symbol_class == M) {
-				master_symbol_table.push_back(*symbol_iter);
+				this->master_symbol_table.push_back(*symbol_iter);
 			}
 			else {
 				continue;
@@ -148,9 +304,9 @@ void Linker::create_sml_file(std::string file_name) {
 			// if it's undefined, a constant, or a reserved macro
 			if (symbol_iter->symbol_class == U || symbol_iter->symbol_class == C || symbol_iter->symbol_class == R) {
 				// iterate through the master table and find the symbol referenced
-				std::vector<AssemblerSymbol>::iterator master_table_iter = master_symbol_table.begin();
+				std::vector<AssemblerSymbol>::iterator master_table_iter = this->master_symbol_table.begin();
 				bool found = false;
-				while ((master_table_iter != master_symbol_table.end()) && !found) {
+				while ((master_table_iter != this->master_symbol_table.end()) && !found) {
 					// if the symbol names are the same
 					if (master_table_iter->name == symbol_iter->name) {
 						// copy over the value from the master table iterator to our local symbol table
@@ -201,10 +357,10 @@ void Linker::create_sml_file(std::string file_name) {
 				}
 				else {
 					// retrieve "value" from the master symbol table
-					std::vector<AssemblerSymbol>::iterator master_table_iter = master_symbol_table.begin();
+					std::vector<AssemblerSymbol>::iterator master_table_iter = this->master_symbol_table.begin();
 					bool found = false;
 					size_t value = 0;
-					while ((master_table_iter != master_symbol_table.end()) && !found) {
+					while ((master_table_iter != this->master_symbol_table.end()) && !found) {
 						// if the names are the same
 						if (master_table_iter->name == relocation_iter->name) {
 							// get the value
@@ -222,6 +378,16 @@ void Linker::create_sml_file(std::string file_name) {
 						throw std::runtime_error("**** Relocation error: Could not find '" + relocation_iter->name + "' in symbol table!");
 					}
 
+					// a function in another bank must be called through its trampoline, as its bank may not be selected
+					std::map<std::string, size_t>::iterator bank_iter = this->symbol_banks.find(relocation_iter->name);
+					if ((bank_iter != this->symbol_banks.end()) && (bank_iter->second != this->file_banks[file_iter - this->object_files.begin()])) {
+						// the relocation is the operand; it follows the opcode and the addressing mode
+						if ((relocation_iter->value < 2) || (relocation_iter->value - 2 >= file_iter->program_data.size()) || (file_iter->program_data[relocation_iter->value - 2] != JSR)) {
+							throw std::runtime_error("**** Bank error: '" + relocation_iter->name + "' is in a bank, so it may only be used with JSR outside of it.");
+						}
+						value = this->trampolines[relocation_iter->name];
+					}
+
 					// finally, write "value" to the relocation table
 					// get the start address and the number of bytes in our wordsize
 					size_t value_start_address = relocation_iter->value;
@@ -236,11 +402,16 @@ void Linker::create_sml_file(std::string file_name) {
 
 	// Now, we can write all of the program data to a vector of bytes
 	std::vector<uint8_t> sml_data;
+	std::vector<std::vector<uint8_t>> bank_data(this->num_banks);
 
 	for (std::vector<SinObjectFile>::iterator file_iter = this->object_files.begin(); file_iter != this->object_files.end(); file_iter++) {
+		// files in banks are written to their banks instead
+		size_t bank = this->file_banks[file_iter - this->object_files.begin()];
+		std::vector<uint8_t>& file_data = (bank == 0) ? sml_data : bank_data[bank - 1];
+
 		// iterate through the program data and push the bytes into sml_data
 		for (std::vector<uint8_t>::iterator byte_iter = file_iter->program_data.begin(); byte_iter != file_iter->program_data.end(); byte_iter++) {
-			sml_data.push_back(*byte_iter);
+			file_data.push_back(*byte_iter);
 		}
 		// create a vector of uint8_ts from our file to contain all of the .data information
 		std::vector<uint8_t> data_section;
@@ -254,8 +425,22 @@ void Linker::create_sml_file(std::string file_name) {
 		}
 		// now, push all of the information from data_section to sml_data; the data section should come at the end of each object
 		for (std::vector<uint8_t>::iterator data_section_iter = data_section.begin(); data_section_iter != data_section.end(); data_section_iter++) {
-			sml_data.push_back(*data_section_iter);
+			file_data.push_back(*data_section_iter);
+		}
+	}
+
+	// the trampolines follow the resident files, in the order their addresses were given out
+	for (std::set<std::string>::iterator symbol_iter = this->far_symbols.begin(); symbol_iter != this->far_symbols.end(); symbol_iter++) {
+		std::vector<AssemblerSymbol>::iterator master_table_iter = this->master_symbol_table.begin();
+		while ((master_table_iter != this->master_symbol_table.end()) && (master_table_iter->name != *symbol_iter)) {
+			master_table_iter++;
 		}
+
+		// every far symbol was defined in some file, so this should never happen
+		if (master_table_iter == this->master_symbol_table.end()) {
+			throw std::runtime_error("**** Bank error: Could not find '" + *symbol_iter + "' in symbol table!");
+		}
+		this->write_trampoline(sml_data, this->symbol_banks[*symbol_iter], master_table_iter->value);
 	}
 
 
@@ -277,14 +462,58 @@ void Linker::create_sml_file(std::string file_name) {
 		BinaryIO::writeU8(sml_file, *it);
 	}
 
+	// the banks follow the program, if there are any; each is padded to a whole bank
+	if (this->num_banks != 0) {
+		BinaryIO::writeU16(sml_file, (uint16_t)this->num_banks);
+
+		for (std::vector<std::vector<uint8_t>>::iterator bank_iter = bank_data.begin(); bank_iter != bank_data.end(); bank_iter++) {
+			bank_iter->resize(bank_size, 0);
+			sml_file.write((const char*)bank_iter->data(), bank_iter->size());
+		}
+	}
+
 	sml_file.close();
 }
 
 
+void Linker::write_symbol_map(std::string file_name) {
+	/*
+
+	Writes the address of every label in the program to a .map file, so that tools like the VM's profiler can refer to code by name; the .sml format has no room for symbols.
+	Each line holds an address, in the form $1234, followed by the name of the label. create_sml_file(...) must be called first.
+	Labels in banks are given their addresses in the bank window, so labels in different banks may share an address; the bank, in decimal, follows the name of each of them. Each trampoline is named after its function, with the prefix __far_.
+
+	*/
+
+	std::ofstream map_file;
+	map_file.open(file_name + ".map", std::ios::out);
+
+	for (std::vector<AssemblerSymbol>::iterator it = this->master_symbol_table.begin(); it != this->master_symbol_table.end(); it++) {
+		if (it->symbol_class == D) {
+			map_file << "$" << std::hex << it->value << " " << it->name;
+
+			std::map<std::string, size_t>::iterator bank = this->symbol_banks.find(it->name);
+			if (bank != this->symbol_banks.end()) {
+				map_file << " " << std::dec << bank->second;
+			}
+
+			map_file << std::endl;
+		}
+	}
+
+	for (std::map<std::string, size_t>::iterator it = this->trampolines.begin(); it != this->trampolines.end(); it++) {
+		map_file << "$" << std::hex << it->second << " __far_" << it->first << std::endl;
+	}
+
+	map_file.close();
+}
+
+
 Linker::Linker() {
 	this->_start_offset = 0;	// default to 0
 	this->_wordsize = 16;	// default to 16 bit words
 	this->_rs_start = _RS_START;	// default to "_RS_START" as defined in "VMMemoryMap.h" 
+	this->num_banks = 0;
 }
 
 
@@ -293,6 +522,7 @@ Linker::Linker(std::vector<SinObjectFile> object_files) : object_files(object_fi
 	this->_start_offset = 0;	// default to 0
 	this->_wordsize = 16;	// default to 16 bit words
 	this->_rs_start = _RS_START;	// default to "_RS_START" as defined in "VMMemoryMap.h" 
+	this->num_banks = 0;
 
 	this->get_metadata();	// get our metadata so we can form the sml file; this may overwrite the initial values established above
 }
@@ -14,6 +14,8 @@ This file contains the class for the linker, which takes SIN Object files (with
 #include <vector>
 #include <tuple>
 #include <string>
+#include <map>
+#include <set>
 #include <iostream>
 #include <fstream>
 
@@ -27,6 +29,7 @@ class Linker
 	/*
 	
 	The Linker takes a series of object files and links them together so that they can be used in one executable. It searches through all of the object files to resolve references, sets the proper memory offsets for all control flow instructions, and modifies the binary instructions to use the correct addresses.
+	If the program is too large for conventional memory, some of the object files are put in banks, and calls into them go through trampolines; see place_object_files().
 	
 	*/
 
@@ -38,12 +41,32 @@ class Linker
 	size_t _start_offset;	// the start address of the program; in 16-bit VM version 1, it is 0x2600
 	size_t _rs_start;	// the start address for macros/variables using the @rs directive
 
+	// every symbol defined in the program, with its final value; filled by create_sml_file(...)
+	std::vector<AssemblerSymbol> master_symbol_table;
+
+	// where each object file goes when the program is too large for conventional memory; see place_object_files()
+	std::vector<size_t> file_banks;	// the bank holding each object file, or 0 if the file is resident
+	size_t num_banks;
+	std::map<std::string, size_t> symbol_banks;	// the bank of every symbol defined in a bank
+	std::set<std::string> far_symbols;	// the symbols in banks that are used from outside of them; each gets a trampoline
+	std::map<std::string, size_t> trampolines;	// the address of each symbol's trampoline
+
 	// get the word size, start address, etc. based on the info in our .sinc files
 	void get_metadata();
+
+	// banking utility
+	size_t get_file_size(const SinObjectFile& file);	// the size of the file's text and data together
+	size_t get_trampoline_size();
+	void place_object_files();	// decide which files go in banks
+	void write_trampoline(std::vector<uint8_t>& sml_data, size_t bank, size_t address);	// append a trampoline for the function at 'address' in 'bank'
+	void write_word(std::vector<uint8_t>& sml_data, size_t value);	// append a big-endian word
 public:
 	// entry function; creates an sml file; this will use Linker::object_files
 	void create_sml_file(std::string file_name);
 
+	// write the addresses of the program's labels to a .map file; see Profiler.h
+	void write_symbol_map(std::string file_name);
+
 	Linker();
 	Linker(std::vector<SinObjectFile> object_files);
 	~Linker();
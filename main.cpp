@@ -15,6 +15,7 @@ For a documentation of the language, see either the doc folder in this project o
 
 // Our headers
 #include "vm/SINVM.h"
+#include "vm/BatchRunner.h"
 #include "compile/Compiler.h"
 #include "link/Linker.h"
 #include "util/SinObjectFile.h"
@@ -80,13 +81,26 @@ int main (int argc, char* argv[]) {
 	bool debug_values = false;	// if we want "SINVM::_debug_values()" after execution
 	bool produce_asm_file = false;
 	bool include_builtins = true;
+	bool fusion_report = false;	// if we want "SINVM::_fusion_report()" before execution
+	bool profile = false;	// if we want the linker to write a symbol map and the VM to print "SINVM::_profile_report(...)" after execution
+	bool flamegraph = false;	// if we want the VM to write its call paths to a .folded file for flamegraph tools after execution
+	bool trace = false;	// if we want the VM to write its last instructions to a .trace file if the program fails
+	bool decode_trace = false;	// if the file is a .trace file to print as text
+	bool compact_heap = false;	// if we want the VM to compact the heap when it is fragmented; only for programs that use handles (see Doc/syscall.txt)
+	bool heap_report = false;	// if we want "SINVM::_heap_report()" after execution
+	bool report_cycles = false;	// if we want the number of SIN cycles and the wall time printed after execution
+	DispatchMode dispatch_mode = SWITCH_DISPATCH;	// the dispatch loop the VM should use; set with --dispatch=switch|threaded|block
+	bool batch = false;	// if the file is a manifest of .sml jobs to run with the BatchRunner
+	size_t batch_threads = 0;	// the number of threads the BatchRunner uses; set with --threads=n, or 0 for one per core
+	size_t output_buffer_size = outputbuffer::default_size;	// the number of characters the VM holds before writing its output; set with --output-buffer=n, or 0 to write everything immediately
+	std::string file_root;	// the directory the program may open files in; set with --file-root=dir or --file-root dir. If it isn't set, the program can't open files
 
 	// if we wrote to a stringstream
 	bool saved_stringstream = false;
 	std::stringstream sina_code;
 
-	// wordsize will default to 16, but we can set it with the --wsxx flag
-	uint8_t wordsize = 16;
+	// wordsize will default to the VM's word size (see SIN_WORDSIZE in VMMemoryMap.h), but we can set it with the --wsxx flag
+	uint8_t wordsize = SIN_WORDSIZE;
 
 	// our file name should be the zeroth element in the vector (syntax is "SIN file_name flags")
 	std::string filename = program_arguments[0];
@@ -184,6 +198,88 @@ int main (int argc, char* argv[]) {
 				include_builtins = false;
 			}
 
+			if ((*arg_iter == "--fusion-report")) {
+				fusion_report = true;
+			}
+
+			if ((*arg_iter == "--profile")) {
+				profile = true;
+			}
+
+			if ((*arg_iter == "--flamegraph")) {
+				flamegraph = true;
+			}
+
+			if ((*arg_iter == "--trace")) {
+				trace = true;
+			}
+
+			if ((*arg_iter == "--compact-heap")) {
+				compact_heap = true;
+			}
+
+			if ((*arg_iter == "--heap-report")) {
+				heap_report = true;
+			}
+
+			if ((*arg_iter == "--cycles")) {
+				report_cycles = true;
+			}
+
+			// if the decode-trace flag is set, the file is a trace written by the VM; overrides all other flags
+			if ((*arg_iter == "--decode-trace")) {
+				decode_trace = true;
+				compile = false;
+				assemble = false;
+				disassemble = false;
+				link = false;
+				execute = false;
+			}
+
+			// if the batch flag is set, the file is a manifest of jobs to run; overrides all other flags
+			if ((*arg_iter == "--batch")) {
+				batch = true;
+				compile = false;
+				assemble = false;
+				disassemble = false;
+				link = false;
+				execute = false;
+			}
+
+			if (std::regex_match(*arg_iter, std::regex("--threads=[0-9]+"))) {
+				batch_threads = (size_t)std::stoi(arg_iter->substr(10));
+			}
+
+			if (std::regex_match(*arg_iter, std::regex("--output-buffer=[0-9]+"))) {
+				output_buffer_size = (size_t)std::stoi(arg_iter->substr(16));
+			}
+
+			// if we let the program open files in a directory
+			if (std::regex_match(*arg_iter, std::regex("--file-root=.+"))) {
+				file_root = arg_iter->substr(12);
+			}
+			else if ((*arg_iter == "--file-root") && ((arg_iter + 1) != program_arguments.end())) {
+				arg_iter++;
+				file_root = *arg_iter;
+			}
+
+			// if we select the VM's dispatch loop
+			if (std::regex_match(*arg_iter, std::regex("--dispatch=.+"))) {
+				std::string mode_string = arg_iter->substr(11);
+				if (mode_string == "switch") {
+					dispatch_mode = SWITCH_DISPATCH;
+				}
+				else if (mode_string == "threaded") {
+					dispatch_mode = THREADED_DISPATCH;
+				}
+				else if (mode_string == "block") {
+					dispatch_mode = BLOCK_DISPATCH;
+				}
+				else {
+					std::cerr << "**** Unknown dispatch mode '" << mode_string << "'; expected 'switch', 'threaded', or 'block'. Using 'switch'." << std::endl;
+				}
+			}
+
 			// if we explicitly set word size
 			if (std::regex_match(*arg_iter, std::regex("--ws.+", std::regex_constants::icase))) {
 				std::string wordsize_string = arg_iter->substr(4);
@@ -216,6 +312,42 @@ int main (int argc, char* argv[]) {
 	// The functions are called in this order: compile, disassemble, assemble, link, execute
 
 	try {
+		// run a batch of jobs listed in a manifest
+		if (batch) {
+			std::ifstream manifest;
+			manifest.open(filename, std::ios::in);
+			if (manifest.is_open()) {
+				BatchRunner runner(dispatch_mode, batch_threads);
+				runner.load_manifest(manifest);
+				manifest.close();
+
+				runner.run();
+				runner.write_results(std::cout);
+
+				if (runner.get_failure_count() != 0) {
+					exit(1);
+				}
+			}
+			else {
+				file_error(filename);
+				exit(1);
+			}
+		}
+
+		// print a trace written by the VM
+		if (decode_trace) {
+			std::ifstream trace_file;
+			trace_file.open(filename, std::ios::in | std::ios::binary);
+			if (trace_file.is_open()) {
+				ExecutionTrace::decode(trace_file, std::cout);
+				trace_file.close();
+			}
+			else {
+				file_error(filename);
+				exit(1);
+			}
+		}
+
 		// interpret a .sin file
 		if (interpret) {
 			throw std::runtime_error("**** Interpreted-SIN is currently not supported.");
@@ -224,6 +356,11 @@ int main (int argc, char* argv[]) {
 		if (compile) {
 			// validate file type
 			if (file_extension == ".sin") {
+				// the compiler only generates code for a 16-bit VM; 32-bit programs must be written in SINASM for now
+				if (wordsize != 16) {
+					throw std::runtime_error("**** The compiler only supports a 16-bit word size; use --ws16, or assemble a .sina file instead.");
+				}
+
 				// open the file
 				std::ifstream sin_file;
 				sin_file.open(filename, std::ios::in);
@@ -426,6 +563,11 @@ int main (int argc, char* argv[]) {
 				Linker linker(*objects_vector);
 				linker.create_sml_file(filename_no_extension);
 
+				// the profiler uses the map to name functions
+				if (profile || flamegraph) {
+					linker.write_symbol_map(filename_no_extension);
+				}
+
 				// update the filename
 				file_extension = ".sml";
 				filename = filename_no_extension + file_extension;
@@ -444,7 +586,71 @@ int main (int argc, char* argv[]) {
 				if (sml_file.is_open()) {
 					// create an instance of the SINVM with our SML file and run it
 					SINVM* vm = new SINVM(sml_file);	// use the heap because the vm is pretty large
-					vm->run_program();
+					vm->set_dispatch_mode(dispatch_mode);
+					vm->set_output_buffer_size(output_buffer_size);
+
+					if (!file_root.empty()) {
+						vm->set_file_root(file_root);
+					}
+
+					if (compact_heap) {
+						vm->enable_heap_compaction();
+					}
+
+					if (trace) {
+						vm->enable_tracing(filename_no_extension + ".trace");
+					}
+
+					if (profile || flamegraph) {
+						vm->enable_profiling();
+
+						// name the functions using the symbol map, if the linker wrote one
+						std::ifstream map_file;
+						map_file.open(filename_no_extension + ".map", std::ios::in);
+						if (map_file.is_open()) {
+							vm->load_symbol_map(map_file);
+							map_file.close();
+						}
+					}
+
+					if (fusion_report) {
+						vm->_fusion_report();
+					}
+
+					std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+					try {
+						vm->run_program();
+					}
+					catch (std::exception& e) {
+						// the profile is most useful when the program fails, so print it before reporting the error
+						if (profile) {
+							vm->_profile_report(std::cout);
+						}
+						if (flamegraph) {
+							std::ofstream folded_file(filename_no_extension + ".folded", std::ios::out);
+							vm->write_folded_stacks(folded_file);
+						}
+						throw;
+					}
+
+					if (profile) {
+						vm->_profile_report(std::cout);
+					}
+					if (flamegraph) {
+						std::ofstream folded_file(filename_no_extension + ".folded", std::ios::out);
+						vm->write_folded_stacks(folded_file);
+					}
+
+					// the cycle count is the same on every run, so it may be compared where the wall time can't be
+					if (report_cycles) {
+						std::chrono::duration<double, std::milli> wall_time = std::chrono::steady_clock::now() - start_time;
+						std::cout << std::dec << vm->get_cycle_count() << " SIN cycles in " << wall_time.count() << " ms" << std::endl;
+					}
+
+					if (heap_report) {
+						vm->_heap_report();
+					}
 
 					if (debug_values) {
 						vm->_debug_values();
@@ -19,7 +19,7 @@ Opcodes are organized as follows:
   - 0x90 to 0x9F  - Stack instructions
   - 0xA0 to 0xAF  - STATUS instructions
   - 0xB0 to 0xBF  - Control Flow instructions
-  - 0xC0 to 0xCF  - Reserved for extra ALU instructions
+  - 0xC0 to 0xCF  - Vector ALU instructions
   - 0xD0 to 0xDF  - Reserved for extra FPU instructions
   - 0xE0 to 0xEF  - Reserved for extra miscellaneous instructions
   - 0xF0 to 0xFF  - Machine instructions
@@ -47,7 +47,7 @@ Instructions may be added as needed into the available pages
 #include <cinttypes>	// we need uint8_t
 
 // the number of instructions in our machine language
-const size_t num_instructions = 98;
+const size_t num_instructions = 109;
 
 // General instructions
 const uint8_t NOOP = 0x00;
@@ -193,6 +193,20 @@ const uint8_t RTI = 0xBD;
 const uint8_t JSR = 0xBE;
 const uint8_t RTS = 0xBF;
 
+// Vector ALU instructions; these work on A words at the address in X (the destination) and the address in B (the source)
+const uint8_t VADD = 0xC0;
+const uint8_t VSUB = 0xC1;
+const uint8_t VAND = 0xC2;
+const uint8_t VOR = 0xC3;
+const uint8_t VXOR = 0xC4;
+const uint8_t VCMP = 0xC5;	// each destination word becomes $FFFF if it is equal to the source word, or $0000 if not
+const uint8_t VSUM = 0xC6;	// A is loaded with the sum of the A words at the address in B
+// 0xC7 to 0xCF unused
+
+// Miscellaneous instructions
+const uint8_t MOVM = 0xE0;	// block move: copy A bytes from the address in B to the address in X
+const uint8_t FILLM = 0xE1;	// block fill: set A bytes at the address in X to the low byte of B
+
 // Machine instructions
 const uint8_t BRK = 0xF0;	// temporary debugging instruction to view processor status
 const uint8_t SYSCALL = 0xFA;
@@ -208,10 +222,10 @@ This allows us to find the appropriate opcode for a given mnemonic easily simply
   2) indexing to the same place in the second array
 
 */
-const std::string instructions_list[num_instructions] = { "NOOP", "LOADA", "STOREA", "TAB", "TAX", "TAY", "TASP", "TASTATUS", "INCA", "DECA", "LOADB", "STOREB", "TBA", "TBX", "TBY", "TBSP", "TBSTATUS", "INCB", "DECB", "LOADX", "STOREX", "TXA", "TXB", "TXY", "TXSP", "INCX", "DECX", "LOADY", "STOREY", "TYA", "TYB", "TYX", "TYSP", "INCY", "DECY", "ROL", "ROR", "LSL", "LSR", "INCM", "DECM", "ADDCA", "ADDCB", "MULTA", "MULTUA", "DIVA", "DIVUA", "ANDA", "ORA", "XORA", "CMPA", "CMPB", "CMPX", "CMPY", "FADDA", "FSUBA", "FMULTA", "FDIVA", "PHA", "PHB", "PLA", "PLB", "PRSA", "PRSB", "RSTA", "RSTB", "PRSR", "RSTR", "TSPA", "TSPB", "TSPX", "TSPY", "INCSP", "DECSP", "CLC", "SEC", "CLN", "SEN", "CLF", "SEF", "TSTATUSA", "TSTATUSB", "JMP", "BRNE", "BREQ", "BRGT", "BRLT", "BRZ", "BRN", "BRPL", "IRQ", "RTI", "JSR", "RTS", "BRK", "SYSCALL", "RESET", "HALT"};
-const uint8_t opcodes[num_instructions] = { NOOP, LOADA, STOREA, TAB, TAX, TAY, TASP, TASTATUS, INCA, DECA, LOADB, STOREB, TBA, TBX, TBY, TBSP, TBSTATUS, INCB, DECB, LOADX, STOREX, TXA, TXB, TXY, TXSP, INCX, DECX, LOADY, STOREY, TYA, TYB, TYX, TYSP, INCY, DECY, ROL, ROR, LSL, LSR, INCM, DECM, ADDCA, ADDCB, MULTA, MULTUA, DIVA, DIVUA, ANDA, ORA, XORA, CMPA, CMPB, CMPX, CMPY, FADDA, FSUBA, FMULTA, FDIVA, PHA, PHB, PLA, PLB, PRSA, PRSB, RSTA, RSTB, PRSR, RSTR, TSPA, TSPB, TSPX, TSPY, INCSP, DECSP, CLC, SEC, CLN, SEN, CLF, SEF, TSTATUSA, TSTATUSB, JMP, BRNE, BREQ, BRGT, BRLT, BRZ, BRN, BRPL, IRQ, RTI, JSR, RTS, BRK, SYSCALL, RESET, HALT };
+const std::string instructions_list[num_instructions] = { "NOOP", "LOADA", "STOREA", "TAB", "TAX", "TAY", "TASP", "TASTATUS", "INCA", "DECA", "LOADB", "STOREB", "TBA", "TBX", "TBY", "TBSP", "TBSTATUS", "INCB", "DECB", "LOADX", "STOREX", "TXA", "TXB", "TXY", "TXSP", "INCX", "DECX", "LOADY", "STOREY", "TYA", "TYB", "TYX", "TYSP", "INCY", "DECY", "ROL", "ROR", "LSL", "LSR", "INCM", "DECM", "ADDCA", "ADDCB", "MULTA", "MULTUA", "DIVA", "DIVUA", "ANDA", "ORA", "XORA", "SUBCA", "SUBCB", "CMPA", "CMPB", "CMPX", "CMPY", "FADDA", "FSUBA", "FMULTA", "FDIVA", "PHA", "PHB", "PLA", "PLB", "PRSA", "PRSB", "RSTA", "RSTB", "PRSR", "RSTR", "TSPA", "TSPB", "TSPX", "TSPY", "INCSP", "DECSP", "CLC", "SEC", "CLN", "SEN", "CLF", "SEF", "TSTATUSA", "TSTATUSB", "JMP", "BRNE", "BREQ", "BRGT", "BRLT", "BRZ", "BRN", "BRPL", "IRQ", "RTI", "JSR", "RTS", "VADD", "VSUB", "VAND", "VOR", "VXOR", "VCMP", "VSUM", "MOVM", "FILLM", "BRK", "SYSCALL", "RESET", "HALT"};
+const uint8_t opcodes[num_instructions] = { NOOP, LOADA, STOREA, TAB, TAX, TAY, TASP, TASTATUS, INCA, DECA, LOADB, STOREB, TBA, TBX, TBY, TBSP, TBSTATUS, INCB, DECB, LOADX, STOREX, TXA, TXB, TXY, TXSP, INCX, DECX, LOADY, STOREY, TYA, TYB, TYX, TYSP, INCY, DECY, ROL, ROR, LSL, LSR, INCM, DECM, ADDCA, ADDCB, MULTA, MULTUA, DIVA, DIVUA, ANDA, ORA, XORA, SUBCA, SUBCB, CMPA, CMPB, CMPX, CMPY, FADDA, FSUBA, FMULTA, FDIVA, PHA, PHB, PLA, PLB, PRSA, PRSB, RSTA, RSTB, PRSR, RSTR, TSPA, TSPB, TSPX, TSPY, INCSP, DECSP, CLC, SEC, CLN, SEN, CLF, SEF, TSTATUSA, TSTATUSB, JMP, BRNE, BREQ, BRGT, BRLT, BRZ, BRN, BRPL, IRQ, RTI, JSR, RTS, VADD, VSUB, VAND, VOR, VXOR, VCMP, VSUM, MOVM, FILLM, BRK, SYSCALL, RESET, HALT };
 
 
 // Some opcodes stand by themselves; keep an array of them so that we can easily check
-const size_t num_standalone_opcodes = 56;
-const uint8_t standalone_opcodes[num_standalone_opcodes] = { NOOP, TAB, TAY, TAX, TASP, TASTATUS, INCA, DECA, TBA, TBX, TBY, TBSP, TBSTATUS, INCB, DECB, TXA, TXB, TXY, TXSP, INCX, DECX, TYA, TYB, TYX, TYSP, INCY, DECY, ROL, PHA, PLA, PHB, PLB, PRSA, PRSB, RSTA, RSTB, PRSR, RSTR, TSPA, TSPB, TSPX, TSPY, INCSP, DECSP, CLC, SEC, CLN, SEN, CLF, SEF, TSTATUSA, TSTATUSB, RTS, BRK, RESET, HALT };
+const size_t num_standalone_opcodes = 65;
+const uint8_t standalone_opcodes[num_standalone_opcodes] = { NOOP, TAB, TAY, TAX, TASP, TASTATUS, INCA, DECA, TBA, TBX, TBY, TBSP, TBSTATUS, INCB, DECB, TXA, TXB, TXY, TXSP, INCX, DECX, TYA, TYB, TYX, TYSP, INCY, DECY, ROL, PHA, PLA, PHB, PLB, PRSA, PRSB, RSTA, RSTB, PRSR, RSTR, TSPA, TSPB, TSPX, TSPY, INCSP, DECSP, CLC, SEC, CLN, SEN, CLF, SEF, TSTATUSA, TSTATUSB, RTS, VADD, VSUB, VAND, VOR, VXOR, VCMP, VSUM, MOVM, FILLM, BRK, RESET, HALT };
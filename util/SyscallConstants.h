@@ -21,9 +21,21 @@ const uint16_t STD_READ = 0x13;
 const uint16_t STD_OUT = 0x14;
 const uint16_t STD_OUT_HEX = 0x15;
 
+const uint16_t STD_FILEREAD = 0x16;
+const uint16_t STD_FILEWRITE = 0x17;
+const uint16_t STD_FILESEEK = 0x18;
+const uint16_t STD_FILEMAP = 0x19;
+
 const uint16_t MEMFREE = 0x20;
 const uint16_t MEMALLOC = 0x21;
 const uint16_t MEMREALLOC = 0x22;
 const uint16_t MEMREALLOC_SAFE = 0x23;
+const uint16_t MEMHANDLES = 0x24;
+
+const uint16_t SYS_CYCLES = 0x30;
+
+const uint16_t SYS_BANKSELECT = 0x40;
+const uint16_t SYS_FARCALL = 0x41;
+const uint16_t SYS_FARRETURN = 0x42;
 
 const uint16_t SYS_EXIT = 0xFF;
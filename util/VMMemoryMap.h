@@ -10,16 +10,36 @@ Our addresses range from $0000 to $FFFF (65k):
 	- The stack lives from $1800 to (but not including) $2400
 	- The call stack lives from $2400 to (but not including) $2600
 	- All included program data lives from $2600 to $f000
+		- If the program is too large for that, the linker puts some of it in banks; only one bank at a time is visible, in the bank window from $e000 to $efff, so the rest of the program must end before $e000
+	- A window onto a host file may be mapped from $f200 to $f9ff
 	- The arguments and command line data take up the last few pages -- $f000 to $ffff
 
 Note that the stacks in the VM grow /downward/ while the heap grows /upward/
 
+The 32-bit VM (built with SIN_WORDSIZE defined as 32) has 16M of memory. The first 64k are laid out exactly as above, so programs are linked the same way for either word size, but the heap is moved to $10000 - $ffffff, giving it everything past the first 64k.
+A 32-bit address may therefore lie past the end of memory. The VM's page tables only cover memory_size bytes, so any code that indexes them directly must either check the range first (see SINVM::range_is_valid(...)) or mask the address with _MEMORY_MAX, as read_byte(...) and friends do.
+
 */
 
 #pragma once
 
+#include <cstddef>	// for size_t
+
+// the word size of the VM, in bits; either 16 or 32. The VM's registers, addresses, and operands are all a word wide, and it only runs programs assembled for its own word size
+#ifndef SIN_WORDSIZE
+#define SIN_WORDSIZE 16
+#endif
+
+#if (SIN_WORDSIZE != 16) && (SIN_WORDSIZE != 32)
+#error "SIN_WORDSIZE must be 16 or 32"
+#endif
+
 // declare how much memory the virtual machine has
+#if SIN_WORDSIZE == 32
+const size_t memory_size = 0x1000000;	// 16M available to the VM
+#else
 const size_t memory_size = 0x10000;	// 16k available to the VM
+#endif
 
 // declare our start addresses for different sections of memory
 
@@ -30,14 +50,21 @@ const size_t _MEMORY_MIN = 0x0000;
 const size_t _POINTER_TABLE_BOTTOM = 0x0002;	// do not start at address 0x00 so that null pointers will point to nothing
 const size_t _LOCAL_DYNAMIC_POINTER = 0x0002;	// this address serves as a temp variable to hold a pointer to dynamic memory during allocation
 const size_t _POINTER_TABLE_TOP = 0x00FF;
+const size_t _HANDLE_TABLE_BOTTOM = 0x0004;	// when the heap is compacted, the rest of the table holds the handles to heap objects; see HeapAllocator.h
 
 // the RS directive, which creates global variables, will allocate variables starting at 0x0100 and have 3 pages
 const size_t _RS_START = 0x0100;
 const size_t _RS_END = 0x03FF;
 
 // any variables allocated on the heap will be allocated starting at 0x0400 up to the input buffer; this is where all dynamic memory will be stored
+// in the 32-bit VM, the heap takes up all of the memory past the first 64k instead
+#if SIN_WORDSIZE == 32
+const size_t _HEAP_START = 0x10000;
+const size_t _HEAP_MAX = 0xFFFFFF;
+#else
 const size_t _HEAP_START = 0x0400;
 const size_t _HEAP_MAX = 0x13FF;
+#endif
 
 const size_t _STRING_BUFFER_START = 0x1400;	// a ~1K buffer for string and input data
 const size_t _STRING_BUFFER_MAX = 0x17FF;
@@ -54,6 +81,12 @@ const size_t _CALL_STACK_BOTTOM = 0x2400;
 const size_t _PRG_TOP = 0xEFFF;	// the limit for our program data
 const size_t _PRG_BOTTOM = 0x2600;	// our lowest possible memory address for the program
 
+// a window onto one of the program's banks, selected with the SYS_BANKSELECT syscall; see ProgramImage.h
+// a program without banks uses this as ordinary program memory
+const size_t _BANK_WINDOW_START = 0xE000;
+const size_t _BANK_WINDOW_END = 0xEFFF;
+const size_t bank_size = _BANK_WINDOW_END - _BANK_WINDOW_START + 1;	// 4k per bank
+
 // our processor signal vectors
 const size_t _SIG_VECTOR = 0xF000;
 const size_t _SINSIGFPE_VECTOR = 0xF000;
@@ -61,8 +94,12 @@ const size_t _SINSIGSYS_VECTOR = 0xF002;
 const size_t _SINSIGILL_VECTOR = 0xF004;
 const size_t _SINSIGSTKFLT_VECTOR = 0xF006;
 
+// a read-only window onto a file opened by the program, mapped with the STD_FILEMAP syscall; see FileIO.h
+const size_t _FILE_WINDOW_START = 0xF200;
+const size_t _FILE_WINDOW_END = 0xF9FF;
+
 // program environment / command - line arguments
 const size_t _ARG = 0xFA00;	// fA00 - ffff available for command-line/environment arguments
 
 // upper limit
-const size_t _MEMORY_MAX = 0xFFFF;
+const size_t _MEMORY_MAX = memory_size - 1;
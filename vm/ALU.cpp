@@ -10,110 +10,17 @@ This file contains the implementation of all of the SINVM functions that pertain
 
 #include "ALU.h"
 
-void ALU::add(uint16_t right)
-{	
-	/*
-	
-	Adds REG_A to some value 'right' with carry.
-	
-	The operation affects the following flags:
-		- N: if the sign bit is set, sets the N flag
-		- V: if neither value is signed (less than 0x8000), but the sign bit is set in the result, the overflow flag is set
-		- Z: if the result is zero, sets the zero flag
-		- C: if the result is greater than 0xFFFF, the C flag is set
-	
-	*/
-
-	// get the result
-	uint16_t result = *this->REG_A + right + (*this->STATUS & StatusConstants::carry);	// we add the value of the carry bit in
-
-	// update the STATUS register; first, clear the N, V, Z, and C flags
-	*this->STATUS &= (0xFFFF - (StatusConstants::negative + StatusConstants::overflow + StatusConstants::zero + StatusConstants::carry));
-
-	// if the result is zero, set the Z flag and then we are done -- the other flags can't possibly be set if the result is 0
-	if (result == 0) {
-		*this->STATUS |= StatusConstants::zero;
-	}
-	// otherwise, we will need to update the other flags
-	else {
-		// if the MSB is set in the result, set the N flag
-		if (result & 0x8000) {
-			*this->STATUS |= StatusConstants::negative;
-		}
-
-		// if (result - right) is not equal to REG_A, we need to set the carry flag
-		if (result - right != *this->REG_A) {
-			*this->STATUS |= StatusConstants::carry;
-		}
-
-		// if the sign bit is not set in either initial value, but it's set in the result, we need to set the overflow flag
-		if ( (!(right & 0x8000) && !(*this->REG_A & 0x8000)) && (result & 0x8000)) {
-			*this->STATUS |= StatusConstants::overflow;
-		}
-	}
-
-	// finally, put the result into REG_A and return
-	*this->REG_A = result;
-	return;
-}
-
-void ALU::sub(uint16_t right)
-{
-	/*
-	
-	Subtract with carry 'right' from REG_A, storing the result in REG_A
-	
-	It affects the following flags:
-		- N: if the sign bit is set, the N flag is set
-		- V: if the N flag
-		- Z: if the result is 0, the Z flag is set and the N and V flags are cleared
-		- C: cleared to indicate a borrow occurring
-
-	Note the subtraction algorithm does not just subtract right from REG_A; if the carry bit is set, this will occur, but if it is clear, it indicates a borrow occurred and the result will be one less than expected.
-	This mode of operation allows for easier 32-bit arithmetic because if a borrow occurs in the low word, the subtraction of the high word will account for it
-
-	*/
-
-	// get the result
-	uint16_t result = 0xFFFF + *this->REG_A - right + (*this->STATUS & StatusConstants::carry);
-
-	// next, clear the appropriate bits in the status register
-	*this->STATUS &= 0xFF - (StatusConstants::negative + StatusConstants::overflow + StatusConstants::zero + StatusConstants::carry);
-
-	// next, if (result + right) == REG_A, we need to set the carry
-	if (result + right == *this->REG_A) {
-		*this->STATUS |= StatusConstants::carry;
-	}
-	// otherwise, set the overflow
-	else {
-		*this->STATUS |= StatusConstants::overflow;
-	}
-
-	// if the result was zero, set the Z flag
-	if (result == 0) {
-		*this->STATUS |= StatusConstants::zero;
-	}
-	// otherwise, we may need to set the N flag, if the MSB is set
-	else if (result & 0x8000) {
-		*this->STATUS |= StatusConstants::negative;
-	}
-	// if the result is not zero, but the MSB is not set, we are done
-
-	// set REG_A equal to result
-	*this->REG_A = result;
-
-	return;
-}
-
-void ALU::mult_unsigned(uint16_t right)
+void ALU::mult_unsigned(word_t right)
 {
 	// Perform unsigned multiplication on two values
+	this->flags->resolve();	// this may set V on top of the flags from a previous operation
 
 	// perform the multiplication
-	uint16_t result = *this->REG_A * right;
+	word_t result = *this->REG_A * right;
 
 	// check for integer overflow; we won't have overflow if the result is equal to REG_A divided by right
-	if (result / right == *this->REG_A) {
+	// multiplying by zero can't overflow (and would divide by zero in the check), so the result is simply zero
+	if ((right == 0) || (result / right == *this->REG_A)) {
 		*this->REG_A = result;
 	}
 	else {
@@ -125,7 +32,7 @@ void ALU::mult_unsigned(uint16_t right)
 	return;
 }
 
-void ALU::mult_signed(uint16_t right)
+void ALU::mult_signed(word_t right)
 {
 	/*
 	
@@ -133,24 +40,33 @@ void ALU::mult_signed(uint16_t right)
 	First, check to see if the sign bit is set for either value; if so, perform two's complement on that value
 		To convert from signed, simply flip all of the bits in the _signed_ notation and add 1
 		To convert to signed, subtract one and flip all of the bits
-		Note bits can be flipped simply by using XOR 0xFFFF (all 1s will become 0 and all 0s will become 1)
+		Note bits can be flipped simply by using XOR with a word of all 1s (all 1s will become 0 and all 0s will become 1)
 	Next, perform the multiplication
 	Next, check to see if the sign bit on the result is set; if so, we have integer overflow. Also, check to see if REG_A is equal to result / right
 	Finally, if exactly one of the sign bits was set, perform two's complement on the result; else, leave it
 
 	*/
 
-	bool left_signed = *this->REG_A & 0x8000;	// if the most significant bit is set, the value is signed
-	bool right_signed = right & 0x8000;
-	uint16_t result;
+	this->flags->resolve();	// this only updates N and V, so any pending flags must be written first
+
+	// multiplying by zero can't overflow, and the result is never negative; this also avoids dividing by zero in the overflow check below
+	if (right == 0) {
+		*this->REG_A = 0;
+		*this->STATUS &= (0xFF - StatusConstants::negative);
+		return;
+	}
+
+	bool left_signed = *this->REG_A & wordaccess::sign_bit;	// if the most significant bit is set, the value is signed
+	bool right_signed = right & wordaccess::sign_bit;
+	word_t result;
 
 	// perform twos complement, if necessary
 	if (left_signed) {
-		*this->REG_A ^= 0xFFFF;
+		*this->REG_A ^= wordaccess::word_max;
 		*this->REG_A += 1;
 	}
 	if (right_signed) {
-		right ^= 0xFFFF;
+		right ^= wordaccess::word_max;
 		right += 1;
 	}
 
@@ -158,7 +74,7 @@ void ALU::mult_signed(uint16_t right)
 	result = *this->REG_A * right;
 
 	// check to see if the MSB is set, or if REG_A is not equal to result / right
-	if ((result & 0x8000) || (result / right != *this->REG_A)) {
+	if ((result & wordaccess::sign_bit) || (result / right != *this->REG_A)) {
 		*this->STATUS |= StatusConstants::overflow;	// if so, set the overflow flag
 	}
 
@@ -169,7 +85,7 @@ void ALU::mult_signed(uint16_t right)
 	else {
 		// perform two's complement
 		*this->REG_A -= 1;
-		*this->REG_A ^= 0xFFFF;
+		*this->REG_A ^= wordaccess::word_max;
 
 		*this->STATUS |= StatusConstants::negative;	// set the negative flag
 	}
@@ -178,25 +94,25 @@ void ALU::mult_signed(uint16_t right)
 	return;
 }
 
-void ALU::div_unsigned(uint16_t right)
+void ALU::div_unsigned(word_t right)
 {
 	/*
 	
 	Perform unsigned division on two values, A_REG by 'right'.
 	It is not possible for there to be integer overflow/underflow on division, so we don't need to do what we did with multiplication.
 	The result of the operation will be stored in the A register, while the remainder from the operation will be stored in the B register.
-	If 'right' is equal to zero, set the U flag, load A and B with 0xFFFF, and continue
+	If 'right' is equal to zero, set the U flag, load A and B with all 1s, and continue
 	
 	*/
 
 	if (right == 0) {
 		*this->STATUS |= StatusConstants::undefined;
-		*this->REG_A = 0xFFFF;
-		*this->REG_B = 0xFFFF;
+		*this->REG_A = wordaccess::word_max;
+		*this->REG_B = wordaccess::word_max;
 	}
 	else {
-		uint16_t result = *this->REG_A / right;
-		uint16_t remainder = *this->REG_A % right;
+		word_t result = *this->REG_A / right;
+		word_t remainder = *this->REG_A % right;
 
 		*this->REG_A = result;
 		*this->REG_B = remainder;
@@ -205,7 +121,7 @@ void ALU::div_unsigned(uint16_t right)
 	return;
 }
 
-void ALU::div_signed(uint16_t right)
+void ALU::div_signed(word_t right)
 {
 	/*
 	
@@ -214,29 +130,31 @@ void ALU::div_signed(uint16_t right)
 		Next, perform the division
 		If the sign values of each number are the same, leave the result; else, use two's complement to convert the result.
 	
-	If the right value is zero, 0xFFFF is loaded into A and B registers and the U flag is set. 
+	If the right value is zero, all 1s are loaded into A and B registers and the U flag is set. 
 	
 	*/
 
+	this->flags->resolve();
+
 	if (right == 0) {
 		*this->STATUS |= StatusConstants::undefined;	// set the U flag
-		*this->REG_A = 0xFFFF;
-		*this->REG_B = 0xFFFF;
+		*this->REG_A = wordaccess::word_max;
+		*this->REG_B = wordaccess::word_max;
 	}
 	else {
-		bool left_signed = *this->REG_A & 0x8000;
-		bool right_signed = right & 0x8000;
+		bool left_signed = *this->REG_A & wordaccess::sign_bit;
+		bool right_signed = right & wordaccess::sign_bit;
 
 		if (left_signed) {
-			*this->REG_A ^= 0xFFFF;
+			*this->REG_A ^= wordaccess::word_max;
 			*this->REG_A += 1;
 		}
 		if (right_signed) {
-			right ^= 0xFFFF;
+			right ^= wordaccess::word_max;
 			right += 1;
 		}
 
-		uint16_t result = *this->REG_A / right;
+		word_t result = *this->REG_A / right;
 
 		/*
 		
@@ -247,7 +165,7 @@ void ALU::div_signed(uint16_t right)
 		
 		*/
 
-		uint16_t remainder = *this->REG_A - result * right;
+		word_t remainder = *this->REG_A - result * right;
 
 		if (left_signed == right_signed) {
 			*this->REG_A = result;
@@ -256,11 +174,11 @@ void ALU::div_signed(uint16_t right)
 		else {
 			// two's complement on the result
 			result -= 1;
-			result ^= 0xFFFF;
+			result ^= wordaccess::word_max;
 
 			// ...and on the remainder
 			remainder -= 1;
-			remainder ^= 0xFFFF;
+			remainder ^= wordaccess::word_max;
 
 			// update our registers
 			*this->REG_A = result;
@@ -272,7 +190,7 @@ void ALU::div_signed(uint16_t right)
 	return;
 }
 
-ALU::ALU(uint16_t * REG_A, uint16_t* REG_B, uint16_t * STATUS) : REG_A(REG_A), REG_B(REG_B), STATUS(STATUS)
+ALU::ALU(word_t* REG_A, word_t* REG_B, uint16_t* STATUS, LazyFlags* flags) : REG_A(REG_A), REG_B(REG_B), STATUS(STATUS), flags(flags)
 {
 }
 
@@ -281,6 +199,7 @@ ALU::ALU() {
 	this->REG_A = nullptr;
 	this->REG_B = nullptr;
 	this->STATUS = nullptr;
+	this->flags = nullptr;
 }
 
 ALU::~ALU()
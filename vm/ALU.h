@@ -14,6 +14,9 @@ Note this does not contain the FPU implementation; that can be found in FPU.h
 #include <cinttypes>
 #include "../util/DataWidths.h"
 #include "StatusConstants.h"
+#include "LazyFlags.h"
+#include "WordAccess.h"
+#include "Inline.h"
 
 
 class ALU {
@@ -21,27 +24,56 @@ class ALU {
 
 	Since the ALU will be modifying register values, we need pointers to the ones it can access
 	It only ever needs to access the accumulator (stores its values there), the B register (for storing remainders in divisions), and the STATUS register (it may need to update flags)
+	Additions and subtractions don't update the STATUS register themselves; they record their results in the VM's LazyFlags instead
 
 	*/
-	uint16_t* REG_A;
-	uint16_t* REG_B;
+	typedef wordaccess::vm_word word_t;
+
+	word_t* REG_A;
+	word_t* REG_B;
 	uint16_t* STATUS;
+	LazyFlags* flags;
 public:
 	/*
 	
 	All of the manipulation functions will be public. The left argument is always the A register (to which this object has a pointer), and the right argument is always supplied.
+	Additions and subtractions are executed by nearly every program's inner loops, so they are defined here, where the instruction handlers can inline them.
 	
 	*/
-	void add(uint16_t right);
-	void sub(uint16_t right);
 
-	void mult_unsigned(uint16_t right);
-	void mult_signed(uint16_t right);
+	// Adds 'right' to REG_A with carry. The flags (N, V, Z, and C) are not computed here; see PendingFlags::apply(...)
+	SIN_FORCE_INLINE void add(word_t right) {
+		word_t left = *this->REG_A;
+		word_t result = left + right + this->flags->get_carry();	// we add the value of the carry bit in
+
+		// record the operation so the flags can be computed when they are needed
+		this->flags->record(flagoperation::add, left, right, result);
+		*this->REG_A = result;
+	}
+
+	/*
+
+	Subtracts 'right' from REG_A with carry, storing the result in REG_A. Like add(...), the flags are computed by LazyFlags when they are needed.
+
+	Note the subtraction algorithm does not just subtract right from REG_A; if the carry bit is set, this will occur, but if it is clear, it indicates a borrow occurred and the result will be one less than expected.
+	This mode of operation allows for easier 32-bit arithmetic because if a borrow occurs in the low word, the subtraction of the high word will account for it
+
+	*/
+	SIN_FORCE_INLINE void sub(word_t right) {
+		word_t left = *this->REG_A;
+		word_t result = wordaccess::word_max + left - right + this->flags->get_carry();
+
+		this->flags->record(flagoperation::sub, left, right, result);
+		*this->REG_A = result;
+	}
+
+	void mult_unsigned(word_t right);
+	void mult_signed(word_t right);
 
-	void div_unsigned(uint16_t right);
-	void div_signed(uint16_t right);
+	void div_unsigned(word_t right);
+	void div_signed(word_t right);
 
-	ALU(uint16_t* REG_A, uint16_t* REG_B, uint16_t* STATUS);
+	ALU(word_t* REG_A, word_t* REG_B, uint16_t* STATUS, LazyFlags* flags);
 	ALU();
 	~ALU();
 };
@@ -0,0 +1,246 @@
+/*
+
+SIN Toolchain
+BatchRunner.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the BatchRunner class.
+
+*/
+
+#include "BatchRunner.h"
+
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+
+
+BatchJob::BatchJob() {
+	this->program = nullptr;
+	this->succeeded = false;
+}
+
+
+void BatchRunner::add_job(std::string program_name, std::string input_name) {
+	/*
+
+	Adds a job to the batch, loading its program and input now so that the workers only have to run it.
+	If either file can't be loaded, the job is still added -- it will fail with the reason when the results are written -- so that the other jobs may still run.
+
+	*/
+
+	BatchJob job;
+	job.program_name = program_name;
+	job.input_name = input_name;
+
+	try {
+		// load the program, unless another job has already loaded it
+		std::map<std::string, std::shared_ptr<const ProgramImage>>::iterator loaded = this->programs.find(program_name);
+		if (loaded != this->programs.end()) {
+			job.program = loaded->second;
+		}
+		else {
+			std::ifstream sml_file(program_name, std::ios::in | std::ios::binary);
+			if (!sml_file.is_open()) {
+				throw std::runtime_error("Cannot open file '" + program_name + "'");
+			}
+
+			job.program = std::make_shared<const ProgramImage>(sml_file);
+			this->programs[program_name] = job.program;
+		}
+
+		if (input_name != "") {
+			std::ifstream input_file(input_name, std::ios::in | std::ios::binary);
+			if (!input_file.is_open()) {
+				throw std::runtime_error("Cannot open file '" + input_name + "'");
+			}
+
+			job.input = std::string(std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>());
+		}
+	}
+	catch (std::exception& e) {
+		job.program = nullptr;
+		job.error = e.what();
+	}
+
+	this->jobs.push_back(job);
+}
+
+void BatchRunner::load_manifest(std::istream& manifest) {
+	// each line holds the name of a program, optionally followed by the name of its input file
+	std::string line;
+	while (std::getline(manifest, line)) {
+		std::istringstream fields(line);
+		std::string program_name;
+		std::string input_name;
+
+		fields >> program_name >> input_name;
+
+		// skip blank lines and comments
+		if ((program_name == "") || (program_name[0] == '#')) {
+			continue;
+		}
+
+		this->add_job(program_name, input_name);
+	}
+}
+
+
+bool BatchRunner::take_job(size_t worker, size_t& job) {
+	// take the most recently queued job from our own queue first
+	{
+		WorkQueue& own = *this->queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+
+	// our queue is empty, so steal the oldest job from another worker
+	for (size_t i = 1; i < this->queues.size(); i++) {
+		WorkQueue& victim = *this->queues[(worker + i) % this->queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+
+	// jobs are never added once the batch is running, so if every queue is empty, we are done
+	return false;
+}
+
+void BatchRunner::run_job(BatchJob& job, std::map<const ProgramImage*, SINVMPool*>& pools) {
+	if (job.program == nullptr) {
+		return;	// the error was recorded when the job was added
+	}
+
+	std::istringstream input(job.input);
+	std::ostringstream output;
+
+	try {
+		// get this worker's pool for the program, creating it the first time the program is run
+		SINVMPool* pool;
+		std::map<const ProgramImage*, SINVMPool*>::iterator found = pools.find(job.program.get());
+		if (found != pools.end()) {
+			pool = found->second;
+		}
+		else {
+			pool = new SINVMPool(job.program, this->dispatch_mode);
+			pools[job.program.get()] = pool;
+		}
+
+		SINVM* vm = pool->acquire();
+		vm->set_io(input, output);
+
+		try {
+			vm->run_program();
+			job.succeeded = true;
+		}
+		catch (std::exception& e) {
+			job.error = e.what();
+		}
+
+		// the VM must be returned even if the program failed; resetting it will undo whatever the program did
+		pool->release(vm);
+	}
+	catch (std::exception& e) {
+		// the VM couldn't be created
+		job.error = e.what();
+	}
+
+	job.output = output.str();
+}
+
+void BatchRunner::run_worker(size_t worker) {
+	std::map<const ProgramImage*, SINVMPool*> pools;	// one pool for every program this worker has run
+
+	size_t job;
+	while (this->take_job(worker, job)) {
+		this->run_job(this->jobs[job], pools);
+	}
+
+	for (std::map<const ProgramImage*, SINVMPool*>::iterator it = pools.begin(); it != pools.end(); it++) {
+		delete it->second;
+	}
+}
+
+void BatchRunner::run() {
+	size_t num_workers = (this->num_threads < this->jobs.size()) ? this->num_threads : this->jobs.size();
+	if (num_workers == 0) {
+		return;
+	}
+
+	// deal the jobs out to the workers; as they are taken from the back of each queue, reverse the order so that each worker starts with its earliest job
+	this->queues.clear();
+	for (size_t i = 0; i < num_workers; i++) {
+		this->queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	for (size_t i = this->jobs.size(); i > 0; i--) {
+		this->queues[(i - 1) % num_workers]->jobs.push_back(i - 1);
+	}
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < num_workers; i++) {
+		threads.push_back(std::thread(&BatchRunner::run_worker, this, i));
+	}
+	for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++) {
+		it->join();
+	}
+}
+
+void BatchRunner::write_results(std::ostream& output) {
+	for (size_t i = 0; i < this->jobs.size(); i++) {
+		BatchJob& job = this->jobs[i];
+
+		output << "==== Job " << std::dec << (i + 1) << ": " << job.program_name;
+		if (job.input_name != "") {
+			output << " < " << job.input_name;
+		}
+		output << " ====" << std::endl;
+
+		output << job.output;
+
+		if (!job.succeeded) {
+			output << "**** " << job.error << std::endl;
+		}
+	}
+}
+
+
+const std::vector<BatchJob>& BatchRunner::get_jobs() {
+	return this->jobs;
+}
+
+size_t BatchRunner::get_failure_count() {
+	size_t failures = 0;
+	for (std::vector<BatchJob>::iterator it = this->jobs.begin(); it != this->jobs.end(); it++) {
+		if (!it->succeeded) {
+			failures++;
+		}
+	}
+	return failures;
+}
+
+
+BatchRunner::BatchRunner(DispatchMode dispatch_mode, size_t num_threads) :
+	dispatch_mode(dispatch_mode),
+	num_threads(num_threads)
+{
+	if (this->num_threads == 0) {
+		this->num_threads = std::thread::hardware_concurrency();
+
+		// hardware_concurrency() may return 0 if it can't tell
+		if (this->num_threads == 0) {
+			this->num_threads = 1;
+		}
+	}
+}
+
+BatchRunner::~BatchRunner()
+{
+}
@@ -0,0 +1,82 @@
+/*
+
+SIN Toolchain
+BatchRunner.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the BatchRunner class, which runs a list of jobs -- each a .sml program along with the data to give it on its standard input -- on several threads at once.
+
+A manifest lists one job per line:
+	program.sml [input_file]
+Blank lines and lines beginning with '#' are ignored. If no input file is given, the job's standard input is empty.
+
+Each program is only loaded once, no matter how many jobs use it, and every job using it shares the same ProgramImage. Each worker thread keeps a SINVMPool for every program it has run, so a VM is only created the first time a thread runs a given program.
+Jobs are divided between the workers' queues up front. A worker takes jobs from the back of its own queue; once that is empty, it steals from the front of the others', so no thread sits idle while there is work left.
+Every job's STD_READ and STD_OUT (see SINVM::set_io(...)) go to its own buffers, and the results are kept in the order the jobs were submitted, regardless of the order in which they finished.
+Jobs have no access to the host's files; their VMs are never given a file root (see SINVM::set_file_root()), so opening a file generates a SINSIGSYS signal.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <istream>
+#include <ostream>
+
+#include "SINVM.h"
+#include "SINVMPool.h"
+
+
+struct BatchJob
+{
+	std::string program_name;
+	std::string input_name;	// empty if the job has no input file
+
+	std::shared_ptr<const ProgramImage> program;	// nullptr if the program couldn't be loaded
+	std::string input;	// the data given to the program's standard input
+
+	// the results of the job
+	std::string output;	// everything the program wrote to its standard output
+	std::string error;	// why the job failed, if it did
+	bool succeeded;
+
+	BatchJob();
+};
+
+
+class BatchRunner
+{
+	std::vector<BatchJob> jobs;
+	std::map<std::string, std::shared_ptr<const ProgramImage>> programs;	// every program loaded so far, by file name
+
+	DispatchMode dispatch_mode;
+	size_t num_threads;
+
+	// each worker's queue of job indices
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<size_t> jobs;
+	};
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+
+	bool take_job(size_t worker, size_t& job);	// get the next job for 'worker', stealing one if its queue is empty; returns false when no jobs are left
+	void run_worker(size_t worker);
+	void run_job(BatchJob& job, std::map<const ProgramImage*, SINVMPool*>& pools);
+public:
+	void add_job(std::string program_name, std::string input_name = "");
+	void load_manifest(std::istream& manifest);
+
+	void run();	// run every job, returning when all of them have finished
+	void write_results(std::ostream& output);	// write each job's results, in the order the jobs were added
+
+	const std::vector<BatchJob>& get_jobs();
+	size_t get_failure_count();
+
+	BatchRunner(DispatchMode dispatch_mode = SWITCH_DISPATCH, size_t num_threads = 0);	// if 'num_threads' is 0, one thread is used for each core
+	~BatchRunner();
+};
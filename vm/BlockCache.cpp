@@ -0,0 +1,267 @@
+/*
+
+SIN Toolchain
+BlockCache.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the VM's block cache, which is used when the VM runs with BLOCK_DISPATCH.
+
+Blocks are decoded lazily -- the first time the PC lands on an address in the program, the VM decodes instructions from that address up to (and including) the first one that may transfer control, and stores the list along with each instruction's handler. From then on, entering the block at that address calls the handlers for the whole list without fetching or decoding anything.
+On x86-64 hosts, the block is also compiled to machine code once it has been entered a few times (see BlockCompiler.h), and entering it runs the compiled code instead; execute_block(...) is used on other hosts, and wherever the host won't give the VM executable memory. If the VM's executable memory fills up, all of it is discarded, and blocks are compiled again as they are entered.
+
+The blocks are not used:
+	- for any instruction outside of the program (e.g., code copied onto the heap); these are fetched and executed one at a time
+	- whenever a block is left early; after every instruction, the VM checks that the PC is where the block expects it to be. If a signal was trapped (or a RESET was generated), the PC will have been moved to the handler, so the block is abandoned and execution continues from the new PC
+Whenever the program writes into memory covered by a block, the block is invalidated (see invalidate_block_cache(...)); if the block is currently executing, it is abandoned after the instruction that performed the write, and decoded again the next time it is entered.
+
+*/
+
+#include "SINVM.h"
+
+
+DecodedBlock::DecodedBlock() {
+	this->end = 0;
+	this->valid = false;
+#if defined(SIN_BLOCK_COMPILER)
+	this->code = nullptr;
+	this->entries = 0;
+#endif
+}
+
+
+bool SINVM::ends_block(uint8_t opcode) {
+	/*
+
+	Returns whether the given opcode terminates a block; these are the instructions that may transfer control somewhere other than the next instruction
+
+	*/
+
+	switch (opcode) {
+		case JMP: case BRNE: case BREQ: case BRGT: case BRLT: case BRZ: case BRN: case BRPL:
+		case JSR: case RTS:
+		case SYSCALL: case BRK: case RESET: case HALT:
+		case IRQ: case RTI:
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+void SINVM::decode_block(word_t address, DecodedBlock& block) {
+	/*
+
+	Decodes the block beginning at 'address' into 'block'.
+
+	*/
+
+	size_t cache_end = _PRG_BOTTOM + this->block_cache.size();
+	size_t current = address;
+
+	block.instructions.clear();
+
+	// a block always holds at least one instruction
+	do {
+		DecodedInstruction instruction;
+		this->decode_instruction((word_t)current, instruction);
+		block.instructions.push_back(instruction);
+
+		// mark the bytes as covered by a block so that writes to them will invalidate it
+		for (size_t i = current; i < current + instruction.length && i < cache_end; i++) {
+			this->block_coverage[i - _PRG_BOTTOM] = true;
+		}
+
+		current += instruction.length;
+
+		if (ends_block(instruction.opcode)) {
+			break;
+		}
+	} while ((current < cache_end) && (current - address < decodedblock::max_block_bytes));
+
+	block.end = (word_t)current;
+	block.valid = true;
+#if defined(SIN_BLOCK_COMPILER)
+	block.code = nullptr;	// any code for the old contents of the block is abandoned
+	block.entries = 0;
+#endif
+}
+
+
+void SINVM::execute_block(DecodedBlock& block, int64_t& budget) {
+	/*
+
+	Executes the instructions in 'block' until the end of the block, until control leaves it, or until the budget runs out.
+	Each handler expects the PC to point to the last byte of its instruction, and the PC is incremented after it returns -- the same as in the other dispatch loops.
+
+	*/
+
+	for (std::vector<DecodedInstruction>::iterator it = block.instructions.begin(); it != block.instructions.end(); it++) {
+		word_t next_address = this->PC + it->length;
+
+		this->cycles += it->cycles;
+		this->PC += it->length - 1;
+		it->handler(*this, *it);
+		this->PC++;
+		budget -= it->fused;
+
+		// leave the block if control was transferred, if the block was overwritten, if the VM was halted, or if we are out of instructions; the next block will begin at the PC
+		if ((this->PC != next_address) || !block.valid || this->is_halted() || (budget <= 0)) {
+			return;
+		}
+	}
+}
+
+
+#if defined(SIN_BLOCK_COMPILER)
+bool SINVM::call_block_handler(SINVM* vm, const DecodedInstruction* instruction) {
+	/*
+
+	Calls the handler for 'instruction'; used by compiled blocks, which have no unwind information for an exception to pass through.
+	Returns true if the handler threw, keeping what it threw so that run_compiled_block(...) can throw it again once the block has returned.
+
+	*/
+
+	try {
+		instruction->handler(*vm, *instruction);
+		return false;
+	}
+	catch (...) {
+		vm->block_exception = std::current_exception();
+		return true;
+	}
+}
+
+
+void SINVM::compile_block(DecodedBlock& block) {
+	/*
+
+	Compiles 'block', which begins at the PC. If the executable memory is full, every compiled block is discarded to make room.
+
+	*/
+
+	block.code = this->block_compiler.compile(*this, block, this->PC);
+
+	if (block.code == nullptr) {
+		this->block_compiler.clear();
+		for (std::vector<DecodedBlock>::iterator it = this->block_cache.begin(); it != this->block_cache.end(); it++) {
+			it->code = nullptr;
+		}
+
+		block.code = this->block_compiler.compile(*this, block, this->PC);
+	}
+}
+
+
+void SINVM::run_compiled_block(DecodedBlock& block, int64_t& budget) {
+	/*
+
+	Runs the compiled code for 'block'; the equivalent of execute_block(...).
+
+	*/
+
+	this->block_budget = budget;
+	block.code(this);
+	budget = this->block_budget;
+
+	if (this->block_exception) {
+		std::exception_ptr thrown = this->block_exception;
+		this->block_exception = nullptr;
+		std::rethrow_exception(thrown);
+	}
+}
+#endif
+
+
+void SINVM::invalidate_block_cache(size_t address, size_t num_bytes) {
+	/*
+
+	Invalidates every cached block that includes any of the 'num_bytes' bytes starting at 'address'.
+	Most writes into the program range are to its data section, which is never part of a block, so we first check whether any of the written bytes belong to a block at all.
+
+	*/
+
+	size_t cache_end = _PRG_BOTTOM + this->block_cache.size();
+
+	// if the write doesn't touch the cached range at all, there is nothing to do
+	if ((address + num_bytes <= _PRG_BOTTOM) || (address >= cache_end)) {
+		return;
+	}
+
+	size_t write_begin = (address > _PRG_BOTTOM) ? address : _PRG_BOTTOM;
+	size_t write_end = (address + num_bytes < cache_end) ? address + num_bytes : cache_end;
+
+	bool covered = false;
+	for (size_t i = write_begin; i < write_end && !covered; i++) {
+		covered = this->block_coverage[i - _PRG_BOTTOM];
+	}
+
+	if (!covered) {
+		return;
+	}
+
+	// a block is shorter than max_block_bytes plus the length of its last instruction, which may be a fused instruction
+	size_t lookback = decodedblock::max_block_bytes + fusion::max_fused_bytes;
+	size_t first = (write_begin >= _PRG_BOTTOM + lookback) ? write_begin - lookback : _PRG_BOTTOM;
+
+	for (size_t i = first; i < write_end; i++) {
+		DecodedBlock& block = this->block_cache[i - _PRG_BOTTOM];
+		if (block.valid && (block.end > write_begin)) {
+			block.valid = false;
+		}
+	}
+}
+
+
+void SINVM::run_block_dispatch(int64_t& budget) {
+	/*
+
+	The main loop for BLOCK_DISPATCH.
+	The block cache is only allocated the first time this loop runs, as the other dispatch modes have no use for it.
+
+	*/
+
+	if (this->block_cache.size() != this->decode_cache_size) {
+		this->block_cache = std::vector<DecodedBlock>(this->decode_cache_size);
+		this->block_coverage = std::vector<bool>(this->decode_cache_size, false);
+#if defined(SIN_BLOCK_COMPILER)
+		this->block_compiler.clear();	// the compiled code refers to the old blocks
+#endif
+	}
+
+	while (!(this->is_halted()) && (budget > 0)) {
+		size_t index = (size_t)this->PC - _PRG_BOTTOM;	// will wrap around (and fail the check below) if the PC is below the program
+
+		if (index < this->block_cache.size()) {
+			DecodedBlock& block = this->block_cache[index];
+			if (!block.valid) {
+				this->decode_block(this->PC, block);
+			}
+#if defined(SIN_BLOCK_COMPILER)
+			if ((block.code == nullptr) && this->block_compiler.is_available()) {
+				if (block.entries < blockcompiler::compile_threshold) {
+					block.entries++;
+				}
+				else {
+					this->compile_block(block);
+				}
+			}
+			if (block.code != nullptr) {
+				this->run_compiled_block(block, budget);
+				continue;
+			}
+#endif
+			this->execute_block(block, budget);
+		}
+		else {
+			// outside of the program, fall back to interpreting one instruction at a time
+			const DecodedInstruction& instruction = this->fetch_instruction();
+			this->cycles += instruction.cycles;
+			this->PC += instruction.length - 1;
+			instruction.handler(*this, instruction);
+			this->PC++;
+			budget -= instruction.fused;
+		}
+	}
+
+	return;
+}
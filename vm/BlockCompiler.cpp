@@ -0,0 +1,872 @@
+/*
+
+SIN Toolchain
+BlockCompiler.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the BlockCompiler class.
+
+A compiled block is a function taking the VM; it keeps the VM's address in RBX, and addresses the registers and the PC relative to it. The cycle counter and the budget (SINVM::block_budget) are kept in R13 and R12 while the block runs, and written back before a handler is called (which may read or add to the cycle count) and when the block returns. Every address in the block is known when it is compiled, so the PC is written as a constant rather than being read and incremented. For each instruction, the code:
+	1) adds the instruction's cycles to the counter
+	2) executes the instruction, either with x86 instructions of its own (see below) or by calling the handler through SINVM::call_block_handler(...) with the PC on the last byte of the instruction, then incrementing the PC -- the same as the other dispatch loops
+	3) subtracts the instructions it executed from the budget
+	4) returns if the budget has run out; after a call to a handler, it also returns if control left the block, the block was overwritten, or the VM was halted
+
+The instructions compiled to x86 are:
+	- register transfers, INC and DEC on a register, NOOP, and JMP to an absolute address
+	- loads, ANDA, ORA, XORA, ADDCA, SUBCA, and the comparisons, with immediate, B, absolute, or X/Y-indexed addressing
+	- stores, with absolute or X/Y-indexed addressing
+ADDCA, SUBCA, and the comparisons record their operands in the VM's PendingFlags, exactly as ALU::add, ALU::sub, and SINVM::compare_values do (see LazyFlags.h); the carry is read from the pending flags in the same way as LazyFlags::get_carry(). A comparison made while another is still pending has to write the first one's flags to STATUS; the compiled code does this itself if no arithmetic is pending as well.
+A load or store looks up the page permissions (see PagePermissions.h) and the page itself in the VM's tables, and swaps the bytes of the word as wordaccess::load and wordaccess::store do. Only the common case is handled this way: a word within a single page, which the program may access, and which isn't guarded; for a store, a page the VM already has its own copy of, outside of the program (whose decoded forms would have to be invalidated). Anything else -- including every access that generates a signal -- goes to the handler, before the instruction has changed anything.
+None of these can generate a signal or halt the VM, and none of them leaves the block except for JMP, so only the budget needs checking after them.
+
+Handlers may throw (e.g., on a segmentation violation), but the compiled code has no unwind information, so an exception must not pass through it. SINVM::call_block_handler(...) catches anything the handler throws and returns true, at which point the block returns and the VM throws it again.
+
+The executable memory is writable only while a block is being copied into it.
+
+*/
+
+#include "BlockCompiler.h"
+
+#if defined(SIN_BLOCK_COMPILER)
+
+#include "SINVM.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+namespace {
+	// the registers the compiled code uses, as the reg field of a ModRM byte
+	const uint8_t rax = 0;
+	const uint8_t rcx = 1;
+	const uint8_t rdx = 2;
+
+	// R12 (the budget) and R13 (the cycle counter), which also need REX.R or REX.B
+	const uint8_t r12 = 4;
+	const uint8_t r13 = 5;
+
+	// condition codes for the jcc instructions (0F 8x), and the jmp instruction
+	const uint8_t jump_if_below = 0x82;
+	const uint8_t jump_if_above_or_equal = 0x83;
+	const uint8_t jump_if_equal = 0x84;
+	const uint8_t jump_if_not_equal = 0x85;
+	const uint8_t jump_if_above = 0x87;
+	const uint8_t jump_if_less_or_equal = 0x8E;
+	const uint8_t jump_always = 0xE9;
+
+	// whether the compiled code reads an operand with this addressing mode itself
+	bool is_native_operand(uint8_t addressing_mode) {
+		return (addressing_mode == addressingmode::immediate) || (addressing_mode == addressingmode::reg_b) || (addressing_mode == addressingmode::absolute) ||
+			(addressing_mode == addressingmode::x_index) || (addressing_mode == addressingmode::y_index);
+	}
+
+	// whether the compiled code writes to memory with this addressing mode itself
+	bool is_native_store(uint8_t addressing_mode) {
+		return (addressing_mode == addressingmode::absolute) || (addressing_mode == addressingmode::x_index) || (addressing_mode == addressingmode::y_index);
+	}
+
+	// the offset of a member of the VM from the start of it
+	int32_t member_offset(const SINVM& vm, const void* member) {
+		return (int32_t)((const uint8_t*)member - (const uint8_t*)&vm);
+	}
+}
+
+
+struct BlockCompiler::Layout {
+	// the offsets of the VM's registers and counters
+	int32_t pc;
+	int32_t status;
+	int32_t cycles;
+	int32_t budget;
+	int32_t reg_a;
+	int32_t reg_b;
+	int32_t reg_x;
+	int32_t reg_y;
+	int32_t sp;
+
+	// the offsets of the pending flags; see LazyFlags.h
+	int32_t operation;
+	int32_t left;
+	int32_t right;
+	int32_t result;
+	int32_t compare_pending;
+	int32_t compare_left;
+	int32_t compare_right;
+
+	// the offsets of the page tables; in the 32-bit VM, these are the directories, and in the 16-bit VM, the first (and only) tables
+	int32_t page_permissions;
+	int32_t read_pages;
+	int32_t write_pages;
+
+	// a store to any address from program_begin up to (but not including) program_end writes over part of the program
+	uint32_t program_begin;
+	uint32_t program_end;
+};
+
+
+void BlockCompiler::emit(uint8_t byte) {
+	this->emitted.push_back(byte);
+}
+
+void BlockCompiler::emit_u16(uint16_t value) {
+	this->emit((uint8_t)(value & 0xFF));
+	this->emit((uint8_t)(value >> 8));
+}
+
+void BlockCompiler::emit_u32(uint32_t value) {
+	this->emit_u16((uint16_t)(value & 0xFFFF));
+	this->emit_u16((uint16_t)(value >> 16));
+}
+
+void BlockCompiler::emit_u64(uint64_t value) {
+	this->emit_u32((uint32_t)(value & 0xFFFFFFFF));
+	this->emit_u32((uint32_t)(value >> 32));
+}
+
+void BlockCompiler::emit_word(uint32_t value) {
+	if (sizeof(SINVM::word_t) == 2) {
+		this->emit_u16((uint16_t)value);
+	}
+	else {
+		this->emit_u32(value);
+	}
+}
+
+void BlockCompiler::emit_word_prefix() {
+	if (sizeof(SINVM::word_t) == 2) {
+		this->emit(0x66);
+	}
+}
+
+void BlockCompiler::emit_member(uint8_t opcode, uint8_t reg, int32_t offset) {
+	// [rbx + disp32]
+	this->emit(opcode);
+	this->emit((uint8_t)(0x80 | (reg << 3) | 0x03));
+	this->emit_u32((uint32_t)offset);
+}
+
+void BlockCompiler::emit_indexed_member(uint8_t opcode, uint8_t reg, uint8_t index, uint8_t scale, int32_t offset) {
+	// [rbx + index*scale + disp32]
+	this->emit(opcode);
+	this->emit((uint8_t)(0x84 | (reg << 3)));
+	this->emit((uint8_t)(((scale == 8) ? 0xC0 : 0x00) | (index << 3) | 0x03));
+	this->emit_u32((uint32_t)offset);
+}
+
+void BlockCompiler::emit_load(uint8_t reg, int32_t offset) {
+	if (sizeof(SINVM::word_t) == 2) {
+		// movzx reg, word [member]
+		this->emit(0x0F);
+		this->emit_member(0xB7, reg, offset);
+	}
+	else {
+		// mov reg, dword [member]
+		this->emit_member(0x8B, reg, offset);
+	}
+}
+
+void BlockCompiler::emit_store(uint8_t reg, int32_t offset) {
+	// mov word [member], reg
+	this->emit_word_prefix();
+	this->emit_member(0x89, reg, offset);
+}
+
+size_t BlockCompiler::emit_jump(uint8_t condition) {
+	if (condition == jump_always) {
+		this->emit(jump_always);
+	}
+	else {
+		this->emit(0x0F);
+		this->emit(condition);
+	}
+
+	size_t jump = this->emitted.size();
+	this->emit_u32(0);	// filled in once the target is placed
+	return jump;
+}
+
+void BlockCompiler::place_jump(size_t jump) {
+	uint32_t displacement = (uint32_t)(this->emitted.size() - (jump + 4));
+	memcpy(&this->emitted[jump], &displacement, sizeof(displacement));
+}
+
+void BlockCompiler::emit_exit_jump(uint8_t condition) {
+	this->exit_jumps.push_back(this->emit_jump(condition));
+}
+
+void BlockCompiler::emit_fallback_jump(uint8_t condition) {
+	this->fallback_jumps.push_back(this->emit_jump(condition));
+}
+
+
+void BlockCompiler::emit_address(const Layout& layout, const DecodedInstruction& instruction) {
+	// the address an absolute or indexed operand refers to, in EAX
+
+	// mov eax, operand
+	this->emit(0xB8);
+	this->emit_u32((uint32_t)instruction.operand);
+
+	if (instruction.addressing_mode != addressingmode::absolute) {
+		// add eax, word [index]; the address wraps around as a word does, so in the 16-bit VM, this is add ax, word [index] and movzx eax, ax
+		this->emit_word_prefix();
+		this->emit_member(0x03, rax, (instruction.addressing_mode == addressingmode::x_index) ? layout.reg_x : layout.reg_y);
+		if (sizeof(SINVM::word_t) == 2) {
+			this->emit(0x0F); this->emit(0xB7); this->emit(0xC0);
+		}
+	}
+}
+
+void BlockCompiler::emit_page(const Layout& layout, uint8_t permission) {
+	/*
+
+	For the address in EAX, leaves the page in RCX and the offset into it in EAX -- if the word at the address lies within a single page the program may access in the way given by 'permission'; if not, jumps to the handler.
+	This is SINVM::access_is_valid(...) followed by get_read_page(...) or get_write_page(...), except that a guarded page or a word that runs over the end of a page is always left to the handler.
+
+	*/
+
+#if SIN_WORDSIZE == 32
+	// cmp eax, memory_size; jae fallback
+	this->emit(0x3D);
+	this->emit_u32((uint32_t)memory_size);
+	this->emit_fallback_jump(jump_if_above_or_equal);
+#endif
+
+	// movzx ecx, al; cmp ecx, page_size - word size; ja fallback
+	this->emit(0x0F); this->emit(0xB6); this->emit(0xC8);
+	this->emit(0x81); this->emit(0xF9);
+	this->emit_u32((uint32_t)(pagepermission::page_size - sizeof(SINVM::word_t)));
+	this->emit_fallback_jump(jump_if_above);
+
+	// mov edx, eax; shr edx, page_shift -- the page number
+	this->emit(0x89); this->emit(0xC2);
+	this->emit(0xC1); this->emit(0xEA); this->emit((uint8_t)pagepermission::page_shift);
+
+#if SIN_WORDSIZE == 32
+	// mov ecx, edx; shr ecx, table_page_shift; mov rcx, qword [rbx + rcx*8 + page_permissions] -- the table
+	this->emit(0x89); this->emit(0xD1);
+	this->emit(0xC1); this->emit(0xE9); this->emit((uint8_t)pagepermission::table_page_shift);
+	this->emit(0x48);
+	this->emit_indexed_member(0x8B, rcx, rcx, 8, layout.page_permissions);
+
+	// movzx r8d, dl; movzx ecx, byte [rcx + r8] -- the page's entry in it
+	this->emit(0x44); this->emit(0x0F); this->emit(0xB6); this->emit(0xC2);
+	this->emit(0x42); this->emit(0x0F); this->emit(0xB6); this->emit(0x0C); this->emit(0x01);
+#else
+	// movzx ecx, byte [rbx + rdx + page_permissions]
+	this->emit(0x0F);
+	this->emit_indexed_member(0xB6, rcx, rdx, 1, layout.page_permissions);
+#endif
+
+	// and ecx, permission | guarded; cmp ecx, permission; jne fallback
+	this->emit(0x83); this->emit(0xE1); this->emit(permission | pagepermission::guarded);
+	this->emit(0x83); this->emit(0xF9); this->emit(permission);
+	this->emit_fallback_jump(jump_if_not_equal);
+
+	int32_t pages = (permission == pagepermission::write) ? layout.write_pages : layout.read_pages;
+#if SIN_WORDSIZE == 32
+	// mov ecx, edx; shr ecx, table_page_shift; mov rcx, qword [rbx + rcx*8 + pages]; mov rcx, qword [rcx + r8*8]
+	this->emit(0x89); this->emit(0xD1);
+	this->emit(0xC1); this->emit(0xE9); this->emit((uint8_t)pagepermission::table_page_shift);
+	this->emit(0x48);
+	this->emit_indexed_member(0x8B, rcx, rcx, 8, pages);
+	this->emit(0x4A); this->emit(0x8B); this->emit(0x0C); this->emit(0xC1);
+#else
+	// mov rcx, qword [rbx + rdx*8 + pages]
+	this->emit(0x48);
+	this->emit_indexed_member(0x8B, rcx, rdx, 8, pages);
+#endif
+
+	if (permission == pagepermission::write) {
+		// if the VM doesn't have its own copy of the page yet, the handler makes one; test rcx, rcx; jz fallback
+		this->emit(0x48); this->emit(0x85); this->emit(0xC9);
+		this->emit_fallback_jump(jump_if_equal);
+	}
+
+	// movzx eax, al
+	this->emit(0x0F); this->emit(0xB6); this->emit(0xC0);
+}
+
+void BlockCompiler::emit_operand(const Layout& layout, const DecodedInstruction& instruction) {
+	// the operand of an instruction, as load_operand<mode>(...) would return it, in EAX
+
+	if (instruction.addressing_mode == addressingmode::immediate) {
+		// mov eax, operand
+		this->emit(0xB8);
+		this->emit_u32((uint32_t)instruction.operand);
+	}
+	else if (instruction.addressing_mode == addressingmode::reg_b) {
+		this->emit_load(rax, layout.reg_b);
+	}
+	else {
+		this->emit_address(layout, instruction);
+		this->emit_page(layout, pagepermission::read);
+
+		if (sizeof(SINVM::word_t) == 2) {
+			// movzx eax, word [rcx + rax]; rol ax, 8
+			this->emit(0x0F); this->emit(0xB7); this->emit(0x04); this->emit(0x01);
+			this->emit(0x66); this->emit(0xC1); this->emit(0xC0); this->emit(0x08);
+		}
+		else {
+			// mov eax, dword [rcx + rax]; bswap eax
+			this->emit(0x8B); this->emit(0x04); this->emit(0x01);
+			this->emit(0x0F); this->emit(0xC8);
+		}
+	}
+}
+
+void BlockCompiler::emit_carry(const Layout& layout) {
+	// the carry, as LazyFlags::get_carry() would return it, in ECX (as 0 or 1); leaves EAX alone
+
+	// if a comparison is pending and its values differ, it decides the carry
+	// cmp byte [compare_pending], 0; je no_comparison
+	this->emit_member(0x80, 7, layout.compare_pending);
+	this->emit(0x00);
+	size_t no_comparison = this->emit_jump(jump_if_equal);
+
+	// cmp compare_left, compare_right; je no_comparison; seta cl; movzx ecx, cl; jmp done
+	this->emit_load(rcx, layout.compare_left);
+	this->emit_word_prefix();
+	this->emit_member(0x3B, rcx, layout.compare_right);
+	size_t equal = this->emit_jump(jump_if_equal);
+	this->emit(0x0F); this->emit(0x97); this->emit(0xC1);
+	this->emit(0x0F); this->emit(0xB6); this->emit(0xC9);
+	size_t from_comparison = this->emit_jump(jump_always);
+
+	this->place_jump(no_comparison);
+	this->place_jump(equal);
+
+	// movzx ecx, byte [operation]; cmp ecx, add; je from_add; cmp ecx, sub; je from_sub
+	this->emit(0x0F);
+	this->emit_member(0xB6, rcx, layout.operation);
+	this->emit(0x83); this->emit(0xF9); this->emit(flagoperation::add);
+	size_t from_add = this->emit_jump(jump_if_equal);
+	this->emit(0x83); this->emit(0xF9); this->emit(flagoperation::sub);
+	size_t from_sub = this->emit_jump(jump_if_equal);
+
+	// nothing is pending, so the carry is in STATUS; movzx ecx, word [status]; and ecx, carry; jmp done
+	this->emit(0x0F);
+	this->emit_member(0xB7, rcx, layout.status);
+	this->emit(0x83); this->emit(0xE1); this->emit(StatusConstants::carry);
+	size_t from_status = this->emit_jump(jump_always);
+
+	// after an addition, the carry is set if the result isn't zero and (result - right) isn't equal to the left operand
+	// test ecx, ecx (the result); je done; sub rcx, rdx; cmp rcx, rdx; setne cl; movzx ecx, cl; jmp done
+	this->place_jump(from_add);
+	this->emit_load(rcx, layout.result);
+	this->emit(0x85); this->emit(0xC9);
+	size_t zero_result = this->emit_jump(jump_if_equal);
+	this->emit_load(rdx, layout.right);
+	this->emit(0x48); this->emit(0x29); this->emit(0xD1);
+	this->emit_load(rdx, layout.left);
+	this->emit(0x48); this->emit(0x39); this->emit(0xD1);
+	this->emit(0x0F); this->emit(0x95); this->emit(0xC1);
+	this->emit(0x0F); this->emit(0xB6); this->emit(0xC9);
+	size_t from_addition = this->emit_jump(jump_always);
+
+	// after a subtraction, it is set if (result + right) is equal to the left operand; add rcx, rdx; cmp rcx, rdx; sete cl; movzx ecx, cl
+	this->place_jump(from_sub);
+	this->emit_load(rcx, layout.result);
+	this->emit_load(rdx, layout.right);
+	this->emit(0x48); this->emit(0x01); this->emit(0xD1);
+	this->emit_load(rdx, layout.left);
+	this->emit(0x48); this->emit(0x39); this->emit(0xD1);
+	this->emit(0x0F); this->emit(0x94); this->emit(0xC1);
+	this->emit(0x0F); this->emit(0xB6); this->emit(0xC9);
+
+	this->place_jump(from_comparison);
+	this->place_jump(from_status);
+	this->place_jump(zero_result);
+	this->place_jump(from_addition);
+}
+
+void BlockCompiler::emit_handler_call(const Layout& layout, const DecodedInstruction& instruction, uint32_t next_address, bool last, const bool* valid) {
+	// execute the instruction by calling its handler, then check whether the block may continue
+
+	// mov word [pc], <the last byte of the instruction>; mov qword [cycles], r13
+	this->emit_word_prefix();
+	this->emit_member(0xC7, 0, layout.pc);
+	this->emit_word((SINVM::word_t)(next_address - 1));
+	this->emit(0x4C);
+	this->emit_member(0x89, r13, layout.cycles);
+
+	// call SINVM::call_block_handler(vm, &instruction); if it returns true, the handler threw
+#if defined(_WIN32)
+	this->emit(0x48); this->emit(0x89); this->emit(0xD9);	// mov rcx, rbx
+	this->emit(0x48); this->emit(0xBA);	// mov rdx, imm64
+#else
+	this->emit(0x48); this->emit(0x89); this->emit(0xDF);	// mov rdi, rbx
+	this->emit(0x48); this->emit(0xBE);	// mov rsi, imm64
+#endif
+	this->emit_u64((uint64_t)(uintptr_t)&instruction);
+	this->emit(0x48); this->emit(0xB8);	// mov rax, imm64
+	this->emit_u64((uint64_t)(uintptr_t)&SINVM::call_block_handler);
+	this->emit(0xFF); this->emit(0xD0);	// call rax
+	this->emit(0x4C);
+	this->emit_member(0x8B, r13, layout.cycles);	// mov r13, qword [cycles]
+	this->emit(0x84); this->emit(0xC0);	// test al, al
+	this->emit_exit_jump(jump_if_not_equal);
+
+	// add word [pc], 1
+	this->emit_word_prefix();
+	this->emit_member(0x83, 0, layout.pc);
+	this->emit(0x01);
+
+	// sub r12, fused; jle exit
+	this->emit(0x49); this->emit(0x81); this->emit(0xEC);
+	this->emit_u32(instruction.fused);
+	this->emit_exit_jump(jump_if_less_or_equal);
+
+	// the end of the block is the exit anyway
+	if (!last) {
+		// cmp word [pc], next_address; jne exit
+		this->emit_word_prefix();
+		this->emit_member(0x81, 7, layout.pc);
+		this->emit_word(next_address);
+		this->emit_exit_jump(jump_if_not_equal);
+
+		// mov rax, &block.valid; cmp byte [rax], 0; je exit
+		this->emit(0x48); this->emit(0xB8);
+		this->emit_u64((uint64_t)(uintptr_t)valid);
+		this->emit(0x80); this->emit(0x38); this->emit(0x00);
+		this->emit_exit_jump(jump_if_equal);
+
+		// test word [status], halt; jnz exit
+		this->emit(0x66);
+		this->emit_member(0xF7, 0, layout.status);
+		this->emit_u16(StatusConstants::halt);
+		this->emit_exit_jump(jump_if_not_equal);
+	}
+}
+
+
+bool BlockCompiler::allocate() {
+	/*
+
+	Allocates the executable memory, as read/write for now; false if the host won't give it to us.
+
+	*/
+
+#if defined(_WIN32)
+	void* memory = VirtualAlloc(NULL, blockcompiler::code_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (memory == NULL) {
+		return false;
+	}
+#else
+	void* memory = mmap(nullptr, blockcompiler::code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return false;
+	}
+#endif
+
+	this->code = (uint8_t*)memory;
+	this->protect(false);
+	return true;
+}
+
+void BlockCompiler::protect(bool writable) {
+	/*
+
+	Makes the executable memory writable (and not executable) while a block is copied into it, and executable (and not writable) otherwise.
+
+	*/
+
+#if defined(_WIN32)
+	DWORD previous;
+	VirtualProtect(this->code, blockcompiler::code_size, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &previous);
+	if (!writable) {
+		FlushInstructionCache(GetCurrentProcess(), this->code, blockcompiler::code_size);
+	}
+#else
+	mprotect(this->code, blockcompiler::code_size, writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC));
+#endif
+}
+
+bool BlockCompiler::is_available() {
+	if ((this->code == nullptr) && !this->unavailable) {
+		this->unavailable = !this->allocate();
+	}
+
+	return !this->unavailable;
+}
+
+
+CompiledBlock BlockCompiler::compile(SINVM& vm, const DecodedBlock& block, uint32_t address) {
+	/*
+
+	Compiles 'block', which begins at 'address', and copies it into the executable memory; see above for the code it generates.
+	Returns nullptr if the block doesn't fit in what is left of the executable memory.
+
+	*/
+
+	typedef SINVM::word_t word_t;
+
+	const PendingFlags& pending = vm.flags.get_pending();
+
+	Layout layout;
+	layout.pc = member_offset(vm, &vm.PC);
+	layout.status = member_offset(vm, &vm.STATUS);
+	layout.cycles = member_offset(vm, &vm.cycles);
+	layout.budget = member_offset(vm, &vm.block_budget);
+	layout.reg_a = member_offset(vm, &vm.REG_A);
+	layout.reg_b = member_offset(vm, &vm.REG_B);
+	layout.reg_x = member_offset(vm, &vm.REG_X);
+	layout.reg_y = member_offset(vm, &vm.REG_Y);
+	layout.sp = member_offset(vm, &vm.SP);
+	layout.operation = member_offset(vm, &pending.operation);
+	layout.left = member_offset(vm, &pending.left);
+	layout.right = member_offset(vm, &pending.right);
+	layout.result = member_offset(vm, &pending.result);
+	layout.compare_pending = member_offset(vm, &pending.compare_pending);
+	layout.compare_left = member_offset(vm, &pending.compare_left);
+	layout.compare_right = member_offset(vm, &pending.compare_right);
+#if SIN_WORDSIZE == 32
+	layout.page_permissions = member_offset(vm, &vm.page_permissions);
+	layout.read_pages = member_offset(vm, &vm.read_pages);
+	layout.write_pages = member_offset(vm, &vm.write_pages);
+#else
+	layout.page_permissions = member_offset(vm, &vm.first_page_permissions);
+	layout.read_pages = member_offset(vm, &vm.first_read_pages);
+	layout.write_pages = member_offset(vm, &vm.first_write_pages);
+#endif
+	layout.program_begin = (uint32_t)(_PRG_BOTTOM - sizeof(word_t) + 1);
+	layout.program_end = (uint32_t)(_PRG_BOTTOM + vm.decode_cache_size);
+
+	this->emitted.clear();
+	this->exit_jumps.clear();
+
+	// push rbx; push r12; push r13; mov rbx, <the VM>; sub rsp, 32 -- which leaves the stack aligned for calls, with the shadow space Windows expects
+	this->emit(0x53);
+	this->emit(0x41); this->emit(0x54);
+	this->emit(0x41); this->emit(0x55);
+#if defined(_WIN32)
+	this->emit(0x48); this->emit(0x89); this->emit(0xCB);	// mov rbx, rcx
+#else
+	this->emit(0x48); this->emit(0x89); this->emit(0xFB);	// mov rbx, rdi
+#endif
+	this->emit(0x48); this->emit(0x83); this->emit(0xEC); this->emit(0x20);
+
+	// mov r12, qword [budget]; mov r13, qword [cycles]
+	this->emit(0x4C);
+	this->emit_member(0x8B, r12, layout.budget);
+	this->emit(0x4C);
+	this->emit_member(0x8B, r13, layout.cycles);
+
+	word_t current = (word_t)address;
+	for (std::vector<DecodedInstruction>::const_iterator it = block.instructions.begin(); it != block.instructions.end(); it++) {
+		word_t next_address = (word_t)(current + it->length);
+		bool last = (it + 1) == block.instructions.end();
+
+		// add r13, imm32
+		this->emit(0x49); this->emit(0x81); this->emit(0xC5);
+		this->emit_u32(it->cycles);
+
+		// the register an instruction compiled to x86 works on, and the register it reads (for a transfer); -1 if it doesn't use one
+		int32_t target = -1;
+		int32_t source = -1;
+		bool native = it->fused == 1;
+
+		if (native) {
+			switch (it->opcode) {
+				case TAB: source = layout.reg_a; target = layout.reg_b; break;
+				case TAX: source = layout.reg_a; target = layout.reg_x; break;
+				case TAY: source = layout.reg_a; target = layout.reg_y; break;
+				case TASP: source = layout.reg_a; target = layout.sp; break;
+				case TBA: source = layout.reg_b; target = layout.reg_a; break;
+				case TBX: source = layout.reg_b; target = layout.reg_x; break;
+				case TBY: source = layout.reg_b; target = layout.reg_y; break;
+				case TBSP: source = layout.reg_b; target = layout.sp; break;
+				case TXA: source = layout.reg_x; target = layout.reg_a; break;
+				case TXB: source = layout.reg_x; target = layout.reg_b; break;
+				case TXY: source = layout.reg_x; target = layout.reg_y; break;
+				case TXSP: source = layout.reg_x; target = layout.sp; break;
+				case TYA: source = layout.reg_y; target = layout.reg_a; break;
+				case TYB: source = layout.reg_y; target = layout.reg_b; break;
+				case TYX: source = layout.reg_y; target = layout.reg_x; break;
+				case TYSP: source = layout.reg_y; target = layout.sp; break;
+				case TSPA: source = layout.sp; target = layout.reg_a; break;
+				case TSPB: source = layout.sp; target = layout.reg_b; break;
+				case TSPX: source = layout.sp; target = layout.reg_x; break;
+				case TSPY: source = layout.sp; target = layout.reg_y; break;
+				case INCA: case DECA: target = layout.reg_a; break;
+				case INCB: case DECB: target = layout.reg_b; break;
+				case INCX: case DECX: target = layout.reg_x; break;
+				case INCY: case DECY: target = layout.reg_y; break;
+				case LOADA: case ANDA: case ORA: case XORA: case ADDCA: case SUBCA: case CMPA: target = layout.reg_a; break;
+				case LOADB: case CMPB: target = layout.reg_b; break;
+				case LOADX: case CMPX: target = layout.reg_x; break;
+				case LOADY: case CMPY: target = layout.reg_y; break;
+				case STOREA: source = layout.reg_a; break;
+				case STOREB: source = layout.reg_b; break;
+				case STOREX: source = layout.reg_x; break;
+				case STOREY: source = layout.reg_y; break;
+				case NOOP:
+					break;
+				case JMP:
+					if (it->addressing_mode == addressingmode::absolute) {
+						next_address = (word_t)it->operand;
+					}
+					else {
+						native = false;
+					}
+					break;
+				default:
+					native = false;
+					break;
+			}
+
+			// instructions that take an operand are only compiled with the addressing modes the compiled code can read (or write) itself
+			switch (it->opcode) {
+				case LOADA: case LOADB: case LOADX: case LOADY: case ANDA: case ORA: case XORA: case ADDCA: case SUBCA: case CMPA: case CMPB: case CMPX: case CMPY:
+					native = is_native_operand(it->addressing_mode);
+					break;
+				case STOREA: case STOREB: case STOREX: case STOREY:
+					native = is_native_store(it->addressing_mode);
+					break;
+				default:
+					break;
+			}
+		}
+
+		if (native) {
+			this->fallback_jumps.clear();
+
+			switch (it->opcode) {
+				case INCA: case INCB: case INCX: case INCY:
+					// add word [target], 1
+					this->emit_word_prefix();
+					this->emit_member(0x83, 0, target);
+					this->emit(0x01);
+					break;
+				case DECA: case DECB: case DECX: case DECY:
+					// sub word [target], 1
+					this->emit_word_prefix();
+					this->emit_member(0x83, 5, target);
+					this->emit(0x01);
+					break;
+				case LOADA: case LOADB: case LOADX: case LOADY:
+					if (it->addressing_mode == addressingmode::immediate) {
+						// mov word [target], imm
+						this->emit_word_prefix();
+						this->emit_member(0xC7, 0, target);
+						this->emit_word((uint32_t)it->operand);
+					}
+					else {
+						this->emit_operand(layout, *it);
+						this->emit_store(rax, target);
+					}
+					break;
+				case ANDA: case ORA: case XORA:
+					if (it->addressing_mode == addressingmode::immediate) {
+						// and/or/xor word [target], imm
+						this->emit_word_prefix();
+						this->emit_member(0x81, (it->opcode == ANDA) ? 4 : ((it->opcode == ORA) ? 1 : 6), target);
+						this->emit_word((uint32_t)it->operand);
+					}
+					else {
+						// and/or/xor word [target], ax
+						this->emit_operand(layout, *it);
+						this->emit_word_prefix();
+						this->emit_member((it->opcode == ANDA) ? 0x21 : ((it->opcode == ORA) ? 0x09 : 0x31), rax, target);
+					}
+					break;
+				case ADDCA: case SUBCA:
+					// the operand in EAX, the carry in ECX, and A in EDX
+					this->emit_operand(layout, *it);
+					this->emit_carry(layout);
+					this->emit_load(rdx, target);
+
+					// record the operation: mov byte [compare_pending], 0; mov byte [operation], add/sub; mov word [left], dx; mov word [right], ax
+					this->emit_member(0xC6, 0, layout.compare_pending);
+					this->emit(0x00);
+					this->emit_member(0xC6, 0, layout.operation);
+					this->emit((it->opcode == ADDCA) ? flagoperation::add : flagoperation::sub);
+					this->emit_store(rdx, layout.left);
+					this->emit_store(rax, layout.right);
+
+					if (it->opcode == ADDCA) {
+						// add edx, eax; add edx, ecx
+						this->emit(0x01); this->emit(0xC2);
+						this->emit(0x01); this->emit(0xCA);
+					}
+					else {
+						// word_max + left - right + carry; sub edx, eax; add edx, ecx; sub edx, 1
+						this->emit(0x29); this->emit(0xC2);
+						this->emit(0x01); this->emit(0xCA);
+						this->emit(0x83); this->emit(0xEA); this->emit(0x01);
+					}
+
+					// mov word [result], dx; mov word [target], dx
+					this->emit_store(rdx, layout.result);
+					this->emit_store(rdx, target);
+					break;
+				case CMPA: case CMPB: case CMPX: case CMPY:
+				{
+					this->emit_operand(layout, *it);
+
+					// if a comparison is already pending, its flags must be written first; the handler does it if arithmetic is pending, too
+					// cmp byte [compare_pending], 0; je record; cmp byte [operation], none; jne fallback
+					this->emit_member(0x80, 7, layout.compare_pending);
+					this->emit(0x00);
+					size_t record = this->emit_jump(jump_if_equal);
+					this->emit_member(0x80, 7, layout.operation);
+					this->emit(flagoperation::none);
+					this->emit_fallback_jump(jump_if_not_equal);
+
+					// write the pending comparison's flags, as PendingFlags::apply(...) does; cmp compare_left, compare_right; movzx edx, word [status]
+					this->emit_load(rcx, layout.compare_left);
+					this->emit_word_prefix();
+					this->emit_member(0x3B, rcx, layout.compare_right);
+					this->emit(0x0F);
+					this->emit_member(0xB7, rdx, layout.status);
+					size_t differ = this->emit_jump(jump_if_not_equal);
+
+					// equal: or edx, zero
+					this->emit(0x83); this->emit(0xCA); this->emit(StatusConstants::zero);
+					size_t equal_written = this->emit_jump(jump_always);
+
+					// greater: and edx, 0xFF - zero; or edx, carry
+					this->place_jump(differ);
+					size_t less = this->emit_jump(jump_if_below);
+					this->emit(0x81); this->emit(0xE2); this->emit_u32(0xFF - StatusConstants::zero);
+					this->emit(0x83); this->emit(0xCA); this->emit(StatusConstants::carry);
+					size_t greater_written = this->emit_jump(jump_always);
+
+					// less: and edx, (0xFF - zero) & (0xFF - carry)
+					this->place_jump(less);
+					this->emit(0x81); this->emit(0xE2); this->emit_u32((0xFF - StatusConstants::zero) & (0xFF - StatusConstants::carry));
+
+					// mov word [status], dx; mov byte [compare_pending], 0 is unnecessary, as the new comparison sets it again
+					this->place_jump(equal_written);
+					this->place_jump(greater_written);
+					this->emit(0x66);
+					this->emit_member(0x89, rdx, layout.status);
+
+					// record the comparison: mov byte [compare_pending], 1; mov word [compare_left], <the register>; mov word [compare_right], ax
+					this->place_jump(record);
+					this->emit_member(0xC6, 0, layout.compare_pending);
+					this->emit(0x01);
+					this->emit_load(rdx, target);
+					this->emit_store(rdx, layout.compare_left);
+					this->emit_store(rax, layout.compare_right);
+					break;
+				}
+				case STOREA: case STOREB: case STOREX: case STOREY:
+					this->emit_address(layout, *it);
+
+					// a store over any part of the program must invalidate its decoded forms, so the handler makes it
+					// mov edx, eax; sub edx, program_begin; cmp edx, program_end - program_begin; jb fallback
+					this->emit(0x89); this->emit(0xC2);
+					this->emit(0x81); this->emit(0xEA); this->emit_u32(layout.program_begin);
+					this->emit(0x81); this->emit(0xFA); this->emit_u32(layout.program_end - layout.program_begin);
+					this->emit_fallback_jump(jump_if_below);
+
+					this->emit_page(layout, pagepermission::write);
+					this->emit_load(rdx, source);
+					if (sizeof(word_t) == 2) {
+						// rol dx, 8; mov word [rcx + rax], dx
+						this->emit(0x66); this->emit(0xC1); this->emit(0xC2); this->emit(0x08);
+						this->emit(0x66); this->emit(0x89); this->emit(0x14); this->emit(0x01);
+					}
+					else {
+						// bswap edx; mov dword [rcx + rax], edx
+						this->emit(0x0F); this->emit(0xCA);
+						this->emit(0x89); this->emit(0x14); this->emit(0x01);
+					}
+					break;
+				case NOOP: case JMP:
+					break;
+				default:
+					// mov ax, word [source]; mov word [target], ax
+					this->emit_word_prefix();
+					this->emit_member(0x8B, rax, source);
+					this->emit_store(rax, target);
+					break;
+			}
+
+			// mov word [pc], next_address
+			this->emit_word_prefix();
+			this->emit_member(0xC7, 0, layout.pc);
+			this->emit_word(next_address);
+
+			// sub r12, 1; jle exit
+			this->emit(0x49); this->emit(0x83); this->emit(0xEC); this->emit(0x01);
+			this->emit_exit_jump(jump_if_less_or_equal);
+
+			// anything the compiled code couldn't do itself goes to the handler
+			if (!this->fallback_jumps.empty()) {
+				size_t done = this->emit_jump(jump_always);
+				for (std::vector<size_t>::iterator jump = this->fallback_jumps.begin(); jump != this->fallback_jumps.end(); jump++) {
+					this->place_jump(*jump);
+				}
+				this->emit_handler_call(layout, *it, next_address, last, &block.valid);
+				this->place_jump(done);
+			}
+		}
+		else {
+			this->emit_handler_call(layout, *it, next_address, last, &block.valid);
+		}
+
+		current = (word_t)(current + it->length);
+	}
+
+	// the exit: mov qword [budget], r12; mov qword [cycles], r13; add rsp, 32; pop r13; pop r12; pop rbx; ret
+	size_t exit = this->emitted.size();
+	this->emit(0x4C);
+	this->emit_member(0x89, r12, layout.budget);
+	this->emit(0x4C);
+	this->emit_member(0x89, r13, layout.cycles);
+	this->emit(0x48); this->emit(0x83); this->emit(0xC4); this->emit(0x20);
+	this->emit(0x41); this->emit(0x5D);
+	this->emit(0x41); this->emit(0x5C);
+	this->emit(0x5B);
+	this->emit(0xC3);
+
+	for (std::vector<size_t>::iterator it = this->exit_jumps.begin(); it != this->exit_jumps.end(); it++) {
+		uint32_t displacement = (uint32_t)(exit - (*it + 4));
+		memcpy(&this->emitted[*it], &displacement, sizeof(displacement));
+	}
+
+	if (this->emitted.size() > blockcompiler::code_size - this->used) {
+		return nullptr;
+	}
+
+	uint8_t* destination = this->code + this->used;
+	this->protect(true);
+	memcpy(destination, this->emitted.data(), this->emitted.size());
+	this->protect(false);
+	this->used += this->emitted.size();
+
+	return (CompiledBlock)destination;
+}
+
+void BlockCompiler::clear() {
+	// the blocks are compiled again as they are entered
+	this->used = 0;
+}
+
+
+BlockCompiler::BlockCompiler() {
+	this->code = nullptr;
+	this->used = 0;
+	this->unavailable = false;
+}
+
+BlockCompiler::~BlockCompiler() {
+	if (this->code != nullptr) {
+#if defined(_WIN32)
+		VirtualFree(this->code, 0, MEM_RELEASE);
+#else
+		munmap(this->code, blockcompiler::code_size);
+#endif
+	}
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+
+SIN Toolchain
+BlockCompiler.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the BlockCompiler class, which compiles the VM's decoded blocks (see DecodedBlock.h) to x86-64 machine code when the VM runs with BLOCK_DISPATCH.
+Register operations, arithmetic, comparisons, and loads and stores with absolute or indexed addressing are compiled to x86 instructions of their own; anything else, and any access the compiled code can't make itself (e.g., one that generates a signal), calls the instruction's handler.
+
+The compiler is only built for x86-64 hosts (where SIN_BLOCK_COMPILER is defined). Elsewhere, or if the host won't give the VM executable memory, BLOCK_DISPATCH executes the decoded blocks with SINVM::execute_block(...) instead; the observable behavior is the same either way.
+Each VM has its own compiler and its own executable memory, as the compiled code refers to the VM's registers and to its block cache directly. See BlockCompiler.cpp for the code it generates.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIN_BLOCK_COMPILER
+#endif
+
+class SINVM;
+
+// a compiled block; it runs until control leaves the block, just as SINVM::execute_block(...) does
+typedef void (*CompiledBlock)(SINVM* vm);
+
+#if defined(SIN_BLOCK_COMPILER)
+
+struct DecodedBlock;
+struct DecodedInstruction;
+
+namespace blockcompiler {
+	// the executable memory each VM sets aside for compiled blocks; once it is full, it is cleared, and blocks are compiled again as they are entered
+	const size_t code_size = 0x100000;
+
+	// the number of times a block is executed by its handlers before it is compiled; code the program keeps writing over is decoded again every time it is entered, and so is never compiled
+	const uint8_t compile_threshold = 4;
+}
+
+class BlockCompiler
+{
+	struct Layout;	// where the compiled code finds the VM's members; see BlockCompiler.cpp
+
+	uint8_t* code;	// the executable memory, allocated the first time a block is compiled; nullptr until then, or if the host refused
+	size_t used;	// the number of bytes of it holding compiled blocks
+	bool unavailable;	// whether the host refused to allocate it
+
+	// the code for the block being compiled, the jumps to its exit that must be filled in once the exit has been placed, and the jumps from the instruction being compiled to the call to its handler
+	std::vector<uint8_t> emitted;
+	std::vector<size_t> exit_jumps;
+	std::vector<size_t> fallback_jumps;
+
+	void emit(uint8_t byte);
+	void emit_u16(uint16_t value);
+	void emit_u32(uint32_t value);
+	void emit_u64(uint64_t value);
+	void emit_word(uint32_t value);	// a value as wide as the VM's word
+	void emit_word_prefix();	// the operand-size prefix for an instruction on a word, if the VM's word is 16 bits
+	void emit_member(uint8_t opcode, uint8_t reg, int32_t offset);	// 'opcode' with a ModRM byte addressing the VM member at 'offset'
+	void emit_indexed_member(uint8_t opcode, uint8_t reg, uint8_t index, uint8_t scale, int32_t offset);	// the same, for the element 'index' of the VM's array at 'offset'
+	void emit_load(uint8_t reg, int32_t offset);	// load a word from the VM member at 'offset', zero-extended to 32 bits
+	void emit_store(uint8_t reg, int32_t offset);	// store a word in the VM member at 'offset'
+	size_t emit_jump(uint8_t condition);	// a jcc (0F 8x) or jmp whose target is filled in by place_jump(...); returns where its displacement is
+	void place_jump(size_t jump);	// make a jump emitted earlier go to the end of the code emitted so far
+	void emit_exit_jump(uint8_t condition);	// a jump to the exit
+	void emit_fallback_jump(uint8_t condition);	// a jump to the call to the handler of the instruction being compiled
+
+	// the code for an instruction that is compiled to x86; see BlockCompiler.cpp
+	void emit_address(const Layout& layout, const DecodedInstruction& instruction);
+	void emit_page(const Layout& layout, uint8_t permission);
+	void emit_operand(const Layout& layout, const DecodedInstruction& instruction);
+	void emit_carry(const Layout& layout);
+	void emit_handler_call(const Layout& layout, const DecodedInstruction& instruction, uint32_t next_address, bool last, const bool* valid);
+
+	bool allocate();
+	void protect(bool writable);
+public:
+	bool is_available();	// whether blocks can be compiled on this host
+	CompiledBlock compile(SINVM& vm, const DecodedBlock& block, uint32_t address);	// compile the block beginning at 'address'; nullptr if the executable memory is full
+	void clear();	// discard every compiled block
+
+	BlockCompiler();
+	~BlockCompiler();
+
+	// the compiled code belongs to a single VM
+	BlockCompiler(const BlockCompiler&) = delete;
+	BlockCompiler& operator=(const BlockCompiler&) = delete;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+
+SIN Toolchain
+CycleCosts.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the VM's cycle cost model; see CycleCosts.h.
+
+*/
+
+#include "SINVM.h"
+
+
+uint16_t SINVM::get_cycle_cost(uint8_t opcode, uint8_t addressing_mode, uint8_t length) {
+	// instructions without an addressing mode are a single byte
+	bool has_operand = length > 1;
+
+	uint16_t operand_cost = 0;
+	if (has_operand) {
+		switch (addressing_mode & ~addressingmode::absolute_short) {
+		case addressingmode::reg_a:
+		case addressingmode::reg_b:
+			operand_cost = cyclecost::register_operand;
+			break;
+		case addressingmode::immediate:
+			operand_cost = cyclecost::immediate;
+			break;
+		case addressingmode::x_index:
+		case addressingmode::y_index:
+			operand_cost = cyclecost::indexed;
+			break;
+		case addressingmode::indirect:
+			operand_cost = cyclecost::indirect;
+			break;
+		case addressingmode::indirect_indexed_x:
+		case addressingmode::indirect_indexed_y:
+			operand_cost = cyclecost::indirect_indexed;
+			break;
+		case addressingmode::indexed_indirect_x:
+		case addressingmode::indexed_indirect_y:
+			operand_cost = cyclecost::indexed_indirect;
+			break;
+		default:
+			operand_cost = cyclecost::absolute;
+			break;
+		}
+	}
+
+	switch (opcode) {
+	case ROL:
+	case ROR:
+	case LSL:
+	case LSR:
+		// shifting the A register is a simple operation; shifting memory must read it and write it back
+		if (addressing_mode == addressingmode::reg_a) {
+			return cyclecost::operation;
+		}
+		return cyclecost::read_modify_write + operand_cost;
+	case INCM:
+	case DECM:
+		return cyclecost::read_modify_write + operand_cost;
+	case MULTA:
+	case MULTUA:
+		return cyclecost::multiply + operand_cost;
+	case DIVA:
+	case DIVUA:
+		return cyclecost::divide + operand_cost;
+	case FADDA:
+	case FSUBA:
+	case FMULTA:
+	case FDIVA:
+		return cyclecost::floating_point + operand_cost;
+	case PHA:
+	case PHB:
+	case PRSA:
+	case PRSB:
+		return cyclecost::push;
+	case PLA:
+	case PLB:
+	case RSTA:
+	case RSTB:
+		return cyclecost::pull;
+	case PRSR:
+	case RSTR:
+		return cyclecost::preserve_all;
+	case JMP:
+		return cyclecost::jump + operand_cost;
+	case BRNE:
+	case BREQ:
+	case BRGT:
+	case BRLT:
+	case BRZ:
+	case BRN:
+	case BRPL:
+		return cyclecost::branch + operand_cost;
+	case JSR:
+		return cyclecost::call + operand_cost;
+	case RTS:
+	case RTI:
+		return cyclecost::return_from;
+	case IRQ:
+	case BRK:
+	case RESET:
+		return cyclecost::interrupt;
+	case VADD:
+	case VSUB:
+	case VAND:
+	case VOR:
+	case VXOR:
+	case VCMP:
+	case VSUM:
+		return cyclecost::vector_operation;
+	case MOVM:
+	case FILLM:
+		return cyclecost::block_transfer;
+	case SYSCALL:
+		return cyclecost::syscall;
+	case HALT:
+		return cyclecost::halt;
+	default:
+		// everything else either takes an operand (loads, stores, arithmetic, comparisons) or works only on registers
+		return has_operand ? cyclecost::operation + operand_cost : cyclecost::implied;
+	}
+}
@@ -0,0 +1,53 @@
+/*
+
+SIN Toolchain
+CycleCosts.h
+Copyright 2019 Riley Lannon
+
+Contains the constants for the VM's cycle cost model.
+
+The VM counts "SIN cycles" as it runs, charging every instruction a fixed number of cycles that depends only on its opcode and addressing mode. The count doesn't depend on the host or the dispatch mode, so it may be used to compare two versions of a program without the noise of wall-clock timing. It is read with the SYS_CYCLES syscall, or with SINVM::get_cycle_count() on the host.
+
+The costs are modelled on the 6502's timing tables: an instruction costs a base amount for what it does, plus an amount for fetching its operand.
+	e.g., LOADA #$12 costs 2 cycles (like LDA #$12); LOADA $1234 costs 4 (like LDA $1234); INCM $1234 costs 6 (like INC $1234)
+Unlike the 6502, branches cost the same whether or not they are taken, and crossing a page costs nothing extra, so that the cost of an instruction can be computed once, when it is decoded. The exceptions are the block transfer instructions (MOVM and FILLM) and the vector instructions (VADD, VSUM, etc.), which are also charged for each byte or word as they execute.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+
+
+namespace cyclecost {
+	// the cost of getting the operand, by addressing mode
+	const uint8_t register_operand = 0;	// A or B
+	const uint8_t immediate = 0;
+	const uint8_t absolute = 2;
+	const uint8_t indexed = 2;	// $1234, x
+	const uint8_t indirect = 3;	// ($1234)
+	const uint8_t indirect_indexed = 3;	// ($00), y
+	const uint8_t indexed_indirect = 4;	// ($00, x)
+
+	// the base cost of each kind of instruction
+	const uint8_t implied = 2;	// transfers, register increments, flag instructions, etc.
+	const uint8_t operation = 2;	// loads, stores, arithmetic, logic, and comparisons
+	const uint8_t read_modify_write = 4;	// INCM, DECM, and bitshifts on memory
+	const uint8_t multiply = 8;
+	const uint8_t divide = 16;
+	const uint8_t floating_point = 12;
+	const uint8_t push = 3;
+	const uint8_t pull = 4;
+	const uint8_t preserve_all = 12;	// PRSR and RSTR move every register
+	const uint8_t jump = 1;
+	const uint8_t branch = 0;	// with its absolute operand, a branch costs 2, like a 6502 branch that isn't taken
+	const uint8_t call = 4;	// JSR $1234 costs 6
+	const uint8_t return_from = 6;	// RTS and RTI
+	const uint8_t interrupt = 7;	// IRQ, BRK, and RESET
+	const uint8_t block_transfer = 4;	// MOVM and FILLM, which are also charged block_byte for every byte they move
+	const uint8_t block_byte = 1;
+	const uint8_t vector_operation = 4;	// the vector instructions, which are also charged vector_word for every word they touch
+	const uint8_t vector_word = 1;
+	const uint8_t syscall = 20;	// the guest can't see what the host does, so every syscall costs the same
+	const uint8_t halt = 1;
+}
@@ -0,0 +1,384 @@
+/*
+
+SIN Toolchain
+DecodeCache.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the VM's decode cache.
+
+The cache holds one DecodedInstruction for every byte of the loaded program (_PRG_BOTTOM up to the end of the program data). Every byte is decoded, not just the ones a sweep through the program would reach, so an entry is there even for a jump into the middle of what looked like another instruction. The data section at the end of the program gets decoded too; the entries simply describe the bytes that are there.
+The VMs running a program share its decoded instructions through the ProgramImage, in the same way that they share its pages (see ProgramImage.h): the first VM to need the program decoded does it, from the image rather than from its own memory, and every VM's cache points into that. There are two shared copies, as the program is decoded differently with and without fusion.
+Whenever the program writes into memory covered by the cache, every entry that could include the written bytes is invalidated, and it will be decoded again the next time it is fetched. The shared entries can't be changed, so the VM first gets its own copy of each page of entries it invalidates; like its copies of memory, they are released by reset(). Instructions outside the cached range are decoded every time they are executed.
+The exception is code in a bank (see ProgramImage.h); each bank has a cache of its own for the bank window, shared in the same way, so that switching banks doesn't invalidate anything. The program can't write to a bank, so these entries never need to be invalidated; nor are they fused.
+
+*/
+
+#include "SINVM.h"
+
+#include <sstream>
+#include <algorithm>
+
+
+DecodedInstruction::DecodedInstruction() {
+	this->opcode = NOOP;
+	this->addressing_mode = 0;
+	this->operand = 0;
+	this->length = 1;
+	this->handler = nullptr;
+#if defined(SIN_DIRECT_THREADING)
+	this->target = nullptr;
+#endif
+	this->fused = 1;
+	this->cycles = 0;
+	this->valid = false;
+}
+
+
+std::string disassemble(const DecodedInstruction& instruction) {
+	// format an instruction the way it would be written in SINASM
+	std::stringstream text;
+
+	try {
+		text << Assembler::get_mnemonic(instruction.opcode);
+	}
+	catch (std::exception&) {
+		text << "??? ($" << std::hex << (uint16_t)instruction.opcode << ")";
+		return text.str();
+	}
+
+	// instructions without an addressing mode are a single byte
+	if (instruction.length == 1) {
+		return text.str();
+	}
+
+	uint8_t mode = instruction.addressing_mode;
+	if (mode == addressingmode::reg_a) {
+		text << " A";
+		return text.str();
+	}
+	else if (mode == addressingmode::reg_b) {
+		text << " B";
+		return text.str();
+	}
+	else if (mode >= addressingmode::absolute_short) {
+		text << " S";
+		mode -= addressingmode::absolute_short;
+	}
+
+	text << " " << std::hex;
+	switch (mode) {
+	case addressingmode::absolute:
+		text << "$" << instruction.operand;
+		break;
+	case addressingmode::x_index:
+		text << "$" << instruction.operand << ", X";
+		break;
+	case addressingmode::y_index:
+		text << "$" << instruction.operand << ", Y";
+		break;
+	case addressingmode::immediate:
+		text << "#$" << instruction.operand;
+		break;
+	case addressingmode::indirect:
+		text << "($" << instruction.operand << ")";
+		break;
+	case addressingmode::indirect_indexed_x:
+		text << "($" << instruction.operand << "), X";
+		break;
+	case addressingmode::indirect_indexed_y:
+		text << "($" << instruction.operand << "), Y";
+		break;
+	case addressingmode::indexed_indirect_x:
+		text << "($" << instruction.operand << ", X)";
+		break;
+	case addressingmode::indexed_indirect_y:
+		text << "($" << instruction.operand << ", Y)";
+		break;
+	default:
+		text << "?";
+		break;
+	}
+
+	return text.str();
+}
+
+
+uint8_t SINVM::get_instruction_format(uint8_t opcode) {
+	/*
+
+	Returns the layout of the instruction, as defined in DecodedInstruction.h, according to how the VM reads it.
+	Note this is based on what the VM actually reads when it executes the instruction; instructions that are not yet implemented by the VM (e.g., ADDCB or IRQ) do not read any data, and so are treated as standalone instructions.
+
+	*/
+
+	switch (opcode) {
+		// instructions that fetch their operand with execute_load()
+		case LOADA: case LOADB: case LOADX: case LOADY:
+		case ADDCA: case SUBCA: case MULTA: case DIVA: case MULTUA: case DIVUA:
+		case ANDA: case ORA: case XORA:
+		case CMPA: case CMPB: case CMPX: case CMPY:
+		case FADDA: case FSUBA: case FMULTA: case FDIVA:
+			return instructionformat::load;
+
+		// instructions that always read an addressing mode and a word of data
+		case STOREA: case STOREB: case STOREX: case STOREY:
+		case JMP: case BRNE: case BREQ: case BRGT: case BRLT: case BRZ: case BRN: case BRPL:
+		case JSR: case SYSCALL:
+			return instructionformat::operand;
+
+		// bitshift instructions may operate on A
+		case LSR: case LSL: case ROR: case ROL:
+			return instructionformat::bitshift;
+
+		default:
+			return instructionformat::standalone;
+	}
+}
+
+
+void SINVM::decode_instruction(word_t address, DecodedInstruction& instruction) {
+	/*
+
+	Decodes the instruction beginning at 'address' into 'instruction'.
+
+	*/
+
+	instruction.opcode = this->read_byte(address);
+	instruction.addressing_mode = 0;
+	instruction.operand = 0;
+	instruction.length = 1;
+	instruction.fused = 1;
+
+	uint8_t format = get_instruction_format(instruction.opcode);
+
+	if (format != instructionformat::standalone) {
+		// the addressing mode follows the opcode
+		word_t mode_address = address + 1;
+		instruction.addressing_mode = this->read_byte(mode_address);
+		instruction.length = 2;
+
+		// the B mode for loads and the A mode for bitshifts are not followed by any data
+		if (!(format == instructionformat::load && instruction.addressing_mode == addressingmode::reg_b) &&
+			!(format == instructionformat::bitshift && instruction.addressing_mode == addressingmode::reg_a))
+		{
+			// the data is stored in big-endian format
+			for (uint8_t i = 0; i < (this->_WORDSIZE / 8); i++) {
+				word_t data_address = address + 2 + i;
+				instruction.operand = (instruction.operand << 8) | this->read_byte(data_address);
+			}
+			instruction.length += (this->_WORDSIZE / 8);
+		}
+	}
+
+	// the handler may be specialized for the addressing mode, so this must come after the mode is decoded
+	instruction.handler = get_instruction_handler(instruction.opcode, instruction.addressing_mode);
+	instruction.cycles = get_cycle_cost(instruction.opcode, instruction.addressing_mode, instruction.length);
+
+	// the threaded and block dispatch loops may execute a whole sequence of instructions with one handler
+	if (this->uses_fusion()) {
+		this->fuse_instruction(address, instruction);
+	}
+
+#if defined(SIN_DIRECT_THREADING)
+	// this depends on whether the instruction was fused, so it must come last
+	instruction.target = this->get_threaded_target(instruction);
+#endif
+
+	instruction.valid = true;
+}
+
+
+void SINVM::decode_image(word_t bank, word_t start, std::vector<DecodedInstruction>& decoded) {
+	/*
+
+	Decodes the instruction at every address from 'start' on into 'decoded', as the program was loaded, with 'bank' shown in the bank window. The VM's memory is pointed at the image just long enough to do it; no instruction runs in between, so nothing else sees the change.
+	The program and the bank window are both in the first 64k of memory, so only the first page table needs to be changed; see PagePermissions.h.
+
+	*/
+
+	const uint8_t* shown[pagepermission::table_size];
+	std::copy(this->first_read_pages, this->first_read_pages + pagepermission::table_size, shown);
+	std::copy(this->program->get_read_table(0), this->program->get_read_table(0) + pagepermission::table_size, this->first_read_pages);
+
+	if (bank != 0) {
+		for (size_t page = _BANK_WINDOW_START >> pagepermission::page_shift; page <= (_BANK_WINDOW_END >> pagepermission::page_shift); page++) {
+			this->first_read_pages[page] = this->program->get_bank_page(bank, page << pagepermission::page_shift);
+		}
+	}
+
+	for (size_t index = 0; index < decoded.size(); index++) {
+		this->decode_instruction((word_t)(start + index), decoded[index]);
+	}
+
+	std::copy(shown, shown + pagepermission::table_size, this->first_read_pages);
+}
+
+
+const DecodedInstruction* SINVM::get_decoded_program() {
+	/*
+
+	Returns the decoded program shared by every VM running the ProgramImage, with or without fusion, according to the dispatch loop this VM is using; the first VM to ask for it decodes it.
+	The entries are padded to a whole number of pages, so that every page of the cache can point into them.
+
+	*/
+
+	std::lock_guard<std::mutex> lock(this->program->decode_mutex);
+
+	std::vector<DecodedInstruction>& decoded = this->program->decoded_program[this->uses_fusion() ? 1 : 0];
+	if (decoded.empty()) {
+		decoded.resize((this->decode_cache_size + pagepermission::page_size - 1) & ~(pagepermission::page_size - 1));
+		this->decode_image(0, _PRG_BOTTOM, decoded);
+	}
+
+	return decoded.data();
+}
+
+
+const DecodedInstruction* SINVM::get_decoded_bank(word_t bank) {
+	// the same, for the code in a bank, which is decoded the first time any VM fetches code from it
+	std::lock_guard<std::mutex> lock(this->program->decode_mutex);
+
+	std::vector<DecodedInstruction>& decoded = this->program->decoded_banks[bank - 1];
+	if (decoded.empty()) {
+		decoded.resize(bank_size);
+		this->decode_image(bank, _BANK_WINDOW_START, decoded);
+	}
+
+	return decoded.data();
+}
+
+
+DecodedInstruction* SINVM::copy_decode_page(size_t page) {
+	/*
+
+	Gives the VM its own copy of a page of the decode cache so that its entries may be invalidated; called the first time the program writes over code in a page it shares.
+	Copies released by reset() are reused before any new ones are allocated.
+
+	*/
+
+	DecodedInstruction* copy;
+	if (!this->free_decode_pages.empty()) {
+		copy = this->free_decode_pages.back();
+		this->free_decode_pages.pop_back();
+	}
+	else {
+		copy = new DecodedInstruction[pagepermission::page_size];
+	}
+
+	std::copy(this->decode_pages[page], this->decode_pages[page] + pagepermission::page_size, copy);
+
+	this->decode_pages[page] = copy;
+	this->own_decode_pages[page] = copy;
+	this->unwritten_decode_cache = nullptr;
+	return copy;
+}
+
+
+void SINVM::release_decode_pages() {
+	/*
+
+	Points every page of the cache back at the shared decoded program, releasing the VM's own copies; they are kept to be reused.
+
+	*/
+
+	for (size_t page = 0; page < decode_cache_pages; page++) {
+		if (this->own_decode_pages[page] != nullptr) {
+			this->free_decode_pages.push_back(this->own_decode_pages[page]);
+			this->own_decode_pages[page] = nullptr;
+		}
+		this->decode_pages[page] = this->shared_decode_cache + (page << pagepermission::page_shift);
+	}
+	this->unwritten_decode_cache = this->shared_decode_cache;
+}
+
+
+void SINVM::build_decode_cache() {
+	/*
+
+	Sets up the cache to use the shared decoded program, with or without fusion, according to the dispatch loop in use.
+	Any page the program has written to since it was loaded is invalidated again, as the VM's copy of it may have been decoded the other way.
+	The fusion statistics are collected here, by sweeping through the program in order from _PRG_BOTTOM.
+
+	*/
+
+	this->shared_decode_cache = this->get_decoded_program();
+	this->release_decode_pages();
+
+	for (size_t page = _PRG_BOTTOM >> pagepermission::page_shift; (page << pagepermission::page_shift) < _PRG_BOTTOM + this->decode_cache_size; page++) {
+		if (this->get_write_page(page) != nullptr) {
+			this->invalidate_decode_cache(page << pagepermission::page_shift, pagepermission::page_size);
+		}
+	}
+
+	this->fusion_statistics = FusionStatistics();
+
+	size_t index = 0;
+	while (index < this->decode_cache_size) {
+		this->count_fusion(this->shared_decode_cache[index]);
+		index += this->shared_decode_cache[index].length;
+	}
+}
+
+
+const DecodedInstruction& SINVM::fetch_uncached_instruction() {
+	/*
+
+	Returns the decoded instruction at the current PC when fetch_instruction() can't find a valid entry for it in the program's decode cache.
+	The instruction is decoded into the entry for it, if it has one; an entry the program's own cache can't find was invalidated, so it is always in one of the VM's own pages. Code in a bank uses the bank's shared cache, and code anywhere else isn't cached at all.
+
+	*/
+
+	size_t index = (size_t)this->PC - _PRG_BOTTOM;	// will wrap around (and fail the check below) if the PC is below the program
+
+	if (index < this->decode_cache_size) {
+		DecodedInstruction& cached = this->own_decode_pages[index >> pagepermission::page_shift][index & (pagepermission::page_size - 1)];
+		this->decode_instruction(this->PC, cached);
+		return cached;
+	}
+	else if ((this->selected_bank != 0) && (this->PC >= _BANK_WINDOW_START) && (this->PC <= _BANK_WINDOW_END)) {
+		const DecodedInstruction*& bank_cache = this->bank_decode_caches[this->selected_bank - 1];
+		if (bank_cache == nullptr) {
+			bank_cache = this->get_decoded_bank(this->selected_bank);
+		}
+		return bank_cache[this->PC - _BANK_WINDOW_START];
+	}
+	else {
+		this->decode_instruction(this->PC, this->uncached_instruction);
+		return this->uncached_instruction;
+	}
+}
+
+
+void SINVM::invalidate_decoded_range(size_t address, size_t num_bytes) {
+	/*
+
+	The part of invalidate_decode_cache(...) for writes that may touch the program: invalidates every cache entry that might include any of the 'num_bytes' bytes starting at 'address'.
+	An instruction is at most (2 + _WORDSIZE / 8) bytes long, so an instruction that begins up to that many bytes - 1 before the address may cover it; if fusion is in use, a fused instruction may be up to fusion::max_fused_bytes long.
+
+	*/
+
+	size_t max_length = this->uses_fusion() ? fusion::max_fused_bytes : 2 + (this->_WORDSIZE / 8);
+	size_t cache_end = _PRG_BOTTOM + this->decode_cache_size;
+
+	// if the write doesn't touch the cached range at all, there is nothing to do; most writes are to variables and the stacks, below the program
+	if ((address + num_bytes <= _PRG_BOTTOM) || (address >= cache_end)) {
+		return;
+	}
+
+	// cached blocks cover the same range, so they only need to be checked for writes that get this far
+	if (!this->block_cache.empty()) {
+		this->invalidate_block_cache(address, num_bytes);
+	}
+
+	size_t first = (address >= _PRG_BOTTOM + (max_length - 1)) ? address - (max_length - 1) : _PRG_BOTTOM;
+	size_t last = (address + num_bytes < cache_end) ? address + num_bytes : cache_end;
+
+	for (size_t i = first; i < last; i++) {
+		size_t index = i - _PRG_BOTTOM;
+		DecodedInstruction* page = this->own_decode_pages[index >> pagepermission::page_shift];
+		if (page == nullptr) {
+			page = this->copy_decode_page(index >> pagepermission::page_shift);
+		}
+		page[index & (pagepermission::page_size - 1)].valid = false;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+
+SIN Toolchain
+DecodedBlock.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the DecodedBlock struct, which is used by the VM's block cache.
+A block is a straight-line run of instructions that ends at the first instruction that may transfer control (a jump, branch, JSR, RTS, SYSCALL, etc.). When the VM is run with BLOCK_DISPATCH, each block is decoded once into a list of instructions and their handlers, and then executed as a unit without going back through the fetch/decode step for every instruction.
+On x86-64 hosts, a block that is entered more than a few times is then compiled to machine code (see BlockCompiler.h); otherwise, the instructions are executed by their handlers, as in the other dispatch loops.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include "DecodedInstruction.h"
+#include "BlockCompiler.h"
+
+namespace decodedblock {
+	/*
+
+	A block will stop taking instructions once it reaches this many bytes, even if it has not found a control flow instruction.
+	Keeping blocks short bounds how far back the VM must look when a write into the program invalidates the blocks that cover it.
+
+	*/
+
+	const size_t max_block_bytes = 64;
+}
+
+struct DecodedBlock
+{
+	std::vector<DecodedInstruction> instructions;	// the instructions in the block, in order
+	wordaccess::vm_word end;	// the address immediately following the last instruction in the block
+	bool valid;	// whether the block reflects what is currently in memory
+#if defined(SIN_BLOCK_COMPILER)
+	CompiledBlock code;	// the compiled block, or nullptr if it hasn't been compiled since it was decoded
+	uint8_t entries;	// the number of times the block has been entered without being compiled, up to blockcompiler::compile_threshold
+#endif
+
+	DecodedBlock();
+};
@@ -0,0 +1,65 @@
+/*
+
+SIN Toolchain
+DecodedInstruction.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the DecodedInstruction struct, which is used by the VM's decode cache.
+Rather than re-reading the opcode, addressing mode, and operand bytes every time an instruction is executed, the VM decodes each instruction in the program once and keeps the result. Entries are invalidated whenever the program writes into the bytes they were decoded from.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include <string>
+
+#include "WordAccess.h"
+
+class SINVM;
+struct DecodedInstruction;
+
+// The function that executes an instruction; see ExecuteInstruction.cpp
+typedef void (*InstructionHandler)(SINVM& vm, const DecodedInstruction& instruction);
+
+// The threaded dispatch loop jumps directly from one instruction to the next using computed gotos, which GCC and Clang support as an extension; with other compilers, THREADED_DISPATCH uses the switch loop instead
+#if defined(__GNUC__)
+#define SIN_DIRECT_THREADING
+#endif
+
+namespace instructionformat {
+	/*
+
+	The layout of an instruction depends only on its opcode (and, in two cases, its addressing mode):
+		standalone	-	the opcode alone; 1 byte
+		operand		-	opcode, addressing mode, and one word of data
+		load		-	like 'operand', but the B addressing mode is not followed by any data
+		bitshift	-	like 'operand', but the A addressing mode is not followed by any data
+
+	*/
+
+	const uint8_t standalone = 0;
+	const uint8_t operand = 1;
+	const uint8_t load = 2;
+	const uint8_t bitshift = 3;
+}
+
+struct DecodedInstruction
+{
+	uint8_t opcode;	// the instruction's opcode
+	uint8_t addressing_mode;	// the addressing mode byte, if the instruction has one (0 otherwise)
+	wordaccess::vm_word operand;	// the word following the addressing mode, if the instruction has one (0 otherwise)
+	uint8_t length;	// the number of bytes the instruction occupies in memory
+	InstructionHandler handler;	// the handler that executes the instruction; used by the block dispatch loop, and for fused instructions
+#if defined(SIN_DIRECT_THREADING)
+	const void* target;	// the code in the threaded dispatch loop that executes the instruction; see SINVM::run_threaded_code(...)
+#endif
+	uint8_t fused;	// the number of instructions this entry executes; more than 1 if the VM fused a sequence of instructions into it (see Fusion.h)
+	uint16_t cycles;	// the number of cycles the entry costs; see CycleCosts.h
+	bool valid;	// whether the entry reflects what is currently in memory
+
+	DecodedInstruction();
+};
+
+// format an instruction the way it would be written in SINASM; used by the profiler and the trace decoder
+std::string disassemble(const DecodedInstruction& instruction);
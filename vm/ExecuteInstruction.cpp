@@ -4,605 +4,1584 @@ SIN Toolchain
 ExecuteInstruction.cpp
 Copyright 2019 Riley Lannon
 
-Contains the implementation of the execute_instruction function for the SIN VM; because it is such a large function, it is easier to have it in a separate file
+Contains the instruction handlers for the SIN VM, and the switch dispatch loop that calls them; because it is such a large function, it is easier to have it in a separate file
+
+Every instruction is implemented by a handler in the InstructionHandlers struct below. The VM has two ways of getting to those handlers:
+	- SWITCH_DISPATCH: run_switch_dispatch(...) selects the handler using a switch statement on the opcode
+	- THREADED_DISPATCH: the handler is selected when the instruction is decoded (see get_instruction_handler(...)) and stored in the DecodedInstruction, so the VM can call it directly without looking at the opcode at all
+Because both use the same handlers, the observable behavior is the same either way.
 
 */
 
 #include "SINVM.h"
+#include "SpecializedAccess.h"
 
-void SINVM::execute_instruction(uint16_t opcode) {
+struct InstructionHandlers {
 	/*
 
-	Execute a single instruction. Each instruction will increment or set the PC according to what it needs to do for that particular instruction.
-	This function delegates the task of handling instruction execution to many other functions to make the code more maintainable and easier to understand.
+	The handlers for each instruction. They are called with the PC pointing to the last byte of the instruction; the PC is incremented after the handler returns.
+	Handlers are static functions rather than member functions so that they may be stored in a DecodedInstruction using a plain function pointer. They are also forced inline, so that the switch dispatch loop executes them in place rather than calling them; see Inline.h
+	Handlers for instructions that take an operand from memory are templates on the addressing mode; get_instruction_handler(...) picks the instantiation for the mode in the instruction, so the handler doesn't need to check it at runtime. The operandmode::generic instantiation checks the mode at runtime and is used by the switch dispatch loop (see SpecializedAccess.h).
 
 	*/
 
-	// use a switch statement; compiler may be able to optimize it more easily and it will be easier to read
-	switch (opcode) {
-		/*
-		
-		GENERAL PROCESSOR INSTRUCTIONS
-		
-		*/
+	typedef SINVM::word_t word_t;
 
-		case NOOP:
-			break;
+	/*
 
-		/*
-		
-		REGISTER INSTRUCTIONS
-		
-		*/
+	GENERAL PROCESSOR INSTRUCTIONS
 
-		// A register
-		case LOADA:
-			REG_A = this->execute_load();
-			break;
-		case STOREA:
-			this->execute_store(REG_A);
-			break;
-		case TAB:
-			this->REG_B = this->REG_A;
-			break;
-		case TAX:
-			this->REG_X = this->REG_A;
-			break;
-		case TAY:
-			this->REG_Y = this->REG_A;
-			break;
-		case TASP:
-			this->SP = this->REG_A;
-			break;
-		case TASTATUS:
-			this->STATUS = this->REG_A;
-			break;
-		case INCA:
-			this->REG_A += 1;
-			break;
-		case DECA:
-			this->REG_A -= 1;
-			break;
+	*/
 
-		// B register
-		case LOADB:
-			REG_B = this->execute_load();
-			break;
-		case STOREB:
-			this->execute_store(REG_B);
-			break;
-		case TBA:
-			this->REG_A = this->REG_B;
-			break;
-		case TBX:
-			this->REG_X = this->REG_B;
-			break;
-		case TBY:
-			this->REG_Y = this->REG_B;
-			break;
-		case TBSP:
-			this->SP = this->REG_B;
-			break;
-		case TBSTATUS:
-			this->STATUS = this->REG_B;
-			break;
-		case INCB:
-			this->REG_B += 1;
-			break;
-		case DECB:
-			this->REG_B -= 1;
-			break;
+	static SIN_FORCE_INLINE void noop(SINVM&, const DecodedInstruction&) {
+		return;
+	}
 
-		// X register
-		case LOADX:
-			REG_X = this->execute_load();
-			break;
-		case STOREX:
-			this->execute_store(REG_X);
-			break;
-		case TXA:
-			this->REG_A = this->REG_X;
-			break;
-		case TXB:
-			this->REG_B = this->REG_X;
-			break;
-		case TXY:
-			this->REG_Y = this->REG_X;
-			break;
-		case TXSP:
-			this->SP = this->REG_X;
-			break;
-		case INCX:
-			this->REG_X += 1;
-			break;
-		case DECX:
-			this->REG_X -= 1;
-			break;
+	static SIN_FORCE_INLINE void not_implemented(SINVM&, const DecodedInstruction&) {
+		// todo: implement ADDCB, SUBCB, the single-precision FPU instructions, IRQ, and RTI
+		return;
+	}
 
-		// Y register
-		case LOADY:
-			REG_Y = this->execute_load();
-			break;
-		case STOREY:
-			this->execute_store(REG_Y);
-			break;
-		case TYA:
-			this->REG_A = this->REG_Y;
-			break;
-		case TYB:
-			this->REG_B = this->REG_Y;
-			break;
-		case TYX:
-			this->REG_X = this->REG_Y;
-			break;
-		case TYSP:
-			this->SP = this->REG_Y;
-			break;
-		case INCY:
-			this->REG_Y += 1;
-			break;
-		case DECY:
-			this->REG_Y -= 1;
-			break;
-		
-		/*
-		
-		ALU INSTRUCTIONS
+	static SIN_FORCE_INLINE void illegal(SINVM& vm, const DecodedInstruction&) {
+		// if we encounter an unknown opcode, generate a SINSIGILL signal
+		vm.send_signal(SINSIGILL);
+	}
 
-		*/
-		case LSR: case LSL: case ROR: case ROL:
-		{
-			this->execute_bitshift(opcode);		// todo: move bitshift instructions to ALU?
-			break;
-		}
-		case ADDCA:
-		{
-			// get the addend
-			uint16_t addend = this->execute_load();
-
-			// call the alu.add(...) function using the value we just fetched
-			this->alu.add(addend);
-			break;
-		}
-		case ADDCB:
-		{
-			// todo: implement the ADDCB instruction
-			break;
+	static SIN_FORCE_INLINE void illegal_mode(SINVM& vm, const DecodedInstruction&) {
+		// the instruction can't use its addressing mode; back up the PC to the opcode, as execute_load and execute_store do, and generate a SINSIGILL signal
+		vm.PC -= (vm._WORDSIZE / 8) + 1;
+		vm.send_signal(SINSIGILL);
+	}
+
+	/*
+
+	REGISTER INSTRUCTIONS
+
+	*/
+
+	// A register
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void loada(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.REG_A = vm.load_operand<mode>(instruction);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void storea(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.store_operand<mode>(vm.REG_A, instruction);
+	}
+	static SIN_FORCE_INLINE void tab(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.REG_A;
+	}
+	static SIN_FORCE_INLINE void tax(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X = vm.REG_A;
+	}
+	static SIN_FORCE_INLINE void tay(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y = vm.REG_A;
+	}
+	static SIN_FORCE_INLINE void tasp(SINVM& vm, const DecodedInstruction&) {
+		vm.SP = vm.REG_A;
+	}
+	static SIN_FORCE_INLINE void tastatus(SINVM& vm, const DecodedInstruction&) {
+		vm.flags.discard();
+		vm.STATUS = vm.REG_A;
+	}
+	static SIN_FORCE_INLINE void inca(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A += 1;
+	}
+	static SIN_FORCE_INLINE void deca(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A -= 1;
+	}
+
+	// B register
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void loadb(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.REG_B = vm.load_operand<mode>(instruction);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void storeb(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.store_operand<mode>(vm.REG_B, instruction);
+	}
+	static SIN_FORCE_INLINE void tba(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.REG_B;
+	}
+	static SIN_FORCE_INLINE void tbx(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X = vm.REG_B;
+	}
+	static SIN_FORCE_INLINE void tby(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y = vm.REG_B;
+	}
+	static SIN_FORCE_INLINE void tbsp(SINVM& vm, const DecodedInstruction&) {
+		vm.SP = vm.REG_B;
+	}
+	static SIN_FORCE_INLINE void tbstatus(SINVM& vm, const DecodedInstruction&) {
+		vm.flags.discard();
+		vm.STATUS = vm.REG_B;
+	}
+	static SIN_FORCE_INLINE void incb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B += 1;
+	}
+	static SIN_FORCE_INLINE void decb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B -= 1;
+	}
+
+	// X register
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void loadx(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.REG_X = vm.load_operand<mode>(instruction);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void storex(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.store_operand<mode>(vm.REG_X, instruction);
+	}
+	static SIN_FORCE_INLINE void txa(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.REG_X;
+	}
+	static SIN_FORCE_INLINE void txb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.REG_X;
+	}
+	static SIN_FORCE_INLINE void txy(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y = vm.REG_X;
+	}
+	static SIN_FORCE_INLINE void txsp(SINVM& vm, const DecodedInstruction&) {
+		vm.SP = vm.REG_X;
+	}
+	static SIN_FORCE_INLINE void incx(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X += 1;
+	}
+	static SIN_FORCE_INLINE void decx(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X -= 1;
+	}
+
+	// Y register
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void loady(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.REG_Y = vm.load_operand<mode>(instruction);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void storey(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.store_operand<mode>(vm.REG_Y, instruction);
+	}
+	static SIN_FORCE_INLINE void tya(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.REG_Y;
+	}
+	static SIN_FORCE_INLINE void tyb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.REG_Y;
+	}
+	static SIN_FORCE_INLINE void tyx(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X = vm.REG_Y;
+	}
+	static SIN_FORCE_INLINE void tysp(SINVM& vm, const DecodedInstruction&) {
+		vm.SP = vm.REG_Y;
+	}
+	static SIN_FORCE_INLINE void incy(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y += 1;
+	}
+	static SIN_FORCE_INLINE void decy(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y -= 1;
+	}
+
+	/*
+
+	ALU INSTRUCTIONS
+
+	*/
+
+	static SIN_FORCE_INLINE void bitshift(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.execute_bitshift(instruction);		// todo: move bitshift instructions to ALU?
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void addca(SINVM& vm, const DecodedInstruction& instruction) {
+		// get the addend
+		word_t addend = vm.load_operand<mode>(instruction);
+
+		// call the alu.add(...) function using the value we just fetched
+		vm.alu.add(addend);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void subca(SINVM& vm, const DecodedInstruction& instruction) {
+		// in subtraction, REG_A is the minuend and the value supplied is the subtrahend
+		word_t subtrahend = vm.load_operand<mode>(instruction);
+
+		// call the alu.sub function using the value we just fetched
+		vm.alu.sub(subtrahend);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void multa(SINVM& vm, const DecodedInstruction& instruction) {
+		// Multiply A by some value; treat both integers as signed
+		word_t multiplier = vm.load_operand<mode>(instruction);
+
+		// call alu.mult_signed using the multiplier value we just fetched
+		vm.alu.mult_signed(multiplier);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void diva(SINVM& vm, const DecodedInstruction& instruction) {
+		// Signed division on A by some value; this uses _integer division_ where B will hold the remainder of the operation
+		// fetch the right operand and call the ALU div_signed function using said operand as an argument
+		word_t divisor = vm.load_operand<mode>(instruction);
+
+		// if the divisor is 0, send a SINSIGFPE to the processor
+		if (divisor == 0) {
+			vm.PC -= (vm._WORDSIZE / 8) + 1;	// the PC will be on the last byte of the data, so it needs to be backed up past the data and the addressing mode to point to the opcode
+			vm.send_signal(SINSIGFPE);
 		}
-		case SUBCA:
-		{
-			// in subtraction, REG_A is the minuend and the value supplied is the subtrahend
-			uint16_t subtrahend = this->execute_load();
-
-			// call the alu.sub function using the value we just fetched
-			this->alu.sub(subtrahend);
-			break;
+		else {
+			vm.alu.div_signed(divisor);
 		}
-		case SUBCB:
-		{
-			// todo: implement the SUBCB instruction
-			break;
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void multua(SINVM& vm, const DecodedInstruction& instruction) {
+		// Unsigned multiplication
+		// fetch the value and call ALU::mult_unsigned(...) using the value we fetched as our argument
+		word_t multiplier = vm.load_operand<mode>(instruction);
+		vm.alu.mult_unsigned(multiplier);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void divua(SINVM& vm, const DecodedInstruction& instruction) {
+		// Unsigned division; B will hold the remainder from the operation
+
+		// fetch the right operand
+		word_t divisor = vm.load_operand<mode>(instruction);
+
+		// if the operand is 0, send a SINSIGFPE to the processor
+		if (divisor == 0) {
+			vm.set_status_flag('U');
+			vm.PC -= (vm._WORDSIZE / 8) + 1;	// like above, back up the PC to point to the opcode
+			vm.send_signal(SINSIGFPE);
 		}
-		case MULTA:
-		{
-			// Multiply A by some value; treat both integers as signed
-			uint16_t multiplier = this->execute_load();
-
-			// call alu.mult_signed using the multiplier value we just fetched
-			this->alu.mult_signed(multiplier);
-			break;
+		else {
+			// call the ALU's div_unsigned function using the value we just fetched as the parameter
+			vm.alu.div_unsigned(divisor);
 		}
-		case DIVA:
-		{
-			// Signed division on A by some value; this uses _integer division_ where B will hold the remainder of the operation
-			// fetch the right operand and call the ALU div_signed function using said operand as an argument
-			uint16_t divisor = this->execute_load();
-
-			// if the divisor is 0, send a SINSIGFPE to the processor
-			if (divisor == 0) {
-				this->PC -= 3;	// the PC will be on the last byte of the data, so it needs to be backed up 3 bytes to point to the opcode
-				this->send_signal(SINSIGFPE);
-			}
-			else {
-				this->alu.div_signed(divisor);
-			}
-			break;
+	}
+
+	// Logical operations
+	// todo: move logical operation instructions to ALU
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void anda(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t and_value = vm.load_operand<mode>(instruction);
+
+		vm.REG_A = vm.REG_A & and_value;
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void ora(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t or_value = vm.load_operand<mode>(instruction);
+
+		vm.REG_A = vm.REG_A | or_value;
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void xora(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t xor_value = vm.load_operand<mode>(instruction);
+
+		vm.REG_A = vm.REG_A ^ xor_value;
+	}
+
+	// Comparatives
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void cmpa(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.compare_values(vm.REG_A, vm.load_operand<mode>(instruction));
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void cmpb(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.compare_values(vm.REG_B, vm.load_operand<mode>(instruction));
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void cmpx(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.compare_values(vm.REG_X, vm.load_operand<mode>(instruction));
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void cmpy(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.compare_values(vm.REG_Y, vm.load_operand<mode>(instruction));
+	}
+
+	/*
+
+	FPU INSTRUCTIONS
+	todo: implement FPU instructions
+
+	*/
+
+	// 16-bit
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void fadda(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t addend = vm.load_operand<mode>(instruction);
+		vm.fpu.fadda(addend);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void fsuba(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t subtrahend = vm.load_operand<mode>(instruction);
+		vm.fpu.fsuba(subtrahend);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void fmulta(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t multiplier = vm.load_operand<mode>(instruction);
+		vm.fpu.fmulta(multiplier);
+	}
+	template<uint8_t mode>
+	static SIN_FORCE_INLINE void fdiva(SINVM& vm, const DecodedInstruction& instruction) {
+		word_t divisor = vm.load_operand<mode>(instruction);
+		if (divisor == 0) {
+			vm.PC -= (vm._WORDSIZE / 8) + 1;
+			vm.send_signal(SINSIGFPE);
 		}
-		case MULTUA:
-		{
-			// Unsigned multiplication
-			// fetch the value and call ALU::mult_unsigned(...) using the value we fetched as our argument
-			uint16_t multiplier = this->execute_load();
-			this->alu.mult_unsigned(multiplier);
-			break;
+		else {
+			vm.fpu.fdiva(divisor);
 		}
-		case DIVUA:
-		{
-			// Unsigned division; B will hold the remainder from the operation
-
-			// fetch the right operand
-			uint16_t divisor = this->execute_load();
-
-			// if the operand is 0, send a SINSIGFPE to the processor
-			if (divisor == 0) {
-				this->set_status_flag('U');
-				this->PC -= 3;	// like above, back up the PC 3 bytes to point to the opcode
-				this->send_signal(SINSIGFPE);
-			}
-			else {
-				// call the ALU's div_unsigned function using the value we just fetched as the parameter
-				this->alu.div_unsigned(divisor);
-			}
-			break;
+
+		// make sure we didn't get an undefined result; if we did, then generate a floating point error
+		if (vm.is_flag_set('U')) {
+			vm.send_signal(SINSIGFPE);
 		}
+	}
 
-		// Logical operations
-		// todo: move logical operation instructions to ALU
-		case ANDA:
-		{
-			uint16_t and_value = this->execute_load();
+	// 32-bit
+	// todo: devise a method to load a 32-bit value (these use not_implemented for now)
 
-			REG_A = REG_A & and_value;
-			break;
-		}
-		case ORA:
-		{
-			uint16_t or_value = this->execute_load();
+	/*
 
-			REG_A = REG_A | or_value;
-			break;
-		}
-		case XORA:
-		{
-			uint16_t xor_value = this->execute_load();
+	STACK INSTRUCTIONS
 
-			REG_A = REG_A ^ xor_value;
-			break;
-		}
+	*/
 
-		// Comparatives
-		case CMPA:
-			this->execute_comparison(REG_A);
-			break;
-		case CMPB:
-			this->execute_comparison(REG_B);
-			break;
-		case CMPX:
-			this->execute_comparison(REG_X);
-			break;
-		case CMPY:
-			this->execute_comparison(REG_Y);
-			break;
+	static SIN_FORCE_INLINE void pha(SINVM& vm, const DecodedInstruction&) {
+		vm.push_stack(vm.REG_A);
+	}
+	static SIN_FORCE_INLINE void phb(SINVM& vm, const DecodedInstruction&) {
+		vm.push_stack(vm.REG_B);
+	}
+	static SIN_FORCE_INLINE void pla(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.pop_stack();
+	}
+	static SIN_FORCE_INLINE void plb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.pop_stack();
+	}
+	static SIN_FORCE_INLINE void prsa(SINVM& vm, const DecodedInstruction&) {
+		vm.push_call_stack(vm.REG_A);
+	}
+	static SIN_FORCE_INLINE void prsb(SINVM& vm, const DecodedInstruction&) {
+		vm.push_call_stack(vm.REG_B);
+	}
+	static SIN_FORCE_INLINE void rsta(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.pop_call_stack();
+	}
+	static SIN_FORCE_INLINE void rstb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.pop_call_stack();
+	}
+	static SIN_FORCE_INLINE void prsr(SINVM& vm, const DecodedInstruction&) {
+		/*
+
+		Preserve registers, pushed in the following order:
+			- A
+			- B
+			- X
+			- Y
+			- SP
+			- STATUS
+		One word is used for each register, meaning we need 6 words total, or 12 bytes
+
+		*/
 
+
+		vm.flags.resolve();
+
+		// create an array of uint8_t holding all of our data
+		word_t to_push[6] = { vm.REG_A, vm.REG_B, vm.REG_X,  vm.REG_Y, vm.SP, vm.STATUS };
+
+		// push the elements of the array to our stack
+		for (size_t i = 0; i < 6; i++) {
+			vm.push_call_stack(to_push[i]);
+		}
+	}
+	static SIN_FORCE_INLINE void rstr(SINVM& vm, const DecodedInstruction&) {
 		/*
-		
-		FPU INSTRUCTIONS
-		todo: implement FPU instructions
-		
+
+		Pull registers in the reverse order as we pushed them
+
 		*/
 
-		// 16-bit
-		case FADDA:
-		{
-			uint16_t addend = this->execute_load();
-			this->fpu.fadda(addend);
-			break;
+		vm.flags.resolve();	// popping may generate a signal before STATUS is overwritten, so the flags must be up to date
+
+		vm.STATUS = (uint16_t)vm.pop_call_stack();
+
+		word_t* popped[5] = { &vm.SP, &vm.REG_Y, &vm.REG_X, &vm.REG_B, &vm.REG_A };
+		for (size_t i = 0; i < 5; i++) {
+			*(popped[i]) = vm.pop_call_stack();
 		}
-		case FSUBA:
-		{
-			uint16_t subtrahend = this->execute_load();
-			this->fpu.fsuba(subtrahend);
-			break;
+	}
+	static SIN_FORCE_INLINE void tspa(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_A = vm.SP;
+	}
+	static SIN_FORCE_INLINE void tspb(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_B = vm.SP;
+	}
+	static SIN_FORCE_INLINE void tspx(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_X = vm.SP;
+	}
+	static SIN_FORCE_INLINE void tspy(SINVM& vm, const DecodedInstruction&) {
+		vm.REG_Y = vm.SP;
+	}
+	static SIN_FORCE_INLINE void incsp(SINVM& vm, const DecodedInstruction&) {
+		// Make sure that incrementing the SP will not cause a stack fault
+		if (vm.SP <= (_STACK - (vm._WORDSIZE / 8))) {
+			vm.SP += (vm._WORDSIZE / 8);	// incrementing the stack pointer increments by a _word_, not a _byte_
+		}
+		else {
+			vm.send_signal(SINSIGSTKFLT);	// otherwise, send a stack fault signal
+		}
+	}
+	static SIN_FORCE_INLINE void decsp(SINVM& vm, const DecodedInstruction&) {
+		// Same procedure as INCSP, basically
+		if (vm.SP >= (_STACK_BOTTOM + (vm._WORDSIZE / 8))) {
+			vm.SP -= (vm._WORDSIZE / 8);
+		}
+		else {
+			vm.send_signal(SINSIGSTKFLT);
+		}
+	}
+
+	/*
+
+	STATUS Register Intructions
+
+	*/
+
+	static SIN_FORCE_INLINE void clc(SINVM& vm, const DecodedInstruction&) {
+		vm.clear_status_flag('C');
+	}
+	static SIN_FORCE_INLINE void sec(SINVM& vm, const DecodedInstruction&) {
+		vm.set_status_flag('C');
+	}
+	static SIN_FORCE_INLINE void cln(SINVM& vm, const DecodedInstruction&) {
+		vm.clear_status_flag('N');
+	}
+	static SIN_FORCE_INLINE void sen(SINVM& vm, const DecodedInstruction&) {
+		vm.set_status_flag('N');
+	}
+	static SIN_FORCE_INLINE void clf(SINVM& vm, const DecodedInstruction&) {
+		vm.clear_status_flag('F');
+	}
+	static SIN_FORCE_INLINE void sef(SINVM& vm, const DecodedInstruction&) {
+		vm.set_status_flag('F');
+	}
+	static SIN_FORCE_INLINE void tstatusa(SINVM& vm, const DecodedInstruction&) {
+		vm.flags.resolve();
+		vm.REG_A = vm.STATUS;
+	}
+	static SIN_FORCE_INLINE void tstatusb(SINVM& vm, const DecodedInstruction&) {
+		vm.flags.resolve();
+		vm.REG_B = vm.STATUS;
+	}
+
+	/*
+
+	Control Flow Instructions
+
+	If a branch is not taken, the PC already points to the last byte of the instruction, so there is nothing to skip
+
+	*/
+
+	static SIN_FORCE_INLINE void jump_to(SINVM& vm, const DecodedInstruction& instruction) {
+		// nearly every jump and branch uses an absolute address, which needs no help from execute_jmp
+		if (instruction.addressing_mode == addressingmode::absolute) {
+			vm.PC = instruction.operand - 1;	// one byte before the target, as the PC is incremented at the end of each cycle
+		}
+		else {
+			vm.execute_jmp(instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void jmp(SINVM& vm, const DecodedInstruction& instruction) {
+		jump_to(vm, instruction);
+	}
+	static SIN_FORCE_INLINE void brne(SINVM& vm, const DecodedInstruction& instruction) {
+		// BRNE and BRZ both test for the Z flag; no sense in repeating code
+		// if the comparison was unequal, the Z flag will be clear; if it's set, we do not branch
+		if (!vm.is_flag_set('Z')) {
+			// if it's clear, branch
+			jump_to(vm, instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void breq(SINVM& vm, const DecodedInstruction& instruction) {
+		// if the comparison was equal, the Z flag will be set
+		if (vm.is_flag_set('Z')) {
+			// if it's set, execute a jump
+			jump_to(vm, instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void brgt(SINVM& vm, const DecodedInstruction& instruction) {
+		// the carry flag will be set if the value is greater than what we compared it to
+		if (vm.is_flag_set('C')) {
+			jump_to(vm, instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void brlt(SINVM& vm, const DecodedInstruction& instruction) {
+		// the carry flag will be clear if the value is less than what we compared it to
+		if (!vm.is_flag_set('C')) {
+			jump_to(vm, instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void brn(SINVM& vm, const DecodedInstruction& instruction) {
+		// branch on negative; if the N flag is set, branch
+		if (vm.is_flag_set('N')) {
+			jump_to(vm, instruction);
+		}
+	}
+	static SIN_FORCE_INLINE void brpl(SINVM& vm, const DecodedInstruction& instruction) {
+		// branch on plus; if the N flag is clear, branch
+		if (!vm.is_flag_set('N')) {
+			jump_to(vm, instruction);
 		}
-		case FMULTA:
-		{
-			uint16_t multiplier = this->execute_load();
-			this->fpu.fmulta(multiplier);
-			break;
+	}
+	static SIN_FORCE_INLINE void jsr(SINVM& vm, const DecodedInstruction& instruction) {
+		// get the address to which we are jumping
+		word_t address_to_jump = instruction.operand;
+		word_t return_address = vm.PC;	// the current address is the last of the instruction, which is where we want to return
+
+		if (vm.CALL_SP > _CALL_STACK_BOTTOM) {
+			vm.push_call_stack(return_address);
+			vm.PC = address_to_jump - 1;	// jump to one byte before the next instruction, as the PC is incremented at the end of each cycle
 		}
-		case FDIVA:
-		{
-			uint16_t divisor = this->execute_load();
-			if (divisor == 0) {
-				this->PC -= 3;
-				this->send_signal(SINSIGFPE);
-			}
-			else {
-				this->fpu.fdiva(divisor);
-			}
-
-			// make sure we didn't get an undefined result; if we did, then generate a floating point error
-			if (this->is_flag_set('U')) {
-				this->send_signal(SINSIGFPE);
-			}
-
-			break;
+		else {
+			vm.PC -= (vm._WORDSIZE / 8) + 1;
+			vm.send_signal(SINSIGSTKFLT);
 		}
-		
-		// 32-bit
-		// todo: devise a method to load a 32-bit value
-		case SFADDA:
-			break;
-		case SFSUBA:
-			break;
-		case SFMULTA:
-			break;
-		case SFDIVA:
-			break;
+	}
+	static SIN_FORCE_INLINE void rts(SINVM& vm, const DecodedInstruction&) {
+		word_t return_address = vm.pop_call_stack();
+		vm.PC = return_address;	// we don't need to offset because the absolute address was pushed to the call stack
+	}
+
+	// Vector ALU instructions
+	static SIN_FORCE_INLINE void vector_operation(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.execute_vector_operation(instruction.opcode);
+	}
+	static SIN_FORCE_INLINE void vsum(SINVM& vm, const DecodedInstruction&) {
+		vm.sum_vector();
+	}
+
+	// Miscellaneous instructions
+	static SIN_FORCE_INLINE void movm(SINVM& vm, const DecodedInstruction&) {
+		vm.move_memory();
+	}
+	static SIN_FORCE_INLINE void fillm(SINVM& vm, const DecodedInstruction&) {
+		vm.fill_memory();
+	}
 
+	// System instructions
+	static SIN_FORCE_INLINE void brk(SINVM& vm, const DecodedInstruction&) {
 		/*
-		
-		STACK INSTRUCTIONS
-		
+		Temporary debugging instruction; will be deleted once the actual debugger is implemented
 		*/
+		vm.flags.resolve();
+		// BRK waits for the user, so everything the program has written must be shown first
+		vm.output.flush();
+		std::ostream& output = vm.output.get_stream();
+		output << "A: $" << std::hex << vm.REG_A << std::endl;
+		output << "B: $" << vm.REG_B << std::endl;
+		output << "X: $" << vm.REG_X << std::endl;
+		output << "Y: $" << vm.REG_Y << std::endl;
+		output << "SP: $" << vm.SP << std::endl;
+		output << "CALL: $" << vm.CALL_SP << std::endl;
+		output << "STATUS: $" << vm.STATUS << std::endl;
+		vm.input->clear();
+		vm.input->get();
+	}
+	static SIN_FORCE_INLINE void syscall(SINVM& vm, const DecodedInstruction& instruction) {
+		vm.execute_syscall(instruction);	// call the execute_syscall function; this will handle everything for us
+	}
+	static SIN_FORCE_INLINE void reset(SINVM& vm, const DecodedInstruction&) {
+		// if we get a RESET instruction, generate a SINSIGRESET signal
+		vm.send_signal(SINSIGRESET);
+	}
+	static SIN_FORCE_INLINE void halt(SINVM& vm, const DecodedInstruction&) {
+		// if we get a HALT instruction, we want to set the H flag, which will stop the VM in its main loop
+		vm.set_status_flag('H');
+	}
+};
+
+
+void SINVM::run_switch_dispatch(int64_t& budget) {
+	/*
+
+	The main loop for SWITCH_DISPATCH: fetch the instruction at the PC, select its handler with a switch on the opcode, and execute it.
+	The switch is written in the loop itself, rather than in a function the loop calls, so that the compiler can inline the handlers into it.
+
+	The instruction has already been decoded, so before executing it, we advance the PC to the last byte of the instruction; this is where the PC would be if we had read the addressing mode and data byte by byte. The PC is then incremented at the end of the cycle as usual.
+
+	*/
+
+	DispatchCounters counters(*this, budget);
+	word_t pc = this->PC;	// always equal to this->PC at the top of the loop, but held in a register; see the end of the loop
+
+	// as long as the HALT flag is not set
+	while (!(this->is_halted()) && (counters.remaining > 0)) {
+		const DecodedInstruction& instruction = this->fetch_instruction(pc);
+		counters.cycles += instruction.cycles;
+		word_t next_pc = pc + instruction.length;
+		this->PC = next_pc - 1;
 
-		case PHA:
-			this->push_stack(REG_A);
-			break;
-		case PHB:
-			this->push_stack(REG_B);
-			break;
-		case PLA:
-			REG_A = this->pop_stack();
-			break;
-		case PLB:
-			REG_B = this->pop_stack();
-			break;
-		case PRSA:
-			this->push_call_stack(this->REG_A);
-			break;
-		case PRSB:
-			this->push_call_stack(this->REG_B);
-			break;
-		case RSTA:
-			this->REG_A = this->pop_call_stack();
-			break;
-		case RSTB:
-			this->REG_B = this->pop_call_stack();
-			break;
-		case PRSR:
-		{
+		switch (instruction.opcode) {
 			/*
-			
-			Preserve registers, pushed in the following order:
-				- A
-				- B
-				- X
-				- Y
-				- SP
-				- STATUS
-			One word is used for each register, meaning we need 6 words total, or 12 bytes
+
+			GENERAL PROCESSOR INSTRUCTIONS
 
 			*/
 
-			
-			// create an array of uint8_t holding all of our data
-			uint16_t to_push[6] = { this->REG_A, this->REG_B, this->REG_X,  this->REG_Y, this->SP, this->STATUS };
+			case NOOP:
+				InstructionHandlers::noop(*this, instruction);
+				break;
 
-			// push the elements of the array to our stack
-			for (size_t i = 0; i < 6; i++) {
-				this->push_call_stack(to_push[i]);
-			}
+			/*
+
+			REGISTER INSTRUCTIONS
+
+			*/
+
+			// A register
+			case LOADA:
+				InstructionHandlers::loada<operandmode::generic>(*this, instruction);
+				break;
+			case STOREA:
+				InstructionHandlers::storea<operandmode::generic>(*this, instruction);
+				break;
+			case TAB:
+				InstructionHandlers::tab(*this, instruction);
+				break;
+			case TAX:
+				InstructionHandlers::tax(*this, instruction);
+				break;
+			case TAY:
+				InstructionHandlers::tay(*this, instruction);
+				break;
+			case TASP:
+				InstructionHandlers::tasp(*this, instruction);
+				break;
+			case TASTATUS:
+				InstructionHandlers::tastatus(*this, instruction);
+				break;
+			case INCA:
+				InstructionHandlers::inca(*this, instruction);
+				break;
+			case DECA:
+				InstructionHandlers::deca(*this, instruction);
+				break;
+
+			// B register
+			case LOADB:
+				InstructionHandlers::loadb<operandmode::generic>(*this, instruction);
+				break;
+			case STOREB:
+				InstructionHandlers::storeb<operandmode::generic>(*this, instruction);
+				break;
+			case TBA:
+				InstructionHandlers::tba(*this, instruction);
+				break;
+			case TBX:
+				InstructionHandlers::tbx(*this, instruction);
+				break;
+			case TBY:
+				InstructionHandlers::tby(*this, instruction);
+				break;
+			case TBSP:
+				InstructionHandlers::tbsp(*this, instruction);
+				break;
+			case TBSTATUS:
+				InstructionHandlers::tbstatus(*this, instruction);
+				break;
+			case INCB:
+				InstructionHandlers::incb(*this, instruction);
+				break;
+			case DECB:
+				InstructionHandlers::decb(*this, instruction);
+				break;
+
+			// X register
+			case LOADX:
+				InstructionHandlers::loadx<operandmode::generic>(*this, instruction);
+				break;
+			case STOREX:
+				InstructionHandlers::storex<operandmode::generic>(*this, instruction);
+				break;
+			case TXA:
+				InstructionHandlers::txa(*this, instruction);
+				break;
+			case TXB:
+				InstructionHandlers::txb(*this, instruction);
+				break;
+			case TXY:
+				InstructionHandlers::txy(*this, instruction);
+				break;
+			case TXSP:
+				InstructionHandlers::txsp(*this, instruction);
+				break;
+			case INCX:
+				InstructionHandlers::incx(*this, instruction);
+				break;
+			case DECX:
+				InstructionHandlers::decx(*this, instruction);
+				break;
+
+			// Y register
+			case LOADY:
+				InstructionHandlers::loady<operandmode::generic>(*this, instruction);
+				break;
+			case STOREY:
+				InstructionHandlers::storey<operandmode::generic>(*this, instruction);
+				break;
+			case TYA:
+				InstructionHandlers::tya(*this, instruction);
+				break;
+			case TYB:
+				InstructionHandlers::tyb(*this, instruction);
+				break;
+			case TYX:
+				InstructionHandlers::tyx(*this, instruction);
+				break;
+			case TYSP:
+				InstructionHandlers::tysp(*this, instruction);
+				break;
+			case INCY:
+				InstructionHandlers::incy(*this, instruction);
+				break;
+			case DECY:
+				InstructionHandlers::decy(*this, instruction);
+				break;
+
+			/*
+
+			ALU INSTRUCTIONS
+
+			*/
+			case LSR: case LSL: case ROR: case ROL:
+				InstructionHandlers::bitshift(*this, instruction);
+				break;
+			case ADDCA:
+				InstructionHandlers::addca<operandmode::generic>(*this, instruction);
+				break;
+			case SUBCA:
+				InstructionHandlers::subca<operandmode::generic>(*this, instruction);
+				break;
+			case MULTA:
+				InstructionHandlers::multa<operandmode::generic>(*this, instruction);
+				break;
+			case DIVA:
+				InstructionHandlers::diva<operandmode::generic>(*this, instruction);
+				break;
+			case MULTUA:
+				InstructionHandlers::multua<operandmode::generic>(*this, instruction);
+				break;
+			case DIVUA:
+				InstructionHandlers::divua<operandmode::generic>(*this, instruction);
+				break;
+			case ANDA:
+				InstructionHandlers::anda<operandmode::generic>(*this, instruction);
+				break;
+			case ORA:
+				InstructionHandlers::ora<operandmode::generic>(*this, instruction);
+				break;
+			case XORA:
+				InstructionHandlers::xora<operandmode::generic>(*this, instruction);
+				break;
+			case CMPA:
+				InstructionHandlers::cmpa<operandmode::generic>(*this, instruction);
+				break;
+			case CMPB:
+				InstructionHandlers::cmpb<operandmode::generic>(*this, instruction);
+				break;
+			case CMPX:
+				InstructionHandlers::cmpx<operandmode::generic>(*this, instruction);
+				break;
+			case CMPY:
+				InstructionHandlers::cmpy<operandmode::generic>(*this, instruction);
+				break;
 
-			break;
-		}
-		case RSTR:
-		{
 			/*
 
-			Pull registers in the reverse order as we pushed them
+			FPU INSTRUCTIONS
 
 			*/
 
-			uint16_t* popped[6] = { &this->STATUS, &this->SP, &this->REG_Y, &this->REG_X, &this->REG_B, &this->REG_A };
+			case FADDA:
+				InstructionHandlers::fadda<operandmode::generic>(*this, instruction);
+				break;
+			case FSUBA:
+				InstructionHandlers::fsuba<operandmode::generic>(*this, instruction);
+				break;
+			case FMULTA:
+				InstructionHandlers::fmulta<operandmode::generic>(*this, instruction);
+				break;
+			case FDIVA:
+				InstructionHandlers::fdiva<operandmode::generic>(*this, instruction);
+				break;
 
-			for (size_t i = 0; i < 6; i++) {
-				*(popped[i]) = this->pop_call_stack();
-			}
+			/*
 
-			break;
-		}
-		case TSPA:
-			this->REG_A = this->SP;
-			break;
-		case TSPB:
-			this->REG_B = this->SP;
-			break;
-		case TSPX:
-			this->REG_X = this->SP;
-			break;
-		case TSPY:
-			this->REG_Y = this->SP;
-			break;
-		case INCSP:
-			// Make sure that incrementing the SP will not cause a stack fault
-			if (this->SP <= (_STACK - (this->_WORDSIZE / 8))) {
-				this->SP += (this->_WORDSIZE / 8);	// incrementing the stack pointer increments by a _word_, not a _byte_
-			}
-			else {
-				this->send_signal(SINSIGSTKFLT);	// otherwise, send a stack fault signal
-			}
-			break;
-		case DECSP:
-			// Same procedure as INCSP, basically
-			if (this->SP >= (_STACK_BOTTOM + (this->_WORDSIZE / 8))) {
-				this->SP -= (this->_WORDSIZE / 8);
-			}
-			else {
-				this->send_signal(SINSIGSTKFLT);
-			}
-			break;
+			STACK INSTRUCTIONS
 
-		/*
-		
-		STATUS Register Intructions
-		
-		*/
-		
-		case CLC:
-			this->clear_status_flag('C');
-			break;
-		case SEC:
-			this->set_status_flag('C');
-			break;
-		case CLN:
-			this->clear_status_flag('N');
-			break;
-		case SEN:
-			this->set_status_flag('N');
-			break;
-		case CLF:
-			this->clear_status_flag('F');
-			break;
-		case SEF:
-			this->set_status_flag('F');
-			break;
-		case TSTATUSA:
-			this->REG_A = this->STATUS;
-			break;
-		case TSTATUSB:
-			this->REG_B = this->STATUS;
-			break;
+			*/
 
-		/*
-		
-		Control Flow Instructions
-		
-		*/
-		
-		case JMP:
-			this->execute_jmp();
-			break;
-		case BRNE: case BRZ:	// BRNE and BRZ both test for the Z flag; no sense in repeating code
-			// if the comparison was unequal, the Z flag will be clear; if it's set, we do not branch
-			if (this->is_flag_set('Z')) {
-				// skip past the addressing mode and address if it isn't set
-				// we need to skip past 3 bytes
-				this->PC += 3;
-			}
-			else {
-				// if it's clear, branch
-				this->execute_jmp();
-			}
-			break;
-		case BREQ:
-			// if the comparison was equal, the Z flag will be set
-			if (this->is_flag_set('Z')) {
-				// if it's set, execute a jump
-				this->execute_jmp();
-			}
-			else {
-				// skip past the addressing mode and address if it isn't set
-				this->PC += 3;
-			}
-			break;
-		case BRGT:
-			// the carry flag will be set if the value is greater than what we compared it to
-			if (this->is_flag_set('C')) {
-				this->execute_jmp();
-			}
-			else {
-				// skip past data we don't need
-				this->PC += 3;
-			}
-			break;
-		case BRLT:
-			// the carry flag will be clear if the value is less than what we compared it to
-			if (!this->is_flag_set('C')) {
-				this->execute_jmp();
-			}
-			else {
-				this->PC += 3;
-			}
-			break;
-		case BRN:
-			// branch on negative; if the N flag is set, branch
-			if (this->is_flag_set('N')) {
-				this->execute_jmp();
-			}
-			else {
-				this->PC += 3;
-			}
-		case BRPL:
-			// branch on plus; if the N flag is clear, branch
-			if (this->is_flag_set('N')) {
-				this->PC += 3;
-			}
-			else {
-				this->execute_jmp();
-			}
-		case IRQ:
-		{
-			// todo: implement IRQ instruction
-			break;
+			case PHA:
+				InstructionHandlers::pha(*this, instruction);
+				break;
+			case PHB:
+				InstructionHandlers::phb(*this, instruction);
+				break;
+			case PLA:
+				InstructionHandlers::pla(*this, instruction);
+				break;
+			case PLB:
+				InstructionHandlers::plb(*this, instruction);
+				break;
+			case PRSA:
+				InstructionHandlers::prsa(*this, instruction);
+				break;
+			case PRSB:
+				InstructionHandlers::prsb(*this, instruction);
+				break;
+			case RSTA:
+				InstructionHandlers::rsta(*this, instruction);
+				break;
+			case RSTB:
+				InstructionHandlers::rstb(*this, instruction);
+				break;
+			case PRSR:
+				InstructionHandlers::prsr(*this, instruction);
+				break;
+			case RSTR:
+				InstructionHandlers::rstr(*this, instruction);
+				break;
+			case TSPA:
+				InstructionHandlers::tspa(*this, instruction);
+				break;
+			case TSPB:
+				InstructionHandlers::tspb(*this, instruction);
+				break;
+			case TSPX:
+				InstructionHandlers::tspx(*this, instruction);
+				break;
+			case TSPY:
+				InstructionHandlers::tspy(*this, instruction);
+				break;
+			case INCSP:
+				InstructionHandlers::incsp(*this, instruction);
+				break;
+			case DECSP:
+				InstructionHandlers::decsp(*this, instruction);
+				break;
+
+			/*
+
+			STATUS Register Intructions
+
+			*/
+
+			case CLC:
+				InstructionHandlers::clc(*this, instruction);
+				break;
+			case SEC:
+				InstructionHandlers::sec(*this, instruction);
+				break;
+			case CLN:
+				InstructionHandlers::cln(*this, instruction);
+				break;
+			case SEN:
+				InstructionHandlers::sen(*this, instruction);
+				break;
+			case CLF:
+				InstructionHandlers::clf(*this, instruction);
+				break;
+			case SEF:
+				InstructionHandlers::sef(*this, instruction);
+				break;
+			case TSTATUSA:
+				InstructionHandlers::tstatusa(*this, instruction);
+				break;
+			case TSTATUSB:
+				InstructionHandlers::tstatusb(*this, instruction);
+				break;
+
+			/*
+
+			Control Flow Instructions
+
+			*/
+
+			case JMP:
+				InstructionHandlers::jmp(*this, instruction);
+				break;
+			case BRNE: case BRZ:
+				InstructionHandlers::brne(*this, instruction);
+				break;
+			case BREQ:
+				InstructionHandlers::breq(*this, instruction);
+				break;
+			case BRGT:
+				InstructionHandlers::brgt(*this, instruction);
+				break;
+			case BRLT:
+				InstructionHandlers::brlt(*this, instruction);
+				break;
+			case BRN:
+				InstructionHandlers::brn(*this, instruction);
+				break;
+			case BRPL:
+				InstructionHandlers::brpl(*this, instruction);
+				break;
+			case JSR:
+				InstructionHandlers::jsr(*this, instruction);
+				break;
+			case RTS:
+				InstructionHandlers::rts(*this, instruction);
+				break;
+
+			// Vector ALU instructions
+			case VADD:
+			case VSUB:
+			case VAND:
+			case VOR:
+			case VXOR:
+			case VCMP:
+				InstructionHandlers::vector_operation(*this, instruction);
+				break;
+			case VSUM:
+				InstructionHandlers::vsum(*this, instruction);
+				break;
+
+			// Miscellaneous instructions
+			case MOVM:
+				InstructionHandlers::movm(*this, instruction);
+				break;
+			case FILLM:
+				InstructionHandlers::fillm(*this, instruction);
+				break;
+
+			// System instructions
+			case BRK:
+				InstructionHandlers::brk(*this, instruction);
+				break;
+			case SYSCALL:
+				counters.flush();	// STD_CYCLES may read the cycle count
+				InstructionHandlers::syscall(*this, instruction);
+				break;
+			case RESET:
+				InstructionHandlers::reset(*this, instruction);
+				break;
+			case HALT:
+				InstructionHandlers::halt(*this, instruction);
+				break;
+
+			// instructions that have opcodes, but are not yet implemented
+			case ADDCB: case SUBCB: case SFADDA: case SFSUBA: case SFMULTA: case SFDIVA: case IRQ: case RTI:
+				InstructionHandlers::not_implemented(*this, instruction);
+				break;
+
+			// if we encounter an unknown opcode, generate a SINSIGILL signal
+			default:
+				InstructionHandlers::illegal(*this, instruction);
+				break;
 		}
-		case RTI:
-		{
-			// todo: implement RTI instruction
-			break;
+
+		// advance the program counter to point to the next instruction
+		// unless the handler moved the PC (a jump, or a signal), this is the byte after the one we left it on; testing for that, rather than incrementing whatever the handler left there, lets the next fetch start without waiting on the handler
+		if (this->PC != (word_t)(next_pc - 1)) {
+			next_pc = this->PC + 1;
 		}
-		case JSR:
-		{
-			// get the addressing mode
-			this->PC++;
-			uint8_t addressing_mode = this->memory[this->PC];
-
-			// get the value
-			this->PC++;
-			uint16_t address_to_jump = this->get_data_of_wordsize();
-			uint16_t return_address = this->PC;	// the current address is the last of the instruction, which is where we want to return
-
-			if (this->CALL_SP > _CALL_STACK_BOTTOM) {
-				this->push_call_stack(return_address);
-				this->PC = address_to_jump - 1;	// jump to one byte before the next instruction, as the PC is incremented at the end of each cycle
-			}
-			else {
-				this->PC -= 3;
-				this->send_signal(SINSIGSTKFLT);
-			}
-			break;
+		this->PC = next_pc;
+		pc = next_pc;
+		counters.remaining--;
+	}
+
+	return;
+}
+
+
+#if defined(SIN_DIRECT_THREADING)
+
+void SINVM::run_threaded_dispatch(int64_t& budget) {
+	this->run_threaded_code(budget, nullptr);
+}
+
+
+const void* SINVM::get_threaded_target(const DecodedInstruction& instruction) {
+	/*
+
+	Returns the address of the code in run_threaded_code(...) that executes 'instruction'; this is stored in the instruction when it is decoded.
+	The address of a label can only be taken in the function that contains it, so the first call asks the loop for its table of targets rather than running it. A static local is initialized only once, even if several VMs decode their programs at the same time.
+
+	*/
+
+	static const ThreadedTargets* targets = this->get_threaded_targets();
+
+	// fused instructions are executed by calling their handlers
+	if (instruction.fused > 1) {
+		return (*targets)[threadedslot::call_handler][threadedslot::generic];
+	}
+
+	uint8_t slot;
+	switch (instruction.addressing_mode) {
+		case addressingmode::immediate: slot = threadedslot::immediate; break;
+		case addressingmode::absolute: slot = threadedslot::absolute; break;
+		case addressingmode::x_index: slot = threadedslot::x_index; break;
+		case addressingmode::y_index: slot = threadedslot::y_index; break;
+		case addressingmode::reg_b: slot = threadedslot::reg_b; break;
+		default: slot = threadedslot::generic; break;
+	}
+
+	return (*targets)[instruction.opcode][slot];
+}
+
+
+const SINVM::ThreadedTargets* SINVM::get_threaded_targets() {
+	int64_t budget = 0;
+	const ThreadedTargets* targets = nullptr;
+	this->run_threaded_code(budget, &targets);
+	return targets;
+}
+
+
+void SINVM::run_threaded_code(int64_t& budget, const ThreadedTargets** targets_out) {
+	/*
+
+	The main loop for THREADED_DISPATCH, using direct threading: every decoded instruction holds the address of the code below that executes it (see get_threaded_target(...)), and the code for each instruction ends by fetching the next one and jumping straight to its target.
+	Because each instruction has its own copy of that jump, rather than all of them sharing the one at the top of a switch, the host's branch predictor can learn which instruction tends to follow which. Instructions that take an operand from memory also have a separate target for each of the common addressing modes, so the mode isn't tested at runtime either.
+
+	Otherwise, this behaves exactly like run_switch_dispatch(...); the PC, the counters, and the handlers are the same.
+	This needs the "labels as values" extension to C++, which GCC and Clang support; with other compilers, THREADED_DISPATCH uses the switch loop instead (see dispatch(...)).
+
+	*/
+
+	// the code for each opcode, and for each addressing mode; any opcode without an entry is illegal
+	static ThreadedTargets targets;
+
+	if (targets_out != nullptr) {
+		// fill in the table, rather than running the program; see get_threaded_target(...)
+#define THREADED_TARGET(opcode, name) \
+		for (uint8_t slot = 0; slot < threadedslot::num_slots; slot++) { targets[opcode][slot] = &&target_##name; }
+#define THREADED_OPERAND_TARGETS(opcode, name) \
+		targets[opcode][threadedslot::generic] = &&target_##name##_generic; \
+		targets[opcode][threadedslot::immediate] = &&target_##name##_immediate; \
+		targets[opcode][threadedslot::absolute] = &&target_##name##_absolute; \
+		targets[opcode][threadedslot::x_index] = &&target_##name##_x_index; \
+		targets[opcode][threadedslot::y_index] = &&target_##name##_y_index; \
+		targets[opcode][threadedslot::reg_b] = &&target_##name##_reg_b;
+
+		for (size_t opcode = 0; opcode < 256; opcode++) {
+			THREADED_TARGET(opcode, illegal);
 		}
-		case RTS:
-		{
-			uint16_t return_address = this->pop_call_stack();
-			this->PC = return_address;	// we don't need to offset because the absolute address was pushed to the call stack
-			break;
+		THREADED_TARGET(threadedslot::call_handler, call_handler);
+
+		THREADED_OPERAND_TARGETS(LOADA, loada);
+		THREADED_OPERAND_TARGETS(STOREA, storea);
+		THREADED_OPERAND_TARGETS(LOADB, loadb);
+		THREADED_OPERAND_TARGETS(STOREB, storeb);
+		THREADED_OPERAND_TARGETS(LOADX, loadx);
+		THREADED_OPERAND_TARGETS(STOREX, storex);
+		THREADED_OPERAND_TARGETS(LOADY, loady);
+		THREADED_OPERAND_TARGETS(STOREY, storey);
+		THREADED_OPERAND_TARGETS(ADDCA, addca);
+		THREADED_OPERAND_TARGETS(SUBCA, subca);
+		THREADED_OPERAND_TARGETS(MULTA, multa);
+		THREADED_OPERAND_TARGETS(DIVA, diva);
+		THREADED_OPERAND_TARGETS(MULTUA, multua);
+		THREADED_OPERAND_TARGETS(DIVUA, divua);
+		THREADED_OPERAND_TARGETS(ANDA, anda);
+		THREADED_OPERAND_TARGETS(ORA, ora);
+		THREADED_OPERAND_TARGETS(XORA, xora);
+		THREADED_OPERAND_TARGETS(CMPA, cmpa);
+		THREADED_OPERAND_TARGETS(CMPB, cmpb);
+		THREADED_OPERAND_TARGETS(CMPX, cmpx);
+		THREADED_OPERAND_TARGETS(CMPY, cmpy);
+		THREADED_OPERAND_TARGETS(FADDA, fadda);
+		THREADED_OPERAND_TARGETS(FSUBA, fsuba);
+		THREADED_OPERAND_TARGETS(FMULTA, fmulta);
+		THREADED_OPERAND_TARGETS(FDIVA, fdiva);
+		THREADED_TARGET(NOOP, noop);
+		THREADED_TARGET(TAB, tab);
+		THREADED_TARGET(TAX, tax);
+		THREADED_TARGET(TAY, tay);
+		THREADED_TARGET(TASP, tasp);
+		THREADED_TARGET(TASTATUS, tastatus);
+		THREADED_TARGET(INCA, inca);
+		THREADED_TARGET(DECA, deca);
+		THREADED_TARGET(TBA, tba);
+		THREADED_TARGET(TBX, tbx);
+		THREADED_TARGET(TBY, tby);
+		THREADED_TARGET(TBSP, tbsp);
+		THREADED_TARGET(TBSTATUS, tbstatus);
+		THREADED_TARGET(INCB, incb);
+		THREADED_TARGET(DECB, decb);
+		THREADED_TARGET(TXA, txa);
+		THREADED_TARGET(TXB, txb);
+		THREADED_TARGET(TXY, txy);
+		THREADED_TARGET(TXSP, txsp);
+		THREADED_TARGET(INCX, incx);
+		THREADED_TARGET(DECX, decx);
+		THREADED_TARGET(TYA, tya);
+		THREADED_TARGET(TYB, tyb);
+		THREADED_TARGET(TYX, tyx);
+		THREADED_TARGET(TYSP, tysp);
+		THREADED_TARGET(INCY, incy);
+		THREADED_TARGET(DECY, decy);
+		THREADED_TARGET(LSR, bitshift); THREADED_TARGET(LSL, bitshift); THREADED_TARGET(ROR, bitshift); THREADED_TARGET(ROL, bitshift);
+		THREADED_TARGET(PHA, pha);
+		THREADED_TARGET(PHB, phb);
+		THREADED_TARGET(PLA, pla);
+		THREADED_TARGET(PLB, plb);
+		THREADED_TARGET(PRSA, prsa);
+		THREADED_TARGET(PRSB, prsb);
+		THREADED_TARGET(RSTA, rsta);
+		THREADED_TARGET(RSTB, rstb);
+		THREADED_TARGET(PRSR, prsr);
+		THREADED_TARGET(RSTR, rstr);
+		THREADED_TARGET(TSPA, tspa);
+		THREADED_TARGET(TSPB, tspb);
+		THREADED_TARGET(TSPX, tspx);
+		THREADED_TARGET(TSPY, tspy);
+		THREADED_TARGET(INCSP, incsp);
+		THREADED_TARGET(DECSP, decsp);
+		THREADED_TARGET(CLC, clc);
+		THREADED_TARGET(SEC, sec);
+		THREADED_TARGET(CLN, cln);
+		THREADED_TARGET(SEN, sen);
+		THREADED_TARGET(CLF, clf);
+		THREADED_TARGET(SEF, sef);
+		THREADED_TARGET(TSTATUSA, tstatusa);
+		THREADED_TARGET(TSTATUSB, tstatusb);
+		THREADED_TARGET(JMP, jmp);
+		THREADED_TARGET(BRNE, brne); THREADED_TARGET(BRZ, brne);
+		THREADED_TARGET(BREQ, breq);
+		THREADED_TARGET(BRGT, brgt);
+		THREADED_TARGET(BRLT, brlt);
+		THREADED_TARGET(BRN, brn);
+		THREADED_TARGET(BRPL, brpl);
+		THREADED_TARGET(JSR, jsr);
+		THREADED_TARGET(RTS, rts);
+		THREADED_TARGET(VADD, vector_operation); THREADED_TARGET(VSUB, vector_operation); THREADED_TARGET(VAND, vector_operation); THREADED_TARGET(VOR, vector_operation); THREADED_TARGET(VXOR, vector_operation); THREADED_TARGET(VCMP, vector_operation);
+		THREADED_TARGET(VSUM, vsum);
+		THREADED_TARGET(MOVM, movm);
+		THREADED_TARGET(FILLM, fillm);
+		THREADED_TARGET(BRK, brk);
+		THREADED_TARGET(SYSCALL, syscall);
+		THREADED_TARGET(RESET, reset);
+		THREADED_TARGET(HALT, halt);
+		THREADED_TARGET(ADDCB, not_implemented); THREADED_TARGET(SUBCB, not_implemented); THREADED_TARGET(SFADDA, not_implemented); THREADED_TARGET(SFSUBA, not_implemented); THREADED_TARGET(SFMULTA, not_implemented); THREADED_TARGET(SFDIVA, not_implemented); THREADED_TARGET(IRQ, not_implemented); THREADED_TARGET(RTI, not_implemented);
+
+#undef THREADED_TARGET
+#undef THREADED_OPERAND_TARGETS
+
+		*targets_out = &targets;
+		return;
+	}
+
+	DispatchCounters counters(*this, budget);
+	int64_t remaining = counters.remaining;	// the counters are copied into locals, which GCC keeps in registers where it won't keep the members
+	uint64_t cycles = 0;
+	word_t pc = this->PC;	// the address of the instruction being executed; as in run_switch_dispatch(...), held in a register
+	word_t next_pc;	// the address of the instruction after it, if control doesn't leave it
+	const DecodedInstruction* instruction;
+
+	// the length of an instruction that reads an addressing mode and a word of data, and of one that reads only the addressing mode; see decode_instruction(...)
+	const word_t operand_length = 2 + (_WORDSIZE / 8);
+	const word_t mode_length = 2;
+
+	// fetch the instruction at pc and jump to the code that executes it
+#define DISPATCH() \
+	instruction = &this->fetch_instruction(pc); \
+	cycles += instruction->cycles; \
+	goto *instruction->target;
+
+	// advance the PC to the last byte of the instruction
+	// each target knows the length of the instructions it executes, so the address of the next instruction doesn't wait on a load from the decode cache; this is what keeps the fetches from forming one long chain
+#define BEGIN(length) \
+	next_pc = pc + (length); \
+	this->PC = next_pc - 1;
+
+	// go on to the instruction at pc, unless the VM halted or we are out of instructions
+#define DISPATCH_CONTINUE() \
+	this->PC = pc; \
+	if (this->is_halted() || (remaining <= 0)) { \
+		goto done; \
+	} \
+	DISPATCH();
+
+	// finish an instruction that only moves the PC if it raises a signal; that is rare, so it is handled out of line, which keeps the PC out of a data dependency
+#define DISPATCH_NEXT() \
+	remaining--; \
+	if (this->PC != (word_t)(next_pc - 1)) { \
+		goto pc_changed; \
+	} \
+	pc = next_pc; \
+	DISPATCH_CONTINUE();
+
+	// finish an instruction that may jump
+#define DISPATCH_JUMP() \
+	remaining--; \
+	pc = this->PC + 1; \
+	DISPATCH_CONTINUE();
+
+	// the code for an instruction, and for an instruction that may jump
+#define THREADED_CODE(name, length) \
+	target_##name: \
+		BEGIN(length); \
+		InstructionHandlers::name(*this, *instruction); \
+		DISPATCH_NEXT();
+#define THREADED_JUMP_CODE(name, length) \
+	target_##name: \
+		BEGIN(length); \
+		InstructionHandlers::name(*this, *instruction); \
+		DISPATCH_JUMP();
+
+	// the code for each addressing mode of an instruction that takes an operand from memory; only loads leave out the data in the B mode
+#define THREADED_OPERAND_CODE(name, reg_b_length) \
+	target_##name##_generic: BEGIN(operand_length); InstructionHandlers::name<operandmode::generic>(*this, *instruction); DISPATCH_NEXT(); \
+	target_##name##_immediate: BEGIN(operand_length); InstructionHandlers::name<addressingmode::immediate>(*this, *instruction); DISPATCH_NEXT(); \
+	target_##name##_absolute: BEGIN(operand_length); InstructionHandlers::name<addressingmode::absolute>(*this, *instruction); DISPATCH_NEXT(); \
+	target_##name##_x_index: BEGIN(operand_length); InstructionHandlers::name<addressingmode::x_index>(*this, *instruction); DISPATCH_NEXT(); \
+	target_##name##_y_index: BEGIN(operand_length); InstructionHandlers::name<addressingmode::y_index>(*this, *instruction); DISPATCH_NEXT(); \
+	target_##name##_reg_b: BEGIN(reg_b_length); InstructionHandlers::name<addressingmode::reg_b>(*this, *instruction); DISPATCH_NEXT();
+
+	// if a handler throws, the counts must still be written back, as the host may read them after a trap (see run_for(...))
+	try {
+		if (this->is_halted() || (remaining <= 0)) {
+			goto done;
 		}
+		DISPATCH();
+
+		// a signal moved the PC
+		pc_changed:
+			pc = this->PC + 1;
+			DISPATCH_CONTINUE();
+
+		// fused instructions, and any other instruction that must go through its handler; these may contain a jump
+		target_call_handler:
+			BEGIN(instruction->length);
+			instruction->handler(*this, *instruction);
+			remaining -= instruction->fused - 1;
+			DISPATCH_JUMP();
+
+		// instructions that take an operand from memory
+		THREADED_OPERAND_CODE(loada, mode_length)
+		THREADED_OPERAND_CODE(storea, operand_length)
+		THREADED_OPERAND_CODE(loadb, mode_length)
+		THREADED_OPERAND_CODE(storeb, operand_length)
+		THREADED_OPERAND_CODE(loadx, mode_length)
+		THREADED_OPERAND_CODE(storex, operand_length)
+		THREADED_OPERAND_CODE(loady, mode_length)
+		THREADED_OPERAND_CODE(storey, operand_length)
+		THREADED_OPERAND_CODE(addca, mode_length)
+		THREADED_OPERAND_CODE(subca, mode_length)
+		THREADED_OPERAND_CODE(multa, mode_length)
+		THREADED_OPERAND_CODE(diva, mode_length)
+		THREADED_OPERAND_CODE(multua, mode_length)
+		THREADED_OPERAND_CODE(divua, mode_length)
+		THREADED_OPERAND_CODE(anda, mode_length)
+		THREADED_OPERAND_CODE(ora, mode_length)
+		THREADED_OPERAND_CODE(xora, mode_length)
+		THREADED_OPERAND_CODE(cmpa, mode_length)
+		THREADED_OPERAND_CODE(cmpb, mode_length)
+		THREADED_OPERAND_CODE(cmpx, mode_length)
+		THREADED_OPERAND_CODE(cmpy, mode_length)
+		THREADED_OPERAND_CODE(fadda, mode_length)
+		THREADED_OPERAND_CODE(fsuba, mode_length)
+		THREADED_OPERAND_CODE(fmulta, mode_length)
+		THREADED_OPERAND_CODE(fdiva, mode_length)
+
+		// General processor instructions
+		THREADED_CODE(noop, 1)
+
+		// A register
+		THREADED_CODE(tab, 1)
+		THREADED_CODE(tax, 1)
+		THREADED_CODE(tay, 1)
+		THREADED_CODE(tasp, 1)
+		THREADED_CODE(tastatus, 1)
+		THREADED_CODE(inca, 1)
+		THREADED_CODE(deca, 1)
+
+		// B register
+		THREADED_CODE(tba, 1)
+		THREADED_CODE(tbx, 1)
+		THREADED_CODE(tby, 1)
+		THREADED_CODE(tbsp, 1)
+		THREADED_CODE(tbstatus, 1)
+		THREADED_CODE(incb, 1)
+		THREADED_CODE(decb, 1)
+
+		// X register
+		THREADED_CODE(txa, 1)
+		THREADED_CODE(txb, 1)
+		THREADED_CODE(txy, 1)
+		THREADED_CODE(txsp, 1)
+		THREADED_CODE(incx, 1)
+		THREADED_CODE(decx, 1)
+
+		// Y register
+		THREADED_CODE(tya, 1)
+		THREADED_CODE(tyb, 1)
+		THREADED_CODE(tyx, 1)
+		THREADED_CODE(tysp, 1)
+		THREADED_CODE(incy, 1)
+		THREADED_CODE(decy, 1)
+
+		// ALU instructions; the length of a bitshift depends on its addressing mode
+		THREADED_CODE(bitshift, instruction->length)
+
+		// Stack instructions
+		THREADED_CODE(pha, 1)
+		THREADED_CODE(phb, 1)
+		THREADED_CODE(pla, 1)
+		THREADED_CODE(plb, 1)
+		THREADED_CODE(prsa, 1)
+		THREADED_CODE(prsb, 1)
+		THREADED_CODE(rsta, 1)
+		THREADED_CODE(rstb, 1)
+		THREADED_CODE(prsr, 1)
+		THREADED_CODE(rstr, 1)
+		THREADED_CODE(tspa, 1)
+		THREADED_CODE(tspb, 1)
+		THREADED_CODE(tspx, 1)
+		THREADED_CODE(tspy, 1)
+		THREADED_CODE(incsp, 1)
+		THREADED_CODE(decsp, 1)
+
+		// STATUS register instructions
+		THREADED_CODE(clc, 1)
+		THREADED_CODE(sec, 1)
+		THREADED_CODE(cln, 1)
+		THREADED_CODE(sen, 1)
+		THREADED_CODE(clf, 1)
+		THREADED_CODE(sef, 1)
+		THREADED_CODE(tstatusa, 1)
+		THREADED_CODE(tstatusb, 1)
+
+		// Control flow instructions
+		THREADED_JUMP_CODE(jmp, operand_length)
+		THREADED_JUMP_CODE(brne, operand_length)
+		THREADED_JUMP_CODE(breq, operand_length)
+		THREADED_JUMP_CODE(brgt, operand_length)
+		THREADED_JUMP_CODE(brlt, operand_length)
+		THREADED_JUMP_CODE(brn, operand_length)
+		THREADED_JUMP_CODE(brpl, operand_length)
+		THREADED_JUMP_CODE(jsr, operand_length)
+		THREADED_JUMP_CODE(rts, 1)
+
+		// Vector ALU instructions
+		THREADED_CODE(vector_operation, 1)
+		THREADED_CODE(vsum, 1)
+
+		// Miscellaneous instructions
+		THREADED_CODE(movm, 1)
+		THREADED_CODE(fillm, 1)
 
 		// System instructions
-		case BRK:
-			/*
-			Temporary debugging instruction; will be deleted once the actual debugger is implemented
-			*/
-			std::cout << "A: $" << std::hex << this->REG_A << std::endl;
-			std::cout << "B: $" << this->REG_B << std::endl;
-			std::cout << "X: $" << this->REG_X << std::endl;
-			std::cout << "Y: $" << this->REG_Y << std::endl;
-			std::cout << "SP: $" << this->SP << std::endl;
-			std::cout << "CALL: $" << this->CALL_SP << std::endl;
-			std::cout << "STATUS: $" << this->STATUS << std::endl;
-			std::cin.clear();
-			std::cin.get();
-			break;
-		case SYSCALL:
-			this->execute_syscall();	// call the execute_syscall function; this will handle everything for us
-			break;
-		case RESET:
-			// if we get a RESET instruction, generate a SINSIGRESET signal
-			this->send_signal(SINSIGRESET);
-			break;
-		case HALT:
-			// if we get a HALT instruction, we want to set the H flag, which will stop the VM in its main loop
-			this->set_status_flag('H');
-			break;
+		THREADED_JUMP_CODE(brk, 1)
+		target_syscall:
+			BEGIN(operand_length);
+			counters.cycles = cycles;	// STD_CYCLES may read the cycle count
+			cycles = 0;
+			counters.flush();
+			InstructionHandlers::syscall(*this, *instruction);
+			DISPATCH_JUMP();
+		THREADED_JUMP_CODE(reset, 1)
+		THREADED_CODE(halt, 1)
+
+		// instructions that have opcodes, but are not yet implemented
+		THREADED_JUMP_CODE(not_implemented, 1)
 
 		// if we encounter an unknown opcode, generate a SINSIGILL signal
-		default:
-		{
-			this->send_signal(SINSIGILL);
-			break;
-		}
+		THREADED_JUMP_CODE(illegal, 1)
+	}
+	catch (...) {
+		counters.remaining = remaining;
+		counters.cycles = cycles;
+		throw;
 	}
 
+done:
+	counters.remaining = remaining;
+	counters.cycles = cycles;
 	return;
+
+#undef DISPATCH
+#undef BEGIN
+#undef DISPATCH_CONTINUE
+#undef DISPATCH_NEXT
+#undef DISPATCH_JUMP
+#undef THREADED_CODE
+#undef THREADED_JUMP_CODE
+#undef THREADED_OPERAND_CODE
+}
+
+#else
+
+void SINVM::run_threaded_dispatch(int64_t& budget) {
+	// without computed gotos, the switch loop is the fastest we have
+	this->run_switch_dispatch(budget);
+}
+
+#endif
+
+
+template<uint8_t mode>
+static InstructionHandler get_operand_handler(uint8_t opcode) {
+	/*
+
+	Returns the handler for an instruction that takes its operand from memory, specialized for the addressing mode 'mode'
+
+	*/
+
+	switch (opcode) {
+		case LOADA: return &InstructionHandlers::loada<mode>;
+		case STOREA: return &InstructionHandlers::storea<mode>;
+		case LOADB: return &InstructionHandlers::loadb<mode>;
+		case STOREB: return &InstructionHandlers::storeb<mode>;
+		case LOADX: return &InstructionHandlers::loadx<mode>;
+		case STOREX: return &InstructionHandlers::storex<mode>;
+		case LOADY: return &InstructionHandlers::loady<mode>;
+		case STOREY: return &InstructionHandlers::storey<mode>;
+		case ADDCA: return &InstructionHandlers::addca<mode>;
+		case SUBCA: return &InstructionHandlers::subca<mode>;
+		case MULTA: return &InstructionHandlers::multa<mode>;
+		case DIVA: return &InstructionHandlers::diva<mode>;
+		case MULTUA: return &InstructionHandlers::multua<mode>;
+		case DIVUA: return &InstructionHandlers::divua<mode>;
+		case ANDA: return &InstructionHandlers::anda<mode>;
+		case ORA: return &InstructionHandlers::ora<mode>;
+		case XORA: return &InstructionHandlers::xora<mode>;
+		case CMPA: return &InstructionHandlers::cmpa<mode>;
+		case CMPB: return &InstructionHandlers::cmpb<mode>;
+		case CMPX: return &InstructionHandlers::cmpx<mode>;
+		case CMPY: return &InstructionHandlers::cmpy<mode>;
+		case FADDA: return &InstructionHandlers::fadda<mode>;
+		case FSUBA: return &InstructionHandlers::fsuba<mode>;
+		case FMULTA: return &InstructionHandlers::fmulta<mode>;
+		case FDIVA: return &InstructionHandlers::fdiva<mode>;
+		default: return nullptr;	// not an instruction with a memory operand
+	}
+}
+
+
+InstructionHandler SINVM::get_instruction_handler(uint8_t opcode, uint8_t addressing_mode) {
+	/*
+
+	Returns the handler for the given instruction. This is used when an instruction is decoded so that the threaded dispatch loop can call the handler directly.
+	For instructions that take an operand from memory, the handler is specialized for the instruction's addressing mode; if the instruction can't use that mode, the handler generates a SINSIGILL signal.
+
+	*/
+
+	if (get_operand_handler<operandmode::generic>(opcode) != nullptr) {
+		// a store has nowhere to put its value with the immediate or register modes
+		bool is_store = (opcode == STOREA) || (opcode == STOREB) || (opcode == STOREX) || (opcode == STOREY);
+		if (is_store && ((addressing_mode == addressingmode::immediate) || (addressing_mode == addressingmode::immediate_short) || (addressing_mode == addressingmode::reg_b))) {
+			return &InstructionHandlers::illegal_mode;
+		}
+
+		switch (addressing_mode) {
+			case addressingmode::absolute: return get_operand_handler<addressingmode::absolute>(opcode);
+			case addressingmode::x_index: return get_operand_handler<addressingmode::x_index>(opcode);
+			case addressingmode::y_index: return get_operand_handler<addressingmode::y_index>(opcode);
+			case addressingmode::immediate: return get_operand_handler<addressingmode::immediate>(opcode);
+			case addressingmode::indirect_indexed_x: return get_operand_handler<addressingmode::indirect_indexed_x>(opcode);
+			case addressingmode::indirect_indexed_y: return get_operand_handler<addressingmode::indirect_indexed_y>(opcode);
+			case addressingmode::indexed_indirect_x: return get_operand_handler<addressingmode::indexed_indirect_x>(opcode);
+			case addressingmode::indexed_indirect_y: return get_operand_handler<addressingmode::indexed_indirect_y>(opcode);
+			case addressingmode::reg_b: return get_operand_handler<addressingmode::reg_b>(opcode);
+			case addressingmode::absolute_short: return get_operand_handler<addressingmode::absolute_short>(opcode);
+			case addressingmode::x_index_short: return get_operand_handler<addressingmode::x_index_short>(opcode);
+			case addressingmode::y_index_short: return get_operand_handler<addressingmode::y_index_short>(opcode);
+			case addressingmode::immediate_short: return get_operand_handler<addressingmode::immediate_short>(opcode);
+			case addressingmode::indirect_indexed_x_short: return get_operand_handler<addressingmode::indirect_indexed_x_short>(opcode);
+			case addressingmode::indirect_indexed_y_short: return get_operand_handler<addressingmode::indirect_indexed_y_short>(opcode);
+			case addressingmode::indexed_indirect_x_short: return get_operand_handler<addressingmode::indexed_indirect_x_short>(opcode);
+			case addressingmode::indexed_indirect_y_short: return get_operand_handler<addressingmode::indexed_indirect_y_short>(opcode);
+
+			// no instruction may use any other mode (e.g., plain indirect, which the assembler never generates)
+			default: return &InstructionHandlers::illegal_mode;
+		}
+	}
+
+	switch (opcode) {
+		case NOOP: return &InstructionHandlers::noop;
+
+		case TAB: return &InstructionHandlers::tab;
+		case TAX: return &InstructionHandlers::tax;
+		case TAY: return &InstructionHandlers::tay;
+		case TASP: return &InstructionHandlers::tasp;
+		case TASTATUS: return &InstructionHandlers::tastatus;
+		case INCA: return &InstructionHandlers::inca;
+		case DECA: return &InstructionHandlers::deca;
+
+		case TBA: return &InstructionHandlers::tba;
+		case TBX: return &InstructionHandlers::tbx;
+		case TBY: return &InstructionHandlers::tby;
+		case TBSP: return &InstructionHandlers::tbsp;
+		case TBSTATUS: return &InstructionHandlers::tbstatus;
+		case INCB: return &InstructionHandlers::incb;
+		case DECB: return &InstructionHandlers::decb;
+
+		case TXA: return &InstructionHandlers::txa;
+		case TXB: return &InstructionHandlers::txb;
+		case TXY: return &InstructionHandlers::txy;
+		case TXSP: return &InstructionHandlers::txsp;
+		case INCX: return &InstructionHandlers::incx;
+		case DECX: return &InstructionHandlers::decx;
+
+		case TYA: return &InstructionHandlers::tya;
+		case TYB: return &InstructionHandlers::tyb;
+		case TYX: return &InstructionHandlers::tyx;
+		case TYSP: return &InstructionHandlers::tysp;
+		case INCY: return &InstructionHandlers::incy;
+		case DECY: return &InstructionHandlers::decy;
+
+		case LSR: case LSL: case ROR: case ROL: return &InstructionHandlers::bitshift;
+
+		case PHA: return &InstructionHandlers::pha;
+		case PHB: return &InstructionHandlers::phb;
+		case PLA: return &InstructionHandlers::pla;
+		case PLB: return &InstructionHandlers::plb;
+		case PRSA: return &InstructionHandlers::prsa;
+		case PRSB: return &InstructionHandlers::prsb;
+		case RSTA: return &InstructionHandlers::rsta;
+		case RSTB: return &InstructionHandlers::rstb;
+		case PRSR: return &InstructionHandlers::prsr;
+		case RSTR: return &InstructionHandlers::rstr;
+		case TSPA: return &InstructionHandlers::tspa;
+		case TSPB: return &InstructionHandlers::tspb;
+		case TSPX: return &InstructionHandlers::tspx;
+		case TSPY: return &InstructionHandlers::tspy;
+		case INCSP: return &InstructionHandlers::incsp;
+		case DECSP: return &InstructionHandlers::decsp;
+
+		case CLC: return &InstructionHandlers::clc;
+		case SEC: return &InstructionHandlers::sec;
+		case CLN: return &InstructionHandlers::cln;
+		case SEN: return &InstructionHandlers::sen;
+		case CLF: return &InstructionHandlers::clf;
+		case SEF: return &InstructionHandlers::sef;
+		case TSTATUSA: return &InstructionHandlers::tstatusa;
+		case TSTATUSB: return &InstructionHandlers::tstatusb;
+
+		case JMP: return &InstructionHandlers::jmp;
+		case BRNE: case BRZ: return &InstructionHandlers::brne;
+		case BREQ: return &InstructionHandlers::breq;
+		case BRGT: return &InstructionHandlers::brgt;
+		case BRLT: return &InstructionHandlers::brlt;
+		case BRN: return &InstructionHandlers::brn;
+		case BRPL: return &InstructionHandlers::brpl;
+		case JSR: return &InstructionHandlers::jsr;
+		case RTS: return &InstructionHandlers::rts;
+
+		case VADD: case VSUB: case VAND: case VOR: case VXOR: case VCMP: return &InstructionHandlers::vector_operation;
+		case VSUM: return &InstructionHandlers::vsum;
+
+		case MOVM: return &InstructionHandlers::movm;
+		case FILLM: return &InstructionHandlers::fillm;
+
+		case BRK: return &InstructionHandlers::brk;
+		case SYSCALL: return &InstructionHandlers::syscall;
+		case RESET: return &InstructionHandlers::reset;
+		case HALT: return &InstructionHandlers::halt;
+
+		case ADDCB: case SUBCB: case SFADDA: case SFSUBA: case SFMULTA: case SFDIVA: case IRQ: case RTI:
+			return &InstructionHandlers::not_implemented;
+
+		default: return &InstructionHandlers::illegal;
+	}
 }
@@ -0,0 +1,131 @@
+/*
+
+SIN Toolchain
+ExecutionTrace.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the ExecutionTrace class.
+
+*/
+
+#include "ExecutionTrace.h"
+
+#include <string>
+#include <cstring>
+
+#include "DecodedInstruction.h"	// for disassemble(...)
+#include "../util/BinaryIO/BinaryIO.h"
+#include "../util/Exceptions.h"
+
+
+namespace {
+	// registers and addresses are written as a whole word
+	void write_word(std::ostream& trace_file, wordaccess::vm_word value) {
+#if SIN_WORDSIZE == 32
+		BinaryIO::writeU32(trace_file, value);
+#else
+		BinaryIO::writeU16(trace_file, value);
+#endif
+	}
+
+	wordaccess::vm_word read_word(std::istream& trace_file) {
+#if SIN_WORDSIZE == 32
+		return BinaryIO::readU32(trace_file);
+#else
+		return BinaryIO::readU16(trace_file);
+#endif
+	}
+}
+
+
+void ExecutionTrace::write(std::ostream& trace_file) {
+	size_t num_records = (this->count < this->records.size()) ? (size_t)this->count : this->records.size();
+
+	for (size_t i = 0; i < strlen(exectrace::file_magic); i++) {
+		BinaryIO::writeU8(trace_file, exectrace::file_magic[i]);
+	}
+	BinaryIO::writeU8(trace_file, SIN_WORDSIZE);
+	BinaryIO::writeU32(trace_file, (uint32_t)num_records);
+	BinaryIO::writeU32(trace_file, (uint32_t)this->count);
+
+	// the oldest record is the one that will be overwritten next
+	for (uint64_t i = this->count - num_records; i < this->count; i++) {
+		const TraceRecord& record = this->records[i & this->mask];
+
+		write_word(trace_file, record.PC);
+		write_word(trace_file, record.operand);
+		write_word(trace_file, record.REG_A);
+		write_word(trace_file, record.REG_B);
+		write_word(trace_file, record.REG_X);
+		write_word(trace_file, record.REG_Y);
+		write_word(trace_file, record.SP);
+		BinaryIO::writeU16(trace_file, record.flags.apply(record.STATUS));
+		BinaryIO::writeU8(trace_file, record.opcode);
+		BinaryIO::writeU8(trace_file, record.addressing_mode);
+		BinaryIO::writeU8(trace_file, record.length);
+	}
+}
+
+void ExecutionTrace::decode(std::istream& trace_file, std::ostream& output) {
+	for (size_t i = 0; i < strlen(exectrace::file_magic); i++) {
+		if (BinaryIO::readU8(trace_file) != (uint8_t)exectrace::file_magic[i]) {
+			throw VMException("Not a SIN trace file");
+		}
+	}
+
+	uint8_t wordsize = BinaryIO::readU8(trace_file);
+	if (wordsize != SIN_WORDSIZE) {
+		throw VMException("The trace was written by a " + std::to_string(wordsize) + "-bit VM; this toolchain uses a " + std::to_string(SIN_WORDSIZE) + "-bit word");
+	}
+
+	uint32_t num_records = BinaryIO::readU32(trace_file);
+	uint32_t count = BinaryIO::readU32(trace_file);
+
+	output << "Trace: last " << std::dec << num_records << " of " << count << " instructions, oldest first; registers are shown as they were before each instruction" << std::endl;
+	output << "\tPC\tA\tB\tX\tY\tSP\tSTATUS\tinstruction" << std::endl;
+
+	for (uint32_t i = 0; i < num_records; i++) {
+		TraceRecord record;
+		record.PC = read_word(trace_file);
+		record.operand = read_word(trace_file);
+		record.REG_A = read_word(trace_file);
+		record.REG_B = read_word(trace_file);
+		record.REG_X = read_word(trace_file);
+		record.REG_Y = read_word(trace_file);
+		record.SP = read_word(trace_file);
+		record.STATUS = BinaryIO::readU16(trace_file);
+		record.opcode = BinaryIO::readU8(trace_file);
+		record.addressing_mode = BinaryIO::readU8(trace_file);
+		record.length = BinaryIO::readU8(trace_file);
+
+		if (!trace_file.good()) {
+			throw VMException("Trace file is truncated");
+		}
+
+		DecodedInstruction instruction;
+		instruction.opcode = record.opcode;
+		instruction.addressing_mode = record.addressing_mode;
+		instruction.operand = record.operand;
+		instruction.length = record.length;
+
+		output << std::hex << "\t$" << record.PC << "\t$" << record.REG_A << "\t$" << record.REG_B << "\t$" << record.REG_X << "\t$" << record.REG_Y << "\t$" << record.SP << "\t$" << record.STATUS << "\t" << disassemble(instruction) << std::endl;
+	}
+
+	output << std::dec;
+}
+
+
+ExecutionTrace::ExecutionTrace(size_t num_records) {
+	size_t size = 1;
+	while (size < num_records) {
+		size <<= 1;
+	}
+
+	this->records = std::vector<TraceRecord>(size);
+	this->mask = size - 1;
+	this->count = 0;
+}
+
+ExecutionTrace::~ExecutionTrace()
+{
+}
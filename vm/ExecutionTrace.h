@@ -0,0 +1,76 @@
+/*
+
+SIN Toolchain
+ExecutionTrace.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the ExecutionTrace class, a ring buffer holding the last few thousand instructions the VM executed, along with the registers as they were just before each one.
+
+When tracing is enabled (see SINVM::enable_tracing(...)), the VM writes a record for every instruction. The buffer is allocated once, up front, and a record is only a handful of stores, so tracing is cheap enough to leave on for programs that only misbehave occasionally. In particular, the lazy flags (see LazyFlags.h) are copied as they are, and only worked out for the records that are written to the file. If the program fails -- because of a VMException or a signal it didn't handle -- the VM writes the buffer to a file, which may be turned back into text with ExecutionTrace::decode(...) (or the --decode-trace flag).
+
+A trace file holds:
+	- the characters "SINTRACE"
+	- the word size of the VM that wrote the trace (u8)
+	- the number of records in the file (u32)
+	- the number of instructions executed while tracing, which may be greater (u32; the low 32 bits)
+	- the records, oldest first; each is the PC, operand, A, B, X, Y, and SP (one word each), the STATUS (u16), then the opcode, addressing mode, and length (u8 each)
+All values are little-endian. A trace may only be decoded by a toolchain built for the same word size.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cinttypes>
+
+#include "WordAccess.h"
+#include "LazyFlags.h"
+
+
+namespace exectrace {
+	const size_t default_records = 4096;	// the number of records kept unless a size is given; must be a power of 2
+	const char file_magic[] = "SINTRACE";
+}
+
+
+struct TraceRecord
+{
+	typedef wordaccess::vm_word word_t;
+
+	word_t PC;
+	word_t operand;
+
+	// the registers before the instruction executed
+	word_t REG_A;
+	word_t REG_B;
+	word_t REG_X;
+	word_t REG_Y;
+	word_t SP;
+	uint16_t STATUS;	// the N, V, Z, and C flags may be out of date until 'flags' is applied; the file always holds the real flags
+	PendingFlags flags;
+
+	uint8_t opcode;
+	uint8_t addressing_mode;
+	uint8_t length;
+};
+
+
+class ExecutionTrace
+{
+	std::vector<TraceRecord> records;
+	size_t mask;	// records.size() - 1; the size is always a power of 2, so this wraps an index into the buffer
+	uint64_t count;	// the number of records ever written
+public:
+	// get the record to fill for the next instruction, overwriting the oldest if the buffer is full
+	TraceRecord& next() {
+		return this->records[(this->count++) & this->mask];
+	}
+
+	void write(std::ostream& trace_file);	// write the buffer, oldest record first
+	static void decode(std::istream& trace_file, std::ostream& output);	// print a trace file written by write(...) as text
+
+	ExecutionTrace(size_t num_records = exectrace::default_records);	// 'num_records' is rounded up to a power of 2
+	~ExecutionTrace();
+};
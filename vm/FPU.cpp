@@ -17,11 +17,16 @@ uint32_t FPU::combine_registers()
 	/*
 	
 	Constructs a 32-bit value from two 16-bit values, REG_A and REG_B, where A contains the most significant bits and B contains the least
+	In the 32-bit VM, the value is simply REG_A
 	
 	*/
 
+#if SIN_WORDSIZE == 32
+	return *this->REG_A;
+#else
 	uint32_t left = (*this->REG_A << 16) | *this->REG_B;
 	return left;
+#endif
 }
 
 void FPU::split_to_registers(uint32_t to_split)
@@ -29,11 +34,16 @@ void FPU::split_to_registers(uint32_t to_split)
 	/*
 
 	Splits a 32-bit value into two 16-bit halves, one in REG_A and the other in REG_B -- opposite of FPU::get_left()
+	In the 32-bit VM, the whole value goes in REG_A
 
 	*/
 
+#if SIN_WORDSIZE == 32
+	*this->REG_A = to_split;
+#else
 	*this->REG_A = (to_split >> 16) & 0xFFFF;
 	*this->REG_B = to_split & 0xFFFF;
+#endif
 
 	return;
 }
@@ -50,10 +60,15 @@ However, the 16-bit functions may affect the STATUS register if the result was u
 
 todo: since these functions are all almost the same, can we combine their implementations in such a way that they don't need to take up so much space?
 
+In the 32-bit VM, a word holds a whole single, so these functions just call the 32-bit ones
+
 */
 
-void FPU::fadda(uint16_t right) {
+void FPU::fadda(word_t right) {
 	// half-precision addition
+#if SIN_WORDSIZE == 32
+	this->single_fadda(right);
+#else
 	uint32_t left_single = unpack_16(*this->REG_A);		// make this into a function returning a tuple?
 	uint32_t right_single = unpack_16(right);
 
@@ -68,12 +83,16 @@ void FPU::fadda(uint16_t right) {
 	*this->REG_A = pack_32(result);
 
 	// check for overflow
+#endif
 
 	return;
 }
 
-void FPU::fsuba(uint16_t right) {
+void FPU::fsuba(word_t right) {
 	// half-precision subtraction
+#if SIN_WORDSIZE == 32
+	this->single_fsuba(right);
+#else
 	uint32_t left_single = unpack_16(*this->REG_A);
 	uint32_t right_single = unpack_16(right);
 
@@ -85,12 +104,16 @@ void FPU::fsuba(uint16_t right) {
 	// re-pack the result
 	uint32_t result = this->combine_registers();
 	*this->REG_A = pack_32(result);
+#endif
 
 	return;
 }
 
-void FPU::fmulta(uint16_t right) {
+void FPU::fmulta(word_t right) {
 	// half-precision multiplication
+#if SIN_WORDSIZE == 32
+	this->single_fmulta(right);
+#else
 	uint32_t left_single = unpack_16(*this->REG_A);
 	uint32_t right_single = unpack_16(right);
 
@@ -100,12 +123,16 @@ void FPU::fmulta(uint16_t right) {
 
 	uint32_t result = this->combine_registers();
 	*this->REG_A = pack_32(result);
+#endif
 
 	return;
 }
 
-void FPU::fdiva(uint16_t right) {
+void FPU::fdiva(word_t right) {
 	// half-precision division
+#if SIN_WORDSIZE == 32
+	this->single_fdiva(right);
+#else
 	uint32_t left_single = unpack_16(*this->REG_A);
 	uint32_t right_single = unpack_16(right);
 
@@ -115,6 +142,7 @@ void FPU::fdiva(uint16_t right) {
 
 	uint32_t result = this->combine_registers();
 	*this->REG_A = pack_32(result);
+#endif
 
 	return;
 }
@@ -138,6 +166,8 @@ void FPU::single_fadda(uint32_t right)
 
 	*/
 	
+	this->flags->resolve();
+
 	// get the left-hand value from REG_A and REG_B
 	uint32_t left = this->combine_registers();
 	
@@ -161,6 +191,8 @@ void FPU::single_fsuba(uint32_t right)
 {
 	// single-precision subtraction
 
+	this->flags->resolve();
+
 	uint32_t left = this->combine_registers();	// get the left-hand value
 
 	float* left_f = reinterpret_cast<float*>(&left);
@@ -181,6 +213,8 @@ void FPU::single_fmulta(uint32_t right)
 {
 	// single-precision multiplication
 
+	this->flags->resolve();
+
 	uint32_t left = this->combine_registers();	// get the left-hand value
 
 	float* left_f = reinterpret_cast<float*>(&left);
@@ -202,6 +236,8 @@ void FPU::single_fdiva(uint32_t right)
 {
 	// single-precision division
 
+	this->flags->resolve();
+
 	uint32_t left = this->combine_registers();	// get the left-hand value
 
 	float* left_f = reinterpret_cast<float*>(&left);
@@ -233,7 +269,7 @@ Constructor / Destructor
 */
 
 
-FPU::FPU(uint16_t* REG_A, uint16_t* REG_B, uint16_t* STATUS): REG_A(REG_A), REG_B(REG_B), STATUS(STATUS) {
+FPU::FPU(word_t* REG_A, word_t* REG_B, uint16_t* STATUS, LazyFlags* flags): REG_A(REG_A), REG_B(REG_B), STATUS(STATUS), flags(flags) {
 	
 }
 
@@ -242,6 +278,7 @@ FPU::FPU() {
 	this->REG_A = nullptr;
 	this->REG_B = nullptr;
 	this->STATUS = nullptr;
+	this->flags = nullptr;
 }
 
 FPU::~FPU() {
@@ -13,24 +13,30 @@ Definition of the FPU (floating-point unit) class
 #include <cinttypes>
 #include "../util/DataWidths.h"
 #include "StatusConstants.h"
+#include "LazyFlags.h"
+#include "WordAccess.h"
 #include "../util/FloatingPoint.h"
 
 class FPU {
 	// Since the FPU can operate in 16- or 32-bit mode, there are separate implementations for each function
+	// In the 32-bit VM, a single fits in the A register, so FADDA and friends operate on singles there rather than on halfs
 
-	uint16_t* REG_A;
-	uint16_t* REG_B;
+	typedef wordaccess::vm_word word_t;
+
+	word_t* REG_A;
+	word_t* REG_B;
 
 	uint16_t* STATUS;
+	LazyFlags* flags;	// the FPU sets Z without clearing it, so pending flags must be resolved first
 
 	uint32_t combine_registers();
 	void split_to_registers(uint32_t to_split);
 public:
-	// 16-bit
-	void fadda(uint16_t right);
-	void fsuba(uint16_t right);
-	void fmulta(uint16_t right);
-	void fdiva(uint16_t right);
+	// one word; halfs in the 16-bit VM, singles in the 32-bit one
+	void fadda(word_t right);
+	void fsuba(word_t right);
+	void fmulta(word_t right);
+	void fdiva(word_t right);
 
 	// 32-bit
 	void single_fadda(uint32_t right);
@@ -38,7 +44,7 @@ public:
 	void single_fmulta(uint32_t right);
 	void single_fdiva(uint32_t right);
 
-	FPU(uint16_t* REG_A, uint16_t* REG_B, uint16_t* STATUS);
+	FPU(word_t* REG_A, word_t* REG_B, uint16_t* STATUS, LazyFlags* flags);
 	FPU();
 	~FPU();
 };
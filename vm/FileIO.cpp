@@ -0,0 +1,477 @@
+/*
+
+SIN Toolchain
+FileIO.cpp
+Copyright 2019 Riley Lannon
+
+This file contains the implementations of the SINVM functions behind the file I/O syscalls:
+	1) void open_file(bool writable)	-	open the file named by the string at B (A bytes long), loading A with its descriptor
+	2) void close_file()	-	close the file with the descriptor in B
+	3) void read_file()	-	read A bytes from the file with the descriptor in Y to the address in B
+	4) void write_file()	-	write A bytes at the address in B to the file with the descriptor in Y
+	5) void seek_file()	-	move the position of the file with the descriptor in Y by the offset in B:A, from the origin in X
+	6) void map_file()	-	show the file with the descriptor in Y in the file window, starting at the offset in B:A
+
+Files may only be opened once the host has given the VM a directory with set_file_root(); until then, opening a file generates a SINSIGSYS signal. The names the program gives are relative to that directory, and may not leave it.
+An unknown descriptor, or one that can't be used in the way asked, generates a SINSIGSYS signal; a buffer the program may not access generates a SINSIGSEGV. See FileIO.h and Doc/syscall.txt.
+
+*/
+
+#include "SINVM.h"
+
+// the file window shows a view the host maps of the file where it can; elsewhere, a copy of the file
+#if defined(_WIN32)
+#define FILEIO_WINDOWS_VIEW
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define FILEIO_POSIX_VIEW
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+	// map the whole of the file at file->path read-only, filling in its view; false if the host can't, including for an empty file
+	bool map_view(VMFile* file) {
+#if defined(FILEIO_WINDOWS_VIEW)
+		HANDLE handle = CreateFileA(file->path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER length;
+		HANDLE mapping = NULL;
+		if (GetFileSizeEx(handle, &length) && (length.QuadPart > 0) && ((uint64_t)length.QuadPart <= SIZE_MAX)) {
+			mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		}
+		CloseHandle(handle);	// the mapping object keeps the file open
+		if (mapping == NULL) {
+			return false;
+		}
+
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == NULL) {
+			CloseHandle(mapping);
+			return false;
+		}
+
+		file->data = (const uint8_t*)view;
+		file->size = (size_t)length.QuadPart;
+		file->view_size = file->size;
+		file->view_handle = mapping;
+		return true;
+#elif defined(FILEIO_POSIX_VIEW)
+		int descriptor = ::open(file->path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+
+		struct stat status;
+		void* view = MAP_FAILED;
+		if ((fstat(descriptor, &status) == 0) && (status.st_size > 0) && ((uint64_t)status.st_size <= SIZE_MAX)) {
+			view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		}
+		::close(descriptor);	// the view keeps the file open
+		if (view == MAP_FAILED) {
+			return false;
+		}
+
+		file->data = (const uint8_t*)view;
+		file->size = (size_t)status.st_size;
+		file->view_size = file->size;
+		return true;
+#else
+		return false;
+#endif
+	}
+}
+
+
+VMFile::VMFile() {
+	this->writable = false;
+	this->data = nullptr;
+	this->size = 0;
+	this->loaded = false;
+	this->view_size = 0;
+	this->view_handle = nullptr;
+}
+
+VMFile::~VMFile() {
+	if (this->view_size == 0) {
+		return;
+	}
+
+#if defined(FILEIO_WINDOWS_VIEW)
+	UnmapViewOfFile(this->data);
+	CloseHandle((HANDLE)this->view_handle);
+#elif defined(FILEIO_POSIX_VIEW)
+	munmap((void*)this->data, this->view_size);
+#endif
+}
+
+
+VMFile* SINVM::get_file(word_t descriptor) {
+	if ((descriptor == 0) || (descriptor > fileio::max_files)) {
+		return nullptr;
+	}
+	return this->files[descriptor - 1];
+}
+
+bool SINVM::get_file_path(std::string name, std::string& path) {
+	/*
+
+	Turns the name of a file given by the program into a host path inside file_root.
+	The name is checked as written: it may not be empty, be absolute, contain a drive or NUL, or use '..' to climb out of the root at any point, or name the root itself. '/' and '\\' both separate directories.
+	The check doesn't follow links; anything inside the root, including links, is the host's to choose.
+
+	*/
+
+	if (name.empty() || (name[0] == '/') || (name[0] == '\\') || (name.find(':') != std::string::npos) || (name.find('\0') != std::string::npos)) {
+		return false;
+	}
+
+	// track how deep in the root each directory leaves us
+	int depth = 0;
+	size_t start = 0;
+	while (start <= name.size()) {
+		size_t end = name.find_first_of("/\\", start);
+		if (end == std::string::npos) {
+			end = name.size();
+		}
+
+		std::string component = name.substr(start, end - start);
+		if (component == "..") {
+			depth--;
+			if (depth < 0) {
+				return false;
+			}
+		}
+		else if (!component.empty() && (component != ".")) {
+			depth++;
+		}
+
+		start = end + 1;
+	}
+
+	// a name like "." or "a/.." is the root itself, which isn't a file
+	if (depth == 0) {
+		return false;
+	}
+
+	path = this->file_root + "/" + name;
+	return true;
+}
+
+void SINVM::unmap_file_window() {
+	if (this->mapped_descriptor == 0) {
+		return;
+	}
+
+	for (size_t page = _FILE_WINDOW_START >> pagepermission::page_shift; page <= (_FILE_WINDOW_END >> pagepermission::page_shift); page++) {
+		// the VM itself may have written to the window, copying the file's page
+		this->release_page(page);
+
+		this->set_read_page(page, this->program->get_page(page));
+		this->set_page_permissions(page, pagepermission::read | pagepermission::write);
+	}
+
+	this->mapped_descriptor = 0;
+}
+
+void SINVM::close_files() {
+	this->unmap_file_window();
+
+	for (size_t i = 0; i < fileio::max_files; i++) {
+		delete this->files[i];
+		this->files[i] = nullptr;
+	}
+}
+
+
+void SINVM::open_file(bool writable)
+{
+	/*
+
+	Opens the file whose name is the A bytes starting at the address in B; files opened for writing are created, or truncated if they already exist.
+	A is loaded with the file's descriptor, or with 0x00 if the file can't be opened or the program already has fileio::max_files files open.
+	The name is relative to the file root; if the host hasn't given one, or the name is outside of it, a SINSIGSYS signal is generated.
+
+	*/
+
+	if (this->file_root.empty()) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+	else if (!this->range_is_valid(REG_B, pagepermission::read, REG_A)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	std::string name;
+	for (size_t i = 0; i < REG_A; i++) {
+		name.push_back(this->read_byte(REG_B + i));
+	}
+
+	std::string path;
+	if (!this->get_file_path(name, path)) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	// find the first unused descriptor
+	size_t index = 0;
+	while ((index < fileio::max_files) && (this->files[index] != nullptr)) {
+		index++;
+	}
+	if (index == fileio::max_files) {
+		REG_A = 0x00;
+		return;
+	}
+
+	VMFile* file = new VMFile();
+	file->writable = writable;
+	file->path = path;
+	file->stream.open(path, (writable ? (std::ios::out | std::ios::trunc) : std::ios::in) | std::ios::binary);
+
+	if (!file->stream.is_open()) {
+		delete file;
+		REG_A = 0x00;
+		return;
+	}
+
+	this->files[index] = file;
+	REG_A = (word_t)(index + 1);
+}
+
+void SINVM::close_file()
+{
+	VMFile* file = this->get_file(REG_B);
+	if (file == nullptr) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	if (this->mapped_descriptor == REG_B) {
+		this->unmap_file_window();
+	}
+
+	delete file;
+	this->files[REG_B - 1] = nullptr;
+}
+
+void SINVM::read_file()
+{
+	/*
+
+	Reads up to A bytes from the file with the descriptor in Y to memory, starting at the address in B; A is loaded with the number of bytes read, which is less than was asked for only at the end of the file.
+	The data is read straight into the VM's pages, one page at a time.
+
+	*/
+
+	VMFile* file = this->get_file(REG_Y);
+	if ((file == nullptr) || file->writable) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+	else if (!this->range_is_valid(REG_B, pagepermission::write, REG_A)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	size_t num_bytes = REG_A;
+	size_t address = REG_B;
+	size_t bytes_read = 0;
+
+	while (bytes_read < num_bytes) {
+		size_t page = address >> pagepermission::page_shift;
+		size_t offset = address & (pagepermission::page_size - 1);
+		size_t length = pagepermission::page_size - offset;
+		if (length > num_bytes - bytes_read) {
+			length = num_bytes - bytes_read;
+		}
+
+		uint8_t* page_data = this->get_write_page(page);
+		if (page_data == nullptr) {
+			page_data = this->copy_page(page);
+		}
+
+		file->stream.read((char*)&page_data[offset], length);
+		size_t count = (size_t)file->stream.gcount();
+		bytes_read += count;
+		address += count;
+
+		if (count < length) {
+			break;
+		}
+	}
+
+	// reaching the end of the file isn't an error; the program may still seek back
+	file->stream.clear();
+
+	this->invalidate_decode_cache(REG_B, bytes_read);
+	REG_A = (word_t)bytes_read;
+}
+
+void SINVM::write_file()
+{
+	/*
+
+	Writes the A bytes starting at the address in B to the file with the descriptor in Y; A is loaded with the number of bytes written, or with 0x00 if the write failed.
+
+	*/
+
+	VMFile* file = this->get_file(REG_Y);
+	if ((file == nullptr) || !file->writable) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+	else if (!this->range_is_valid(REG_B, pagepermission::read, REG_A)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	// write the data straight from the VM's pages, one page at a time
+	size_t num_bytes = REG_A;
+	size_t address = REG_B;
+	size_t bytes_written = 0;
+
+	while (bytes_written < num_bytes) {
+		size_t offset = address & (pagepermission::page_size - 1);
+		size_t length = pagepermission::page_size - offset;
+		if (length > num_bytes - bytes_written) {
+			length = num_bytes - bytes_written;
+		}
+
+		file->stream.write((const char*)&this->get_read_page(address >> pagepermission::page_shift)[offset], length);
+		bytes_written += length;
+		address += length;
+	}
+
+	if (file->stream.good()) {
+		REG_A = (word_t)bytes_written;
+	}
+	else {
+		file->stream.clear();
+		REG_A = 0x00;
+	}
+}
+
+void SINVM::seek_file()
+{
+	/*
+
+	Moves the position of the file with the descriptor in Y. The offset is a signed two-word number with its high word in B and its low word in A, and is counted from the origin in X (see fileio::seek_start, seek_current, and seek_end).
+	B and A are loaded with the new position in the same way, or with all 1s if the position would be before the start of the file.
+
+	*/
+
+	VMFile* file = this->get_file(REG_Y);
+	if (file == nullptr) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	std::ios::seekdir origin;
+	if (REG_X == fileio::seek_start) {
+		origin = std::ios::beg;
+	}
+	else if (REG_X == fileio::seek_current) {
+		origin = std::ios::cur;
+	}
+	else if (REG_X == fileio::seek_end) {
+		origin = std::ios::end;
+	}
+	else {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	// sign-extend the two words to 64 bits
+	const size_t unused_bits = 64 - 2 * this->_WORDSIZE;
+	int64_t offset = (int64_t)((((uint64_t)REG_B << this->_WORDSIZE) | REG_A) << unused_bits) >> unused_bits;
+
+	// a file is only ever read or written, so only one of its positions is used
+	std::streamoff position;
+	if (file->writable) {
+		file->stream.seekp(offset, origin);
+		position = file->stream.tellp();
+	}
+	else {
+		file->stream.seekg(offset, origin);
+		position = file->stream.tellg();
+	}
+
+	if (file->stream.fail() || (position < 0)) {
+		file->stream.clear();
+		REG_B = wordaccess::word_max;
+		REG_A = wordaccess::word_max;
+	}
+	else {
+		REG_B = (word_t)((uint64_t)position >> this->_WORDSIZE);
+		REG_A = (word_t)position;
+	}
+}
+
+void SINVM::map_file()
+{
+	/*
+
+	Shows the file with the descriptor in Y in the file window, starting at the offset in B:A (high word in B), which must be a multiple of the page size.
+	B is loaded with the start of the window, and A with the number of bytes of the file in the window; the rest of the window reads as zeroes. Mapping a file replaces whatever was in the window before.
+
+	*/
+
+	VMFile* file = this->get_file(REG_Y);
+	uint64_t offset = ((uint64_t)REG_B << this->_WORDSIZE) | REG_A;
+	if ((file == nullptr) || file->writable || (offset & (pagepermission::page_size - 1))) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	// map the file the first time it is mapped; if the host can't, load it instead, without disturbing its position for STD_FILEREAD
+	if (!file->loaded && !map_view(file)) {
+		std::streamoff position = file->stream.tellg();
+
+		file->stream.seekg(0, std::ios::end);
+		file->size = (size_t)file->stream.tellg();
+		file->contents.resize((file->size + pagepermission::page_size - 1) & ~(pagepermission::page_size - 1), 0);
+
+		file->stream.seekg(0, std::ios::beg);
+		file->stream.read((char*)file->contents.data(), file->size);
+
+		file->stream.clear();
+		file->stream.seekg(position, std::ios::beg);
+		file->data = file->contents.data();
+	}
+	file->loaded = true;
+
+	this->unmap_file_window();
+
+	size_t window_start = _FILE_WINDOW_START >> pagepermission::page_shift;
+	size_t window_end = _FILE_WINDOW_END >> pagepermission::page_shift;
+	for (size_t page = window_start; page <= window_end; page++) {
+		// anything the program wrote to the window is lost
+		this->release_page(page);
+
+		size_t file_offset = (size_t)offset + ((page - window_start) << pagepermission::page_shift);
+		if (file_offset < file->size) {
+			this->set_read_page(page, &file->data[file_offset]);
+		}
+		else {
+			this->set_read_page(page, this->program->get_page(page));
+		}
+
+		this->set_page_permissions(page, pagepermission::read);
+	}
+
+	this->mapped_descriptor = REG_Y;
+
+	size_t window_size = _FILE_WINDOW_END - _FILE_WINDOW_START + 1;
+	size_t bytes_mapped = (offset < file->size) ? (file->size - offset) : 0;
+	REG_B = _FILE_WINDOW_START;
+	REG_A = (word_t)((bytes_mapped < window_size) ? bytes_mapped : window_size);
+}
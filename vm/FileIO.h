@@ -0,0 +1,56 @@
+/*
+
+SIN Toolchain
+FileIO.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the VMFile struct, which holds a host file opened by the program with the STD_FILEOPEN_R or STD_FILEOPEN_w syscalls.
+
+The program has no access to the host's files unless the host gives the VM a directory with SINVM::set_file_root() (the --file-root flag); the program's file names are relative to it, and a name that is absolute or leaves it generates a SINSIGSYS signal, as does opening any file without a root.
+The program refers to an open file by its descriptor, a number from 1 to fileio::max_files; 0 is never a valid descriptor, so it is returned when a file can't be opened. The files are closed when the VM is reset or destroyed.
+Files may be used in two ways:
+	- buffered: STD_FILEREAD, STD_FILEWRITE, and STD_FILESEEK read and write the file through a host stream, copying the data to or from the VM's memory
+	- mapped: STD_FILEMAP makes part of a file opened for reading visible in the file window (_FILE_WINDOW_START to _FILE_WINDOW_END). The window's pages point straight at the file's contents, so the program can scan the file with ordinary loads, sliding the window along it, without any data being copied into its memory. The pages are read-only; a store to the window is a segmentation violation
+The first time a file is mapped, the host maps the whole file into the VM's address space, read-only (mmap on POSIX systems, MapViewOfFile on Windows); the window's pages point into that view, so the file is only read from disk as the program touches it. The part of the last page past the end of the file reads as zeroes.
+If the host can't map the file, or has no way to, its whole contents are copied into memory instead, and that copy is what the window shows.
+Either way, the file should not be changed by other programs while it is mapped: a mapped view may or may not show their writes, and if the file is made shorter, reading past its new end stops the host.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cinttypes>
+
+
+namespace fileio {
+	const size_t max_files = 16;
+
+	// the origins for STD_FILESEEK, given in the X register
+	const uint16_t seek_start = 0;
+	const uint16_t seek_current = 1;
+	const uint16_t seek_end = 2;
+}
+
+
+struct VMFile
+{
+	std::fstream stream;
+	bool writable;	// opened with STD_FILEOPEN_w; such files may not be mapped
+
+	std::string path;	// the host path the file was opened with, so it can be mapped
+
+	// the file's contents as the window sees them, once the file is mapped; readable up to 'size', rounded up to a whole number of pages
+	const uint8_t* data;
+	size_t size;	// the size of the file when it was mapped
+	bool loaded;
+
+	size_t view_size;	// the size of the host's view of the file, or 0 if there isn't one
+	void* view_handle;	// on Windows, the file mapping object behind the view
+	std::vector<uint8_t> contents;	// if the host couldn't map the file, a copy of it, padded to a whole number of pages
+
+	VMFile();
+	~VMFile();
+};
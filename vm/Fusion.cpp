@@ -0,0 +1,251 @@
+/*
+
+SIN Toolchain
+Fusion.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the VM's superinstruction fusion pass and the handlers for the fused instructions.
+
+Fused instructions behave exactly like the sequences they replace; in particular, if an instruction in the sequence generates a signal, the PC will point to that instruction, just as it would have without fusion.
+
+*/
+
+#include "SINVM.h"
+#include "SpecializedAccess.h"
+
+
+FusionStatistics::FusionStatistics() {
+	this->decsp_runs = 0;
+	this->incsp_runs = 0;
+	this->sp_adjustments = 0;
+	this->transfer_pushes = 0;
+	this->instructions = 0;
+	this->instructions_fused = 0;
+	this->fused_instructions = 0;
+}
+
+
+struct FusedHandlers {
+	/*
+
+	The handlers for fused instructions. Like the regular handlers, these are called with the PC pointing to the last byte of the (fused) instruction.
+
+	*/
+
+	typedef SINVM::word_t word_t;
+
+	static void decsp_run(SINVM& vm, const DecodedInstruction& instruction) {
+		// the operand holds the number of DECSP instructions in the run
+		word_t distance = instruction.operand * (vm._WORDSIZE / 8);
+
+		if (vm.SP >= (_STACK_BOTTOM + distance)) {
+			vm.SP -= distance;
+		}
+		else {
+			// one of the instructions will fault; execute them one at a time so that the signal comes from the right one
+			word_t start = vm.PC - (instruction.length - 1);
+			for (word_t i = 0; i < instruction.operand; i++) {
+				vm.PC = start + i;
+				if (vm.SP >= (_STACK_BOTTOM + (vm._WORDSIZE / 8))) {
+					vm.SP -= (vm._WORDSIZE / 8);
+				}
+				else {
+					// the instructions after this one never ran, so they don't cost anything
+					vm.cycles -= (instruction.operand - 1 - i) * (instruction.cycles / instruction.operand);
+					vm.send_signal(SINSIGSTKFLT);
+					return;
+				}
+			}
+		}
+	}
+
+	static void incsp_run(SINVM& vm, const DecodedInstruction& instruction) {
+		// same as above
+		word_t distance = instruction.operand * (vm._WORDSIZE / 8);
+
+		if (vm.SP <= (_STACK - distance)) {
+			vm.SP += distance;
+		}
+		else {
+			word_t start = vm.PC - (instruction.length - 1);
+			for (word_t i = 0; i < instruction.operand; i++) {
+				vm.PC = start + i;
+				if (vm.SP <= (_STACK - (vm._WORDSIZE / 8))) {
+					vm.SP += (vm._WORDSIZE / 8);
+				}
+				else {
+					vm.cycles -= (instruction.operand - 1 - i) * (instruction.cycles / instruction.operand);
+					vm.send_signal(SINSIGSTKFLT);
+					return;
+				}
+			}
+		}
+	}
+
+	template<uint8_t mode>
+	static void sp_subtract(SINVM& vm, const DecodedInstruction& instruction) {
+		// tspa; sec; subca <operand>; tasp
+		vm.REG_A = vm.SP;
+		vm.set_status_flag('C');
+
+		vm.PC -= 1;	// the SUBCA ends one byte before the TASP
+		vm.alu.sub(vm.load_operand<mode>(instruction));
+		vm.PC += 1;
+
+		vm.SP = vm.REG_A;
+	}
+
+	template<uint8_t mode>
+	static void sp_add(SINVM& vm, const DecodedInstruction& instruction) {
+		// tspa; clc; addca <operand>; tasp
+		vm.REG_A = vm.SP;
+		vm.clear_status_flag('C');
+
+		vm.PC -= 1;
+		vm.alu.add(vm.load_operand<mode>(instruction));
+		vm.PC += 1;
+
+		vm.SP = vm.REG_A;
+	}
+
+	static void txa_pha(SINVM& vm, const DecodedInstruction&) {
+		// the PHA is the last byte, so the PC is already where it should be if the push faults
+		vm.REG_A = vm.REG_X;
+		vm.push_stack(vm.REG_A);
+	}
+};
+
+
+template<uint8_t mode>
+static InstructionHandler get_sp_adjust_handler(uint8_t arithmetic_opcode) {
+	return (arithmetic_opcode == SUBCA) ? &FusedHandlers::sp_subtract<mode> : &FusedHandlers::sp_add<mode>;
+}
+
+
+void SINVM::fuse_instruction(word_t address, DecodedInstruction& instruction) {
+	/*
+
+	Checks whether the instruction decoded at 'address' begins a sequence that can be fused, and if so, turns 'instruction' into the fused instruction.
+	Only sequences that lie entirely within the decode cache are fused, as writes outside of it are not tracked.
+
+	*/
+
+	size_t cache_end = _PRG_BOTTOM + this->decode_cache_size;
+
+	if ((address < _PRG_BOTTOM) || (address >= cache_end)) {
+		return;
+	}
+
+	if ((instruction.opcode == DECSP) || (instruction.opcode == INCSP)) {
+		// count the number of identical instructions that follow
+		size_t count = 1;
+		while ((count < fusion::max_run_length) && (address + count < cache_end) && (this->read_byte(address + count) == instruction.opcode)) {
+			count++;
+		}
+
+		if (count > 1) {
+			instruction.operand = (word_t)count;
+			instruction.length = (uint8_t)count;
+			instruction.fused = (uint8_t)count;
+			instruction.cycles = instruction.cycles * (uint16_t)count;
+			instruction.handler = (instruction.opcode == DECSP) ? &FusedHandlers::decsp_run : &FusedHandlers::incsp_run;
+		}
+	}
+	else if (instruction.opcode == TSPA) {
+		// tspa; sec; subca <operand>; tasp	or	tspa; clc; addca <operand>; tasp
+		if ((size_t)address + 2 >= cache_end) {
+			return;
+		}
+
+		uint8_t flag_opcode = this->read_byte(address + 1);
+		uint8_t arithmetic_opcode = this->read_byte(address + 2);
+		if (!((flag_opcode == SEC && arithmetic_opcode == SUBCA) || (flag_opcode == CLC && arithmetic_opcode == ADDCA))) {
+			return;
+		}
+
+		DecodedInstruction arithmetic;
+		this->decode_instruction(address + 2, arithmetic);
+
+		size_t tasp_address = address + 2 + arithmetic.length;
+		if ((tasp_address >= cache_end) || (this->read_byte(tasp_address) != TASP)) {
+			return;
+		}
+
+		instruction.addressing_mode = arithmetic.addressing_mode;
+		instruction.operand = arithmetic.operand;
+		instruction.length = 3 + arithmetic.length;
+		instruction.fused = 4;
+		instruction.cycles += get_cycle_cost(flag_opcode, 0, 1) + arithmetic.cycles + get_cycle_cost(TASP, 0, 1);
+
+		// the most common operands get their own handlers; anything else reads the mode at runtime
+		if (arithmetic.addressing_mode == addressingmode::immediate) {
+			instruction.handler = get_sp_adjust_handler<addressingmode::immediate>(arithmetic_opcode);
+		}
+		else if (arithmetic.addressing_mode == addressingmode::reg_b) {
+			instruction.handler = get_sp_adjust_handler<addressingmode::reg_b>(arithmetic_opcode);
+		}
+		else if (arithmetic.addressing_mode == addressingmode::absolute) {
+			instruction.handler = get_sp_adjust_handler<addressingmode::absolute>(arithmetic_opcode);
+		}
+		else {
+			instruction.handler = get_sp_adjust_handler<operandmode::generic>(arithmetic_opcode);
+		}
+	}
+	else if (instruction.opcode == TXA) {
+		// txa; pha
+		if (((size_t)address + 1 < cache_end) && (this->read_byte(address + 1) == PHA)) {
+			instruction.length = 2;
+			instruction.fused = 2;
+			instruction.cycles += get_cycle_cost(PHA, 0, 1);
+			instruction.handler = &FusedHandlers::txa_pha;
+		}
+	}
+
+	return;
+}
+
+
+void SINVM::count_fusion(const DecodedInstruction& instruction) {
+	/*
+
+	Adds the instruction to the fusion statistics; called for every instruction found in the load-time sweep of the program
+
+	*/
+
+	this->fusion_statistics.instructions += instruction.fused;
+
+	if (instruction.fused > 1) {
+		this->fusion_statistics.instructions_fused += instruction.fused;
+		this->fusion_statistics.fused_instructions++;
+
+		if (instruction.opcode == DECSP) {
+			this->fusion_statistics.decsp_runs++;
+		}
+		else if (instruction.opcode == INCSP) {
+			this->fusion_statistics.incsp_runs++;
+		}
+		else if (instruction.opcode == TSPA) {
+			this->fusion_statistics.sp_adjustments++;
+		}
+		else if (instruction.opcode == TXA) {
+			this->fusion_statistics.transfer_pushes++;
+		}
+	}
+}
+
+
+void SINVM::_fusion_report() {
+	std::cout << "Superinstruction fusion:" << std::endl;
+
+	if (!this->uses_fusion()) {
+		std::cout << "\tFusion is not used with the switch dispatch loop or when profiling" << std::endl << std::endl;
+		return;
+	}
+
+	std::cout << std::dec;
+	std::cout << "\t" << "DECSP runs: " << this->fusion_statistics.decsp_runs << std::endl;
+	std::cout << "\t" << "INCSP runs: " << this->fusion_statistics.incsp_runs << std::endl;
+	std::cout << "\t" << "Stack pointer adjustments: " << this->fusion_statistics.sp_adjustments << std::endl;
+	std::cout << "\t" << "TXA/PHA pairs: " << this->fusion_statistics.transfer_pushes << std::endl;
+	std::cout << "\t" << this->fusion_statistics.instructions_fused << " of " << this->fusion_statistics.instructions << " instructions fused into " << this->fusion_statistics.fused_instructions << " superinstructions" << std::endl << std::endl;
+}
@@ -0,0 +1,45 @@
+/*
+
+SIN Toolchain
+Fusion.h
+Copyright 2019 Riley Lannon
+
+Contains the constants and statistics used by the VM's superinstruction fusion pass.
+
+The compiler emits a handful of instruction sequences over and over again -- runs of DECSP/INCSP to move the stack pointer, TSPA/SEC/SUBCA/TASP (or TSPA/CLC/ADDCA/TASP) to move it by a larger amount, and TXA/PHA to push a value held in X. When the VM decodes one of these sequences, it may replace it with a single decoded instruction whose handler performs the whole sequence (see Fusion.cpp), so it is dispatched once rather than once per instruction.
+Fusion is only done for the threaded and block dispatch loops; the switch loop always executes instructions one at a time.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace fusion {
+	// the longest run of DECSP or INCSP instructions that will be fused into a single instruction
+	const size_t max_run_length = 16;
+
+	// the most bytes any decoded instruction, fused or not, may cover; used when invalidating the decode cache
+	const size_t max_fused_bytes = 16;
+}
+
+struct FusionStatistics
+{
+	/*
+
+	The number of each kind of sequence fused in the program when it was loaded.
+
+	*/
+
+	size_t decsp_runs;
+	size_t incsp_runs;
+	size_t sp_adjustments;	// TSPA/SEC/SUBCA/TASP and TSPA/CLC/ADDCA/TASP
+	size_t transfer_pushes;	// TXA/PHA
+
+	size_t instructions;	// the number of instructions found in the program
+	size_t instructions_fused;	// the number of those instructions that are now part of a fused instruction
+	size_t fused_instructions;	// the number of fused instructions they were replaced with
+
+	FusionStatistics();
+};
@@ -0,0 +1,264 @@
+/*
+
+SIN Toolchain
+HeapAllocator.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the HeapAllocator class.
+
+*/
+
+#include "HeapAllocator.h"
+
+
+double HeapStatistics::get_fragmentation() {
+	if (this->free_bytes == 0) {
+		return 0.0;
+	}
+	return 1.0 - ((double)this->largest_free_block / (double)this->free_bytes);
+}
+
+
+size_t HeapAllocator::get_size_class(size_t size) {
+	// the class is the position of the highest set bit
+	size_t size_class = 0;
+	while (size > 1) {
+		size >>= 1;
+		size_class++;
+	}
+	return size_class;
+}
+
+void HeapAllocator::add_free_block(word_t address, size_t size) {
+	size_t start = address;
+	size_t end = start + size;
+
+	// merge with the free block that ends where this one starts, if there is one
+	std::map<word_t, size_t>::iterator next = this->free_blocks.lower_bound(address);
+	if (next != this->free_blocks.begin()) {
+		std::map<word_t, size_t>::iterator previous = next;
+		previous--;
+		if ((size_t)previous->first + previous->second == start) {
+			start = previous->first;
+			this->remove_free_block(previous);
+		}
+	}
+
+	// and with the one that starts where this one ends
+	if ((next != this->free_blocks.end()) && (next->first == end)) {
+		end += next->second;
+		this->remove_free_block(next);
+	}
+
+	size_t size_class = get_size_class(end - start);
+	this->free_blocks[(word_t)start] = end - start;
+	this->size_classes[size_class].insert(std::make_pair(end - start, (word_t)start));
+	this->nonempty_classes |= ((uint64_t)1 << size_class);
+}
+
+void HeapAllocator::remove_free_block(std::map<word_t, size_t>::iterator block) {
+	size_t size_class = get_size_class(block->second);
+	this->size_classes[size_class].erase(std::make_pair(block->second, block->first));
+	if (this->size_classes[size_class].empty()) {
+		this->nonempty_classes &= ~((uint64_t)1 << size_class);
+	}
+
+	this->free_blocks.erase(block);
+}
+
+void HeapAllocator::clear_free_blocks() {
+	this->free_blocks.clear();
+	for (size_t i = 0; i < heapallocator::num_size_classes; i++) {
+		this->size_classes[i].clear();
+	}
+	this->nonempty_classes = 0;
+}
+
+
+bool HeapAllocator::find_block(size_t size, std::pair<size_t, word_t>& block) {
+	// the smallest block in the object's own class that is big enough
+	size_t size_class = get_size_class(size);
+	std::set<std::pair<size_t, word_t>>::iterator found = this->size_classes[size_class].lower_bound(std::make_pair(size, (word_t)0));
+
+	if (found == this->size_classes[size_class].end()) {
+		// every block in a larger class is big enough, so take the smallest one from the first class that has any
+		uint64_t larger_classes = this->nonempty_classes & ~(((uint64_t)2 << size_class) - 1);
+		if (larger_classes == 0) {
+			return false;
+		}
+
+		size_class = 0;
+		while (!(larger_classes & ((uint64_t)1 << size_class))) {
+			size_class++;
+		}
+		found = this->size_classes[size_class].begin();
+	}
+
+	block = *found;
+	return true;
+}
+
+
+bool HeapAllocator::can_allocate(word_t size) {
+	std::pair<size_t, word_t> block;
+	return this->find_block((size == 0) ? 1 : size, block);
+}
+
+bool HeapAllocator::allocate(word_t size, word_t& address) {
+	// every object needs its own address, so even an empty one takes up a byte
+	if (size == 0) {
+		size = 1;
+	}
+
+	std::pair<size_t, word_t> block;
+	if (!this->find_block(size, block)) {
+		this->failed_allocations++;
+		return false;
+	}
+
+	// allocate from the start of the block, returning the rest
+	address = block.second;
+	this->remove_free_block(this->free_blocks.find(address));
+
+	if (block.first > size) {
+		this->add_free_block(address + size, block.first - size);
+	}
+
+	this->objects[address] = size;
+	this->allocations++;
+	return true;
+}
+
+bool HeapAllocator::free(word_t address) {
+	std::map<word_t, word_t>::iterator object = this->objects.find(address);
+	if (object == this->objects.end()) {
+		return false;
+	}
+
+	this->add_free_block(object->first, object->second);
+	this->objects.erase(object);
+	return true;
+}
+
+bool HeapAllocator::resize(word_t address, word_t new_size) {
+	std::map<word_t, word_t>::iterator object = this->objects.find(address);
+	if (object == this->objects.end()) {
+		return false;
+	}
+
+	if (new_size == 0) {
+		new_size = 1;
+	}
+
+	size_t old_size = object->second;
+	if (new_size <= old_size) {
+		// shrinking always works; the end of the object is freed
+		if (new_size < old_size) {
+			this->add_free_block(address + new_size, old_size - new_size);
+		}
+	}
+	else {
+		// the object may only grow into a free block right after it
+		std::map<word_t, size_t>::iterator next = this->free_blocks.find((word_t)(address + old_size));
+		if ((next == this->free_blocks.end()) || (old_size + next->second < new_size)) {
+			return false;
+		}
+
+		size_t remaining = old_size + next->second - new_size;
+		this->remove_free_block(next);
+		if (remaining > 0) {
+			this->add_free_block(address + new_size, remaining);
+		}
+	}
+
+	object->second = new_size;
+	return true;
+}
+
+
+bool HeapAllocator::is_allocated(word_t address) {
+	return this->objects.find(address) != this->objects.end();
+}
+
+HeapAllocator::word_t HeapAllocator::get_size(word_t address) {
+	return this->objects[address];
+}
+
+
+void HeapAllocator::compact(std::vector<std::pair<word_t, word_t>>& moves) {
+	// the objects are visited in order of address, so each one only ever moves down, and never onto an object that hasn't moved yet
+	std::map<word_t, word_t> compacted;
+	size_t next_address = this->heap_start;
+
+	for (std::map<word_t, word_t>::iterator it = this->objects.begin(); it != this->objects.end(); it++) {
+		if (it->first != next_address) {
+			moves.push_back(std::make_pair(it->first, (word_t)next_address));
+			this->bytes_moved += it->second;
+		}
+
+		compacted[(word_t)next_address] = it->second;
+		next_address += it->second;
+	}
+
+	this->objects = compacted;
+
+	// all of the free space is now at the end
+	this->clear_free_blocks();
+	if (next_address < this->heap_end) {
+		this->add_free_block((word_t)next_address, this->heap_end - next_address);
+	}
+
+	this->compactions++;
+}
+
+void HeapAllocator::clear() {
+	this->objects.clear();
+	this->clear_free_blocks();
+
+	// the whole heap is one free block
+	this->add_free_block((word_t)this->heap_start, this->heap_end - this->heap_start);
+}
+
+HeapStatistics HeapAllocator::get_statistics() {
+	HeapStatistics statistics;
+
+	statistics.num_objects = this->objects.size();
+	statistics.used_bytes = 0;
+	for (std::map<word_t, word_t>::iterator it = this->objects.begin(); it != this->objects.end(); it++) {
+		statistics.used_bytes += it->second;
+	}
+
+	statistics.free_bytes = 0;
+	statistics.largest_free_block = 0;
+	for (std::map<word_t, size_t>::iterator it = this->free_blocks.begin(); it != this->free_blocks.end(); it++) {
+		statistics.free_bytes += it->second;
+		if (it->second > statistics.largest_free_block) {
+			statistics.largest_free_block = it->second;
+		}
+	}
+	statistics.num_free_blocks = this->free_blocks.size();
+
+	statistics.allocations = this->allocations;
+	statistics.failed_allocations = this->failed_allocations;
+	statistics.compactions = this->compactions;
+	statistics.bytes_moved = this->bytes_moved;
+
+	return statistics;
+}
+
+
+HeapAllocator::HeapAllocator(size_t heap_start, size_t heap_end) :
+	heap_start(heap_start),
+	heap_end(heap_end)
+{
+	this->allocations = 0;
+	this->failed_allocations = 0;
+	this->compactions = 0;
+	this->bytes_moved = 0;
+
+	this->clear();
+}
+
+HeapAllocator::~HeapAllocator()
+{
+}
@@ -0,0 +1,98 @@
+/*
+
+SIN Toolchain
+HeapAllocator.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the HeapAllocator class, which the VM uses to track the objects allocated on the heap (_HEAP_START to _HEAP_MAX) by the MEMALLOC, MEMREALLOC, and MEMFREE syscalls.
+
+The allocator keeps two kinds of index so that no operation has to scan the heap:
+	- the allocated objects and the free blocks are each kept in a map ordered by address, so an object can be found, and a freed block can be merged with the free blocks on either side of it, in O(log n)
+	- the free blocks are also sorted into size classes -- class k holds the blocks of 2^k to 2^(k+1) - 1 bytes -- with a bitmap of the classes that aren't empty. An allocation takes the smallest block that fits from its own class or, if there isn't one, the smallest block in the next class up that has any, in O(log n)
+The allocator only tracks addresses; it never touches the VM's memory.
+
+Compaction:
+	A program may ask for handles with the MEMHANDLES syscall, after which MEMALLOC returns a handle rather than the object's address: the address of a word in the pointer table (_HANDLE_TABLE_BOTTOM to _POINTER_TABLE_TOP) that holds the object's address. The program must reach the object through the handle (e.g., loada ($04), y) and pass the handle to MEMREALLOC and MEMFREE.
+	Objects never move unless the VM is told to compact the heap (see SINVM::enable_heap_compaction()), which is only allowed for programs that use handles.
+	When an allocation would fail, the VM slides every object down to the start of the heap, leaving all of the free space in one block at the end, and updates the handles to match. An address read from a handle is only good until the next allocation.
+
+*/
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <cinttypes>
+
+#include "../util/VMMemoryMap.h"	// for _HEAP_START and _HEAP_MAX
+#include "WordAccess.h"
+
+
+namespace heapallocator {
+	const size_t num_size_classes = SIN_WORDSIZE + 1;	// enough for any size that fits in a word
+}
+
+
+struct HeapStatistics
+{
+	// the state of the heap
+	size_t num_objects;
+	size_t used_bytes;
+	size_t free_bytes;
+	size_t num_free_blocks;
+	size_t largest_free_block;
+
+	// counted since the allocator was created
+	uint64_t allocations;
+	uint64_t failed_allocations;	// allocations that failed even after compacting the heap
+	uint64_t compactions;
+	uint64_t bytes_moved;	// by compaction
+
+	double get_fragmentation();	// the fraction of the free space that is outside of the largest free block
+};
+
+
+class HeapAllocator
+{
+public:
+	typedef wordaccess::vm_word word_t;	// addresses and sizes on the heap are a word wide
+private:
+	size_t heap_start;
+	size_t heap_end;	// the first address past the end of the heap
+
+	std::map<word_t, word_t> objects;	// the allocated objects; maps start address to size
+	std::map<word_t, size_t> free_blocks;	// maps start address to size
+
+	// the free blocks in each size class, ordered by size and then by address
+	std::set<std::pair<size_t, word_t>> size_classes[heapallocator::num_size_classes];
+	uint64_t nonempty_classes;	// bit k is set if size_classes[k] is not empty
+
+	uint64_t allocations;
+	uint64_t failed_allocations;
+	uint64_t compactions;
+	uint64_t bytes_moved;
+
+	static size_t get_size_class(size_t size);
+	void add_free_block(word_t address, size_t size);	// add a block to the free indices, merging it with any free blocks next to it
+	void remove_free_block(std::map<word_t, size_t>::iterator block);
+	void clear_free_blocks();
+	bool find_block(size_t size, std::pair<size_t, word_t>& block);	// find the free block an object of 'size' bytes would be allocated from; returns false if there isn't one
+public:
+	bool can_allocate(word_t size);	// whether allocate(...) would succeed
+	bool allocate(word_t size, word_t& address);	// returns false if there is no room
+	bool free(word_t address);	// returns false if no object starts at the address
+	bool resize(word_t address, word_t new_size);	// change the size of an object without moving it; returns false if that isn't possible
+
+	bool is_allocated(word_t address);
+	word_t get_size(word_t address);	// the size of the object at 'address', which must be allocated
+
+	void compact(std::vector<std::pair<word_t, word_t>>& moves);	// move every object to the start of the heap, in order; 'moves' gets the old and new address of each object that moved, in ascending order. The caller must move the data
+
+	void clear();	// free every object
+	HeapStatistics get_statistics();
+
+	HeapAllocator(size_t heap_start = _HEAP_START, size_t heap_end = _HEAP_MAX + 1);
+	~HeapAllocator();
+};
@@ -5,143 +5,203 @@ HeapObjects.cpp
 Copyright 2019 Riley Lannon
 
 This file contains the implementations of the various SINVM functions that manage the heap, specifically:
-	1) void allocate_heap_memory()	-	allocate memory on the heap, adding it to SINVM::dynamic_objects
+	1) void allocate_heap_memory()	-	allocate memory on the heap, adding it to SINVM::heap
 	2) void reallocate_heap_memory(bool error_if_not_found)	-	reallocate memory at some address; depending on the syscall used, may generate an error if the object is not found or allocate a new one
 	3) void free_heap_memory()	-	free the memory for the object beginning at the specified location
+	4) void compact_heap()	-	move every object to the start of the heap, updating the handles, if compaction is enabled
+	5) void use_heap_handles()	-	have the syscalls return and take handles rather than addresses, at the program's request
+
+The bookkeeping is done by the HeapAllocator (see HeapAllocator.h); these functions only deal with the registers and the contents of memory.
+Once the program has asked for handles, the syscalls return and take them rather than addresses; see HeapAllocator.h.
 
 */
 
 #include "SINVM.h"
 
 
-void SINVM::allocate_heap_memory()
+bool SINVM::allocate_heap_object(word_t size, word_t& address)
+{
+	// if the heap is too fragmented for the object, compact it before giving up
+	// check_heap_mode() has made sure the program uses handles if compaction is enabled
+	if (this->compacting_heap && !this->heap.can_allocate(size)) {
+		this->compact_heap();
+	}
+
+	return this->heap.allocate(size, address);
+}
+
+void SINVM::check_heap_mode()
 {
 	/*
 
-	Attempts to allocate some memory on the heap. It tries to allocate REG_A bytes, and will load REG_B with the address where the object is located. If it cannot find any space for the object, it will load REG_A and REG_B with 0x00.
+	Stops the program if the host has enabled compaction, but the program hasn't asked for handles; compacting the heap would move objects out from under the addresses it holds.
 
 	*/
 
-	// first, check to see the next available address in the heap that is large enough for this object -- use an iterator
-	std::list<DynamicObject>::iterator obj_iter = this->dynamic_objects.begin();
-	DynamicObject previous(_HEAP_START, 0);
-	uint16_t next_available_address = 0x00;
+	if (this->compacting_heap && !this->using_heap_handles) {
+		throw VMException("Heap compaction is enabled, but the program does not use handles (MEMHANDLES); it can't be run with a compacting heap.");
+	}
+}
+
+void SINVM::use_heap_handles()
+{
+	/*
 
-	// if we have no DynamicObjects, the first location is _HEAP_START
-	if (this->dynamic_objects.size() == 0) {
-		next_available_address = _HEAP_START;
+	The program asks for handles rather than addresses from the heap syscalls (MEMHANDLES). This must be done before anything is allocated, as the objects that are already there have no handles; otherwise, a SINSIGSYS signal is generated.
+
+	*/
+
+	if (this->heap.get_statistics().num_objects != 0) {
+		this->send_signal(SINSIGSYS);
+		return;
 	}
 
-	bool found_space = false;	// if we found space for the object somewhere in the middle of the list, use this to terminate the loop; we will use list::insert to add a new heap object at the position of the iterator
+	this->using_heap_handles = true;
+}
 
-	while (obj_iter != this->dynamic_objects.end() && !found_space) {
-		// check to see if there's room between the end of the previous object (which is the start address + size) and the start of the next object
-		if (REG_A <= (obj_iter->get_start_address() - (previous.get_start_address() + previous.get_size()))) {
-			// if there is, update the start address
-			next_available_address = previous.get_start_address() + previous.get_size();
-			found_space = true;
-		}
-		else {
-			// update 'previous' and increment the object iterator
-			previous = *obj_iter;
-			obj_iter++;
-		}
+void SINVM::compact_heap()
+{
+	/*
+
+	Moves every object on the heap down to the start of the heap, copying its data and updating the handle that points to it.
+
+	*/
+
+	std::vector<std::pair<word_t, word_t>> moves;
+	this->heap.compact(moves);
+
+	if (moves.empty()) {
+		return;
 	}
-	// do one last check against the very last item and the end of the heap
-	if (REG_A <= (_HEAP_MAX - previous.get_start_address() + previous.get_size())) {
-		next_available_address = previous.get_start_address() + previous.get_size();
+
+	// find the handle for each object by its address
+	std::map<word_t, word_t> handles_by_address;
+	for (std::map<word_t, word_t>::iterator it = this->heap_handles.begin(); it != this->heap_handles.end(); it++) {
+		handles_by_address[it->second] = it->first;
 	}
 
-	// if the next available address is within our heap space, we are ok
-	if ((next_available_address >= _HEAP_START) || (next_available_address <= _HEAP_MAX)) {
-		REG_B = next_available_address;	// set the B register to the available address
-		this->dynamic_objects.insert(obj_iter, DynamicObject(REG_B, REG_A));	// instead of appending and sorting, insert the object in the list -- this will be less computationally expensive ( O(n) vs O(n log n) )
+	// the objects move down in ascending order, so copying each one from its first byte never overwrites data that hasn't been copied yet
+	for (std::vector<std::pair<word_t, word_t>>::iterator it = moves.begin(); it != moves.end(); it++) {
+		word_t old_address = it->first;
+		word_t new_address = it->second;
+		word_t size = this->heap.get_size(new_address);
+
+		for (size_t i = 0; i < size; i++) {
+			this->write_byte(new_address + i, this->read_byte(old_address + i));
+		}
+		this->invalidate_decode_cache(new_address, size);
+
+		word_t handle = handles_by_address[old_address];
+		this->heap_handles[handle] = new_address;
+		this->write_word(handle, new_address);
 	}
-	else {
-		// if the memory allocation fails, return a NULL pointer
-		REG_B = 0x00;
-		REG_A = 0x00;
+}
+
+void SINVM::allocate_heap_memory()
+{
+	/*
+
+	Attempts to allocate some memory on the heap. It tries to allocate REG_A bytes, and will load REG_B with the address where the object is located (or, if the program uses handles, with the object's handle). If it cannot find any space for the object, it will load REG_A and REG_B with 0x00.
+
+	*/
+
+	this->check_heap_mode();
+
+	word_t address;
+	if (this->using_heap_handles) {
+		if (!this->free_handles.empty() && this->allocate_heap_object(REG_A, address)) {
+			word_t handle = this->free_handles.back();
+			this->free_handles.pop_back();
+
+			this->heap_handles[handle] = address;
+			this->write_word(handle, address);
+			REG_B = handle;
+			return;
+		}
+	}
+	else if (this->allocate_heap_object(REG_A, address)) {
+		REG_B = address;
+		return;
 	}
+
+	// if the memory allocation fails, return a NULL pointer
+	REG_B = 0x00;
+	REG_A = 0x00;
 }
 
 void SINVM::reallocate_heap_memory(bool error_if_not_found)
 {
 	/*
 
-	Attempts to reallocate the dynamic object at the location specified by REG_B with the number of bytes in REG_A.
-	If there is room for the new size where the object is currently allocated, then it will leave it where it is and simply change the size in the VM. If not, it will try to find a new place. If it can't reallocate the memory, it will load REG_A and REG_B with 0x00.
+	Attempts to reallocate the dynamic object at the location specified by REG_B (or, if the program uses handles, the object with the handle in REG_B) with the number of bytes in REG_A.
+	If there is room for the new size where the object is currently allocated, then it will leave it where it is and simply change the size in the VM. If not, it will try to find a new place, copying the object's data there. If it can't reallocate the memory, it will load REG_A and REG_B with 0x00.
 	If the VM cannot find an object at the location specified, it will:
 		- Load the registers with 0x00 if 'error_if_not_found' is true
 		- Allocate a new heap object if 'error_if_not_found' is false
 
 	*/
 
-	// iterate through the dynamic objects, trying to find the object we are looking for
-	std::list<DynamicObject>::iterator obj_iter = this->dynamic_objects.begin();
-	std::list<DynamicObject>::iterator target_object;
-	bool found = false;
+	this->check_heap_mode();
+
+	bool found;
+	word_t original_address;
+	if (this->using_heap_handles) {
+		std::map<word_t, word_t>::iterator handle = this->heap_handles.find(this->REG_B);
+		found = handle != this->heap_handles.end();
+		original_address = found ? handle->second : 0;
+	}
+	else {
+		found = this->heap.is_allocated(this->REG_B);
+		original_address = this->REG_B;
+	}
 
-	while (obj_iter != dynamic_objects.end() && !found) {
-		// if REG_B is equal to the address of obj_iter, we have found our object
-		if (obj_iter->get_start_address() == this->REG_B) {
-			found = true;
-			target_object = obj_iter;
+	if (!found) {
+		// depending on our parameter, the SINVM will behave differently -- load registers with NULL vs allocating a new object
+		if (error_if_not_found) {
+			this->REG_A = 0x00;	// we can't find the object, so set the registers to 0x00
+			this->REG_B = 0x00;
 		}
 		else {
-			obj_iter++;
+			this->allocate_heap_memory();	// allocate heap memory for the object if we can't find it
 		}
+		return;
 	}
 
-	// if we can't find the dynamic object, load the registers with 0x00
-	if (found) {
-		uint16_t original_address = obj_iter->get_start_address();
-		uint16_t old_size = obj_iter->get_size();
+	// if the object can stay where it is, there's nothing else to do
+	if (this->heap.resize(original_address, this->REG_A)) {
+		return;
+	}
 
-		// because we sort the list when we allocate a heap object, the next object (if there is one) will be next in the order
-		obj_iter++;	// increment the iterator
+	// otherwise, move it; the old object is only freed once its data has been copied
+	word_t old_size = this->heap.get_size(original_address);
+	word_t new_address;
 
-		// if we have another object in the vector, see if there is space for the new length
-		if (obj_iter != dynamic_objects.end()) {
-			// get the space between the start address and the end of the current object
-			uint16_t buffer_space = obj_iter->get_start_address() - (target_object->get_start_address() + target_object->get_size());
+	if (this->allocate_heap_object(this->REG_A, new_address)) {
+		// making room for the new object may have compacted the heap, moving the old one
+		if (this->using_heap_handles) {
+			original_address = this->heap_handles[this->REG_B];
+		}
 
-			// if the new size is greater than the target object's size, but less than the target object's size plus the buffer, update the size
-			// if it's less than or equal to the target object's size, we don't need to do anything
-			if ((this->REG_A > target_object->get_size()) && (this->REG_A < (target_object->get_size() + buffer_space))) {
-				target_object->set_size(this->REG_A);	// update the size to the value in REG_A
-			}
-			// otherwise, if it overflows the buffer, reallocate it
-			else if (this->REG_A > (target_object->get_size() + buffer_space)) {
-				// try to allocate it normally
-				this->allocate_heap_memory();
+		// resize(...) only fails when the object grows, so all of the old data fits
+		for (size_t i = 0; i < old_size; i++) {
+			this->write_byte(new_address + i, this->read_byte(original_address + i));
+		}
+		this->invalidate_decode_cache(new_address, old_size);
 
-				// copy the data from the old space into the new one
-				memcpy(&this->memory[this->REG_B], &this->memory[original_address], old_size);
+		this->heap.free(original_address);
 
-				// finally, remove the target object from the vector
-				this->dynamic_objects.erase(target_object);	// because target_object is an iterator, we can remove it
-			}
+		// the handle stays the same; only the address it holds changes
+		if (this->using_heap_handles) {
+			this->heap_handles[this->REG_B] = new_address;
+			this->write_word(this->REG_B, new_address);
 		}
 		else {
-			// otherwise, as long as we won't overrun the heap, it can stay
-			if ((target_object->get_start_address() + this->REG_A) <= _HEAP_MAX) {
-				target_object->set_size(this->REG_A);	// all we have to do is update the size
-			}
-			else {
-				this->REG_A = 0x00;	// there's no room, so load them with 0x00
-				this->REG_B = 0x00;
-			}
+			this->REG_B = new_address;
 		}
 	}
 	else {
-		// depending on our parameter, the SINVM will behave differently -- load registers with NULL vs allocating a new object
-		if (error_if_not_found) {
-			this->REG_A = 0x00;	// we can't find the object, so set the registers to 0x00
-			this->REG_B = 0x00;
-		}
-		else {
-			this->allocate_heap_memory();	// allocate heap memory for the object if we can't find it
-		}
+		this->REG_A = 0x00;	// there's no room, so load them with 0x00
+		this->REG_B = 0x00;
 	}
 }
 
@@ -149,28 +209,24 @@ void SINVM::free_heap_memory()
 {
 	/*
 
-	Free the memory block starting at the memory address indicated by the B register. If there is no memory there, throw a VMException
+	Free the memory block starting at the memory address indicated by the B register (or, if the program uses handles, the object with the handle in the B register). If there is no memory there, throw a VMException
 
 	*/
 
-	std::list<DynamicObject>::iterator obj_iter = this->dynamic_objects.begin();
-	bool found = false;
+	this->check_heap_mode();
 
-	while ((obj_iter != this->dynamic_objects.end()) && !found) {
-		// if the address of the object is the address we want to free, break from the loop; obj_iter contains the reference
-		if (obj_iter->get_start_address() == REG_B) {
-			found = true;
+	if (this->using_heap_handles) {
+		std::map<word_t, word_t>::iterator handle = this->heap_handles.find(REG_B);
+		if (handle == this->heap_handles.end()) {
+			throw VMException("Cannot free memory with the handle specified.");
 		}
-		// otherwise, increment the iterator
-		else {
-			obj_iter++;
-		}
-	}
 
-	if (found) {
-		this->dynamic_objects.remove(*obj_iter);
+		this->heap.free(handle->second);
+		this->write_word(handle->first, 0x00);
+		this->free_handles.push_back(handle->first);
+		this->heap_handles.erase(handle);
 	}
-	else {
+	else if (!this->heap.free(REG_B)) {
 		throw VMException("Cannot free memory at location specified.");
 	}
 }
@@ -0,0 +1,27 @@
+/*
+
+SIN Toolchain
+Inline.h
+Copyright 2019 Riley Lannon
+
+Contains SIN_FORCE_INLINE, which marks the small functions the dispatch loops call for nearly every instruction (memory access, the stacks, and the lazy flags).
+The switch dispatch loop is a single very large function, and compilers stop inlining into a function once it grows past a certain size; without this, these functions are called out of line from the loop no matter how small they are.
+It also contains SIN_LIKELY, for a branch in one of those functions that is almost always taken; without it, the compiler may do the work for both sides and select the result, which is slower when one side is a lookup the other doesn't need.
+
+*/
+
+#pragma once
+
+#if defined(_MSC_VER)
+#define SIN_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define SIN_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define SIN_FORCE_INLINE inline
+#endif
+
+#if defined(__GNUC__)
+#define SIN_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#else
+#define SIN_LIKELY(condition) (condition)
+#endif
@@ -0,0 +1,104 @@
+/*
+
+SIN Toolchain
+LazyFlags.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the LazyFlags class and of PendingFlags.
+The flag logic here must match what each operation would have done to the STATUS register had it updated the flags immediately; see ALU::add, ALU::sub, and SINVM::compare_values for the operations themselves.
+
+*/
+
+#include "LazyFlags.h"
+
+
+uint16_t PendingFlags::apply(uint16_t status) const {
+	// the arithmetic came first, so its flags are applied before those of any comparison made after it
+	if ((this->operation == flagoperation::add) || (this->operation == flagoperation::sub)) {
+		// additions and subtractions always clear N, V, Z, and C before setting them (note subtraction also clears the high byte, as it always has)
+		if (this->operation == flagoperation::add) {
+			status &= (0xFFFF - flagoperation::lazy_flags);
+
+			// if the result is zero, only the Z flag is set
+			if (this->result == 0) {
+				status |= StatusConstants::zero;
+			}
+			else {
+				if (this->result & wordaccess::sign_bit) {
+					status |= StatusConstants::negative;
+				}
+
+				// if (result - right) is not equal to the left operand, a carry occurred; this is computed in 64 bits so that it can't wrap around
+				if ((int64_t)this->result - this->right != this->left) {
+					status |= StatusConstants::carry;
+				}
+
+				// if the sign bit is not set in either operand, but it's set in the result, the operation overflowed
+				if ((!(this->right & wordaccess::sign_bit) && !(this->left & wordaccess::sign_bit)) && (this->result & wordaccess::sign_bit)) {
+					status |= StatusConstants::overflow;
+				}
+			}
+		}
+		else {
+			status &= (0xFF - flagoperation::lazy_flags);
+
+			// the carry is set if no borrow occurred; otherwise, the overflow is set
+			if ((uint64_t)this->result + this->right == this->left) {
+				status |= StatusConstants::carry;
+			}
+			else {
+				status |= StatusConstants::overflow;
+			}
+
+			if (this->result == 0) {
+				status |= StatusConstants::zero;
+			}
+			else if (this->result & wordaccess::sign_bit) {
+				status |= StatusConstants::negative;
+			}
+		}
+	}
+
+	if (this->compare_pending) {
+		// comparisons set Z if the values are equal; otherwise, they clear Z and set C according to which was greater
+		if (this->compare_left == this->compare_right) {
+			status |= StatusConstants::zero;
+		}
+		else {
+			status &= (0xFF - StatusConstants::zero);
+			if (this->compare_left < this->compare_right) {
+				status &= (0xFF - StatusConstants::carry);
+			}
+			else {
+				status |= StatusConstants::carry;
+			}
+		}
+	}
+
+	return status;
+}
+
+
+PendingFlags::PendingFlags()
+{
+	this->operation = flagoperation::none;
+	this->left = 0;
+	this->right = 0;
+	this->result = 0;
+	this->compare_pending = false;
+	this->compare_left = 0;
+	this->compare_right = 0;
+}
+
+
+LazyFlags::LazyFlags(uint16_t* STATUS) : STATUS(STATUS)
+{
+}
+
+LazyFlags::LazyFlags() {
+	this->STATUS = nullptr;
+}
+
+LazyFlags::~LazyFlags()
+{
+}
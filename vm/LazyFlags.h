@@ -0,0 +1,144 @@
+/*
+
+SIN Toolchain
+LazyFlags.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the LazyFlags class, which the VM uses to evaluate the N, V, Z, and C flags lazily.
+
+Additions, subtractions, and comparisons are by far the most common operations that affect the STATUS register, but their results are rarely read before the next such operation overwrites them. Rather than updating STATUS immediately, these operations record their operands and result here; the flags are only computed (or "resolved") when something actually needs to look at them -- a branch, TSTATUSA/TSTATUSB, a signal, or another operation that only updates some of the flags.
+
+The rule for anything that touches the STATUS register directly is:
+	- before reading the N, V, Z, or C flags, call resolve()
+	- before overwriting the whole register, call discard()
+The H, I, U, and F flags are never deferred, so they may be read and written at any time.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include "StatusConstants.h"
+#include "WordAccess.h"
+#include "Inline.h"
+
+namespace flagoperation {
+	// the operation whose flags are pending
+	const uint8_t none = 0;
+	const uint8_t add = 1;
+	const uint8_t sub = 2;
+	const uint8_t compare = 3;
+
+	// the flags that may be pending
+	const uint8_t lazy_flags = StatusConstants::negative | StatusConstants::overflow | StatusConstants::zero | StatusConstants::carry;
+}
+
+struct PendingFlags {
+	/*
+
+	The operations whose flags haven't been written to STATUS yet. This is kept apart from LazyFlags so that the execution trace can copy it as it is, and only work out the flags if the trace is written (see ExecutionTrace.h).
+
+	*/
+
+	typedef wordaccess::vm_word word_t;
+
+	// the most recent addition or subtraction and its operands
+	uint8_t operation;
+	word_t left;
+	word_t right;
+	word_t result;
+
+	// a comparison made since then; it only decides some of the flags, so it is kept alongside the arithmetic rather than replacing it
+	bool compare_pending;
+	word_t compare_left;
+	word_t compare_right;
+
+	uint16_t apply(uint16_t status) const;	// returns 'status' with the flags from the pending operations applied
+
+	PendingFlags();
+};
+
+class LazyFlags {
+	typedef wordaccess::vm_word word_t;
+
+	uint16_t* STATUS;
+	PendingFlags pending;
+public:
+	/*
+
+	These run for nearly every arithmetic instruction, comparison, and branch, so they are defined here where the dispatch loops can inline them.
+	Only the full computation in PendingFlags::apply(...) is left out of line.
+
+	*/
+
+	// record an operation whose flags will be computed later
+	SIN_FORCE_INLINE void record(uint8_t operation, word_t left, word_t right, word_t result) {
+		if (operation == flagoperation::compare) {
+			// comparisons leave N and V alone (and C, if the values were equal), so the arithmetic before them stays pending; only a second comparison forces the flags to be written
+			if (this->pending.compare_pending) {
+				this->resolve();
+			}
+
+			this->pending.compare_pending = true;
+			this->pending.compare_left = left;
+			this->pending.compare_right = right;
+		}
+		else {
+			// additions and subtractions overwrite all of the lazy flags, so they simply replace whatever was pending
+			this->pending.compare_pending = false;
+			this->pending.operation = operation;
+			this->pending.left = left;
+			this->pending.right = right;
+			this->pending.result = result;
+		}
+	}
+
+	// whether the lazy flag 'bit' is set, without writing the pending flags to STATUS
+	SIN_FORCE_INLINE bool test(uint16_t bit) {
+		if (this->pending.compare_pending) {
+			// a comparison only decides Z, and C when the values differ; see PendingFlags::apply(...)
+			if (bit == StatusConstants::zero) {
+				return this->pending.compare_left == this->pending.compare_right;
+			}
+			else if ((bit == StatusConstants::carry) && (this->pending.compare_left != this->pending.compare_right)) {
+				return this->pending.compare_left > this->pending.compare_right;
+			}
+		}
+
+		if (this->pending.operation == flagoperation::none) {
+			return *this->STATUS & bit;
+		}
+		else {
+			return this->pending.apply(*this->STATUS) & bit;
+		}
+	}
+
+	// get the carry bit without resolving the other flags; ADDCA and SUBCA need it, but will overwrite every other flag
+	SIN_FORCE_INLINE uint16_t get_carry() {
+		return this->test(StatusConstants::carry) ? StatusConstants::carry : 0;
+	}
+
+	// write any pending flags to the STATUS register
+	SIN_FORCE_INLINE void resolve() {
+		if ((this->pending.operation != flagoperation::none) || this->pending.compare_pending) {
+			*this->STATUS = this->pending.apply(*this->STATUS);
+			this->pending.operation = flagoperation::none;
+			this->pending.compare_pending = false;
+		}
+	}
+
+	// forget any pending flags; used when the STATUS register is about to be overwritten
+	SIN_FORCE_INLINE void discard() {
+		this->pending.operation = flagoperation::none;
+		this->pending.compare_pending = false;
+	}
+
+	// the pending flags as they are, without resolving them; STATUS together with these gives the real flags
+	const PendingFlags& get_pending() const {
+		return this->pending;
+	}
+
+	LazyFlags(uint16_t* STATUS);
+	LazyFlags();
+	~LazyFlags();
+};
@@ -10,60 +10,28 @@ Contains the implementations to various memory access functions in the SIN VM su
 
 #include "SINVM.h"
 
-uint16_t SINVM::get_data_of_wordsize() {
-	/*
-
-	Since we might have a variable wordsize, we need to be able to handle numbers of various word sizes. As such, have a function to do this for us (since we will be doing it a lot).
-	The routine is simple: initialize a variable to 0, read in the first byte, add it to our variable, and shift the bits left by 8; then, increment the PC. Continue until we have one more byte left to read, at which point, stop looping. Then, dereference the PC and add it to our variable. We can then return the variable.
-	It is done this way so that it
-		a) doesn't shift the bits too far over, requiring us to shift them back after
-		b) doesn't increment the PC one too many times, requiring us to decrement it after
-
-	Note on usage:
-		The function should be executed *with the PC pointing to the first byte we want to read*. It will end with the PC pointing to the next byte to read after we are done.
-
-	*/
-
-	// load the appropriate number of bytes according to our wordsize
-	uint16_t data_to_load = 0;
-
-	// loop one time too few
-	for (size_t i = 1; i < (this->_WORDSIZE / 8); i++) {
-		data_to_load = data_to_load + this->memory[this->PC];
-		data_to_load = data_to_load << 8;
-		this->PC++;
-	}
-	// and put the data in on the last time -- this is to prevent incrementing PC too much or bitshifting too far
-	data_to_load = data_to_load + this->memory[this->PC];
+#include <algorithm>
 
-	return data_to_load;
-}
-
-uint16_t SINVM::execute_load() {
+SINVM::word_t SINVM::execute_load(const DecodedInstruction& instruction) {
 	/*
 
-	Execute a LOAD_ instruction. This function takes a pointer to the register we want to load and executes the load instruction accordingly, storing the ultimate fetched result in the register we passed into the function.
+	Execute a LOAD_ instruction. This function takes the decoded instruction and executes the load accordingly, returning the ultimate fetched result so it may be stored in the appropriate register.
 
-	The function first reads the addressing mode, uses get_data_of_wordsize() to get the data after the addressing mode data (could be interpreted as an immediate value or memory address). It then checks the addressing mode to see how it needs to interpret the data it just fetched (data_to_load), and acts accordingly (e.g., if it's absolute, it gets the value at that memory address, then stores it in the register; if it is indexed, it does it almost the same, but adds the address value first, etc.).
+	The function first gets the addressing mode and the data after it (could be interpreted as an immediate value or memory address) from the decoded instruction. It then checks the addressing mode to see how it needs to interpret that data (data_to_load), and acts accordingly (e.g., if it's absolute, it gets the value at that memory address, then stores it in the register; if it is indexed, it does it almost the same, but adds the address value first, etc.).
 
 	This function also makes use of 'validate_address()' to ensure all the addresses are within range.
 
 	*/
 
 
-	// the next data we have is the addressing mode
-	this->PC++;
-	uint8_t addressing_mode = this->memory[this->PC];
+	uint8_t addressing_mode = instruction.addressing_mode;
 
 	if (addressing_mode == addressingmode::reg_b) {
 		return REG_B;
 	}
 
-	// the next data is the first byte of the data
-	this->PC++;
-
-	// load the appropriate number of bytes according to our wordsize
-	uint16_t data_to_load = this->get_data_of_wordsize();
+	// the data following the addressing mode
+	word_t data_to_load = instruction.operand;
 
 	/*
 
@@ -83,7 +51,7 @@ uint16_t SINVM::execute_load() {
 	// check our addressing mode and decide how to interpret our data
 	if ((addressing_mode == addressingmode::absolute) || (addressing_mode == addressingmode::x_index) || (addressing_mode == addressingmode::y_index)) {
 		// if we have absolute or x/y indexed-addressing, we will be reading from memory
-		uint16_t data_in_memory = 0;
+		word_t data_in_memory = 0;
 
 		// however, we need to make sure that if it is indexed, we add the register values to data_to_load, which contains the memory address, so we actually perform the indexing
 		if (addressing_mode == addressingmode::x_index) {
@@ -139,39 +107,38 @@ uint16_t SINVM::execute_load() {
 		// indirect indexed addressing with the X register
 
 		// get the data at the address indicated by data_to_load
-		uint16_t data_in_memory = this->get_data_from_memory(data_to_load);	// get the whole word (as it's an address), so don't use short addressing
+		word_t data_in_memory = this->get_data_from_memory(data_to_load);	// get the whole word (as it's an address), so don't use short addressing
 		// now go to that address + reg_x and return the data there
 		return this->get_data_from_memory(data_in_memory + REG_X, is_short);	// we _may_ want short addressing here, so pass the is_short flag
 	}
 	else if (addressing_mode == addressingmode::indirect_indexed_y) {
 		// indirect indexed addressing with the Y register
-		uint16_t data_in_memory = this->get_data_from_memory(data_to_load);	// get the whole word (as it's an address), so don't use short addressing
+		word_t data_in_memory = this->get_data_from_memory(data_to_load);	// get the whole word (as it's an address), so don't use short addressing
 		return this->get_data_from_memory(data_in_memory + REG_Y, is_short);	// we _may_ want short addressing here, so pass the is_short flag
 	}
 
 	// indexed indirect
 	else if (addressing_mode == addressingmode::indexed_indirect_x) {
 		// go to data_to_load + X, get the value there, go to that address, and return the value stored there
-		uint16_t data_in_memory = this->get_data_from_memory(data_to_load + REG_X);	// get the whole word (as it's an address), so don't use short addressing
+		word_t data_in_memory = this->get_data_from_memory(data_to_load + REG_X);	// get the whole word (as it's an address), so don't use short addressing
 		return this->get_data_from_memory(data_in_memory, is_short);	// we _may_ want short addressing here, so pass the is_short flag
 	}
 	else if (addressing_mode == addressingmode::indexed_indirect_y) {
-		uint16_t data_in_memory = this->get_data_from_memory(data_to_load + REG_Y);	// get the whole word (as it's an address), so don't use short addressing
+		word_t data_in_memory = this->get_data_from_memory(data_to_load + REG_Y);	// get the whole word (as it's an address), so don't use short addressing
 		return this->get_data_from_memory(data_in_memory, is_short);	// we _may_ want short addressing here, so pass the is_short flag
 	}
-}
 
+	// any other mode (e.g., plain indirect) is illegal; back up the PC to the opcode, as execute_store does
+	this->PC -= (this->_WORDSIZE / 8) + 1;
+	this->send_signal(SINSIGILL);
+	return 0;
+}
 
-void SINVM::execute_store(uint16_t reg_to_store) {
-	// our next byte is the addressing mode
-	this->PC++;
-	uint8_t addressing_mode = this->memory[this->PC];
-
-	// increment the program counter
-	this->PC++;
 
-	// next, get the memory location
-	uint16_t memory_address = this->get_data_of_wordsize();
+void SINVM::execute_store(word_t reg_to_store, const DecodedInstruction& instruction) {
+	// get the addressing mode and the memory location from the decoded instruction
+	uint8_t addressing_mode = instruction.addressing_mode;
+	word_t memory_address = instruction.operand;
 
 	/*
 
@@ -189,7 +156,9 @@ void SINVM::execute_store(uint16_t reg_to_store) {
 	}
 
 	// act according to the addressing mode
-	if ((addressing_mode != addressingmode::immediate) && (addressing_mode != addressingmode::reg_a) && (addressing_mode != addressingmode::reg_b)) {
+	if ((addressing_mode == addressingmode::absolute) || (addressing_mode == addressingmode::x_index) || (addressing_mode == addressingmode::y_index) ||
+		(addressing_mode == addressingmode::indirect_indexed_x) || (addressing_mode == addressingmode::indirect_indexed_y) ||
+		(addressing_mode == addressingmode::indexed_indirect_x) || (addressing_mode == addressingmode::indexed_indirect_y)) {
 		// add the appropriate register if it is an indexed addressing mode
 		if ((addressing_mode == addressingmode::x_index) || (addressing_mode == addressingmode::indirect_indexed_x)) {
 			// since we will index after, we can include indirect indexed here -- if it's indirect, we simply get that value before we index
@@ -217,87 +186,316 @@ void SINVM::execute_store(uint16_t reg_to_store) {
 
 		return;
 	}
-	else if (addressing_mode == addressingmode::immediate) {
-		// back up the PC by three bytes as we have already read data
-		this->PC -= 3;
-		this->send_signal(SINSIGILL);	// illegal instruction; cannot use immediate addressing with a storeR instruction
+	else {
+		// back up the PC to the opcode as we have already read data
+		this->PC -= (this->_WORDSIZE / 8) + 1;
+		this->send_signal(SINSIGILL);	// illegal instruction; cannot use immediate or register addressing (or an unknown mode) with a storeR instruction
 	}
 }
 
 
-uint16_t SINVM::get_data_from_memory(uint16_t address, bool is_short) {
-	// read value of _WORDSIZE in memory and return it in the form of an int
-	// different from "execute_load()" in that it doesn't affect the program counter and does not take addressing mode into consideration
-
-	if (address_is_valid(address)) {
-		uint16_t data = 0;
+bool SINVM::range_is_valid(word_t address, uint8_t permission, size_t num_bytes) {
+	if (num_bytes == 0) {
+		return true;
+	}
+	else if ((size_t)address + num_bytes > memory_size) {
+		return false;
+	}
 
-		// if we are using the short addressing mode, get the individual byte
-		if (is_short) {
-			data = this->memory[address];
+	// check the first byte on each page the range touches
+	size_t current = address;
+	size_t end = (size_t)address + num_bytes;
+	while (current < end) {
+		if (!this->access_is_valid((word_t)current, permission, 1)) {
+			return false;
 		}
-		// otherwise, get the whole word
-		else {
-			size_t wordsize_bytes = this->_WORDSIZE / 8;
+		current = (current & ~(pagepermission::page_size - 1)) + pagepermission::page_size;
+	}
 
-			size_t memory_index = 0;
-			size_t bitshift_index = (wordsize_bytes - 1);
+	return true;
+}
 
-			while (memory_index < (wordsize_bytes - 1)) {
-				data += this->memory[address + memory_index];
-				data <<= (bitshift_index * 8);
+void SINVM::set_read_page(size_t page, const uint8_t* data) {
+	// the VM gets its own copy of the table the first time it changes an entry in it; see PagePermissions.h
+	size_t table = page >> pagepermission::table_page_shift;
+	if (this->own_read_tables[table] == nullptr) {
+		this->own_read_tables[table] = new const uint8_t*[pagepermission::table_size];
+		std::copy(this->read_pages[table], this->read_pages[table] + pagepermission::table_size, this->own_read_tables[table]);
+		this->read_pages[table] = this->own_read_tables[table];
+	}
 
-				memory_index++;
-				bitshift_index--;
-			}
-			data += this->memory[address + memory_index];
-		}
+	this->own_read_tables[table][page & (pagepermission::table_size - 1)] = data;
+}
 
-		return data;
+void SINVM::set_write_page(size_t page, uint8_t* data) {
+	size_t table = page >> pagepermission::table_page_shift;
+	if (this->own_write_tables[table] == nullptr) {
+		this->own_write_tables[table] = new uint8_t*[pagepermission::table_size]();
+		this->write_pages[table] = this->own_write_tables[table];
+	}
+
+	this->own_write_tables[table][page & (pagepermission::table_size - 1)] = data;
+}
+
+void SINVM::set_page_permissions(size_t page, uint8_t permissions) {
+	size_t table = page >> pagepermission::table_page_shift;
+	if (this->own_permission_tables[table] == nullptr) {
+		this->own_permission_tables[table] = new uint8_t[pagepermission::table_size];
+		std::copy(this->page_permissions[table], this->page_permissions[table] + pagepermission::table_size, this->own_permission_tables[table]);
+		this->page_permissions[table] = this->own_permission_tables[table];
+	}
+
+	this->own_permission_tables[table][page & (pagepermission::table_size - 1)] = permissions;
+}
+
+uint8_t* SINVM::copy_page(size_t page) {
+	/*
+
+	Gives the VM its own copy of a page so that it may be written; called the first time the VM writes to a page it shares.
+	Copies released by reset() are reused before any new ones are allocated.
+
+	*/
+
+	uint8_t* copy;
+	if (!this->free_pages.empty()) {
+		copy = this->free_pages.back();
+		this->free_pages.pop_back();
 	}
-	// if we have an invalid memory address, we have an access violation
 	else {
-		this->send_signal(SINSIGSEGV);
-		return 0xFFFF;
+		copy = new uint8_t[pagepermission::page_size];
+	}
+
+	memcpy(copy, this->get_read_page(page), pagepermission::page_size);
+
+	this->set_read_page(page, copy);
+	this->set_write_page(page, copy);
+	this->written_pages.push_back(page);
+	return copy;
+}
+
+void SINVM::release_page(size_t page) {
+	/*
+
+	Gives up the VM's copy of a page, if it has one, so that it may be reused; used when a window is pointed somewhere else.
+	reset() releases every copy at once, so it does this itself rather than searching written_pages for each one.
+
+	*/
+
+	if (this->get_write_page(page) == nullptr) {
+		return;
 	}
+
+	this->free_pages.push_back(this->get_write_page(page));
+	this->set_write_page(page, nullptr);
+
+	std::vector<size_t>::iterator it = std::find(this->written_pages.begin(), this->written_pages.end(), page);
+	*it = this->written_pages.back();
+	this->written_pages.pop_back();
 }
 
-void SINVM::store_in_memory(uint16_t address, uint16_t new_value, bool is_short) {
-	// stores value "new_value" in memory address starting at "high_byte_address"
+SINVM::word_t SINVM::read_word_across_pages(word_t address) {
+	// a word that runs over the end of a page can't be read with a single load, so read it one byte at a time
+	word_t value = 0;
+	for (size_t i = 0; i < sizeof(word_t); i++) {
+		value = (value << 8) | this->read_byte(address + i);
+	}
+	return value;
+}
+
+void SINVM::write_word_across_pages(word_t address, word_t value) {
+	for (size_t i = 0; i < sizeof(word_t); i++) {
+		this->write_byte(address + i, value >> ((sizeof(word_t) - 1 - i) * 8));
+	}
+}
+
+
+void SINVM::move_memory() {
+	/*
+
+	Executes a MOVM instruction: copies A bytes from the address in B to the address in X. The ranges may overlap; the result is as if the source were copied to a temporary buffer first.
+	The whole of both ranges is checked once, before anything is copied, and the bytes are then moved with memmove a page at a time. The registers are left as they were.
+
+	*/
+
+	size_t num_bytes = REG_A;
+	if (!this->range_is_valid(REG_B, pagepermission::read, num_bytes) || !this->range_is_valid(REG_X, pagepermission::write, num_bytes)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	size_t source = REG_B;
+	size_t destination = REG_X;
+	size_t remaining = num_bytes;
+
+	if ((destination <= source) || (destination >= source + num_bytes)) {
+		// copy from the start; the destination never gets ahead of the source
+		while (remaining > 0) {
+			size_t source_offset = source & (pagepermission::page_size - 1);
+			size_t destination_offset = destination & (pagepermission::page_size - 1);
+			size_t length = std::min(remaining, pagepermission::page_size - std::max(source_offset, destination_offset));
+
+			// get the destination page first; if the source is on the same page, it must be read from the copy
+			uint8_t* destination_page = this->get_write_page(destination >> pagepermission::page_shift);
+			if (destination_page == nullptr) {
+				destination_page = this->copy_page(destination >> pagepermission::page_shift);
+			}
+			memmove(&destination_page[destination_offset], &this->get_read_page(source >> pagepermission::page_shift)[source_offset], length);
+
+			source += length;
+			destination += length;
+			remaining -= length;
+		}
+	}
+	else {
+		// the destination overlaps the end of the source, so copy from the end
+		size_t source_end = source + num_bytes;
+		size_t destination_end = destination + num_bytes;
+
+		while (remaining > 0) {
+			size_t source_length = ((source_end - 1) & (pagepermission::page_size - 1)) + 1;
+			size_t destination_length = ((destination_end - 1) & (pagepermission::page_size - 1)) + 1;
+			size_t length = std::min(remaining, std::min(source_length, destination_length));
 
+			source_end -= length;
+			destination_end -= length;
+
+			uint8_t* destination_page = this->get_write_page(destination_end >> pagepermission::page_shift);
+			if (destination_page == nullptr) {
+				destination_page = this->copy_page(destination_end >> pagepermission::page_shift);
+			}
+			memmove(&destination_page[destination_end & (pagepermission::page_size - 1)], &this->get_read_page(source_end >> pagepermission::page_shift)[source_end & (pagepermission::page_size - 1)], length);
+
+			remaining -= length;
+		}
+	}
+
+	this->invalidate_decode_cache(REG_X, num_bytes);
+	this->cycles += num_bytes * cyclecost::block_byte;
+}
+
+void SINVM::fill_memory() {
 	/*
 
-	Make the assignment and return
+	Executes a FILLM instruction: sets A bytes, starting at the address in X, to the low byte of B.
+	Like MOVM, the range is checked once and then filled with memset a page at a time, and the registers are left as they were.
 
-	If we are using short addressing, we set the individual address to the new value and return
+	*/
 
-	Otherwise, if we are using the whole word:
-	We can't do this quite the same way here as we did in the assembler; because our memory address needs to start low, and our bit shift needs to start high, we have to do a little trickery to get it right -- let's use 32-bit wordsize assigning to location $00 as an example:
-	- First, we iterate from i=_WORDSIZE/8, so i=4
-	- Now, we assign the value at address [memory_address + (wordsize_bytes - i)], so we assign to value memory_address, or $00
-	- The value to assign is our value bitshifted by (i - 1) * 8; here, 24 bits; so, the high byte
-	- On the next iteration, i = 3; so we assign to location [$00 + (4 - 3)], or $01, and we assign the value bitshifted by 16 bits
-	- On the next iteration, i = 2; so we assign to location [$00 + (4 - 2)], or $02, and we assign the value bitshifted by 8 bits
-	- On the final iteration, i = 1; so we assign to location [$00 + (4 - 1)], $03, and we assign the value bitshifted by (1 - 1); the value to assign is then reg_to_store >> 0, which is the low byte
-	- That means we have the bytes ordered correctly in big-endian format
+	size_t num_bytes = REG_A;
+	if (!this->range_is_valid(REG_X, pagepermission::write, num_bytes)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	size_t destination = REG_X;
+	size_t remaining = num_bytes;
+
+	while (remaining > 0) {
+		size_t offset = destination & (pagepermission::page_size - 1);
+		size_t length = std::min(remaining, pagepermission::page_size - offset);
+
+		uint8_t* page = this->get_write_page(destination >> pagepermission::page_shift);
+		if (page == nullptr) {
+			page = this->copy_page(destination >> pagepermission::page_shift);
+		}
+		memset(&page[offset], REG_B & 0xFF, length);
+
+		destination += length;
+		remaining -= length;
+	}
+
+	this->invalidate_decode_cache(REG_X, num_bytes);
+	this->cycles += num_bytes * cyclecost::block_byte;
+}
+
+
+void SINVM::execute_vector_operation(uint8_t opcode) {
+	/*
+
+	Executes VADD, VSUB, VAND, VOR, VXOR, or VCMP on the A words at the address in X (the destination, and the left operand) and the A words at the address in B (the right operand). The registers are left as they were.
+	Both ranges are checked once, before anything is written; each run of words that lies within a single page of both ranges is then handed to the vector unit (see VectorUnit.h).
+	The result is always as if the words were done one at a time, in ascending order.
 
 	*/
 
-	// if we have a valid address, we are allowed to store the data in memory; otherwise, we have an access violation
-	if (address_is_valid(address)) {
-		if (is_short) {
-			this->memory[address] = new_value & 0xFF;	// low byte only if we are using short addressing
+	size_t num_bytes = (size_t)REG_A * 2;
+	if (!this->range_is_valid(REG_B, pagepermission::read, num_bytes) || !this->range_is_valid(REG_X, pagepermission::write, num_bytes)) {
+		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	size_t source = REG_B;
+	size_t destination = REG_X;
+	size_t remaining = REG_A;
+
+	// the vector unit loads a group of words before it stores any of them, so if the destination overlaps the end of the source, the words have to be done one at a time
+	bool one_at_a_time = (destination > source) && (destination < source + num_bytes);
+
+	while (remaining > 0) {
+		size_t source_offset = source & (pagepermission::page_size - 1);
+		size_t destination_offset = destination & (pagepermission::page_size - 1);
+		size_t num_words = std::min(remaining, (pagepermission::page_size - std::max(source_offset, destination_offset)) / 2);
+
+		if (one_at_a_time || (num_words == 0)) {
+			// do a single word, reading it a byte at a time in case it runs over the end of a page
+			uint16_t left = (this->read_byte((word_t)destination) << 8) | this->read_byte((word_t)(destination + 1));
+			uint16_t right = (this->read_byte((word_t)source) << 8) | this->read_byte((word_t)(source + 1));
+			uint16_t result = vectorunit::apply(opcode, left, right);
+			this->write_byte((word_t)destination, result >> 8);
+			this->write_byte((word_t)(destination + 1), result & 0xFF);
+			num_words = 1;
 		}
 		else {
-			size_t wordsize_bytes = this->_WORDSIZE / 8;
-			for (size_t i = wordsize_bytes; i > 0; i--) {
-				this->memory[address + (wordsize_bytes - i)] = new_value >> ((i - 1) * 8);
+			// get the destination page first; if the source is on the same page, it must be read from the copy
+			uint8_t* destination_page = this->get_write_page(destination >> pagepermission::page_shift);
+			if (destination_page == nullptr) {
+				destination_page = this->copy_page(destination >> pagepermission::page_shift);
 			}
+			vectorunit::apply(opcode, &destination_page[destination_offset], &this->get_read_page(source >> pagepermission::page_shift)[source_offset], num_words);
 		}
+
+		source += num_words * 2;
+		destination += num_words * 2;
+		remaining -= num_words;
 	}
-	else {
+
+	this->invalidate_decode_cache(REG_X, num_bytes);
+	this->cycles += REG_A * cyclecost::vector_word;
+}
+
+void SINVM::sum_vector() {
+	/*
+
+	Executes a VSUM instruction: loads A with the sum of the A words at the address in B, modulo $10000. The flags are not changed.
+
+	*/
+
+	size_t num_bytes = (size_t)REG_A * 2;
+	if (!this->range_is_valid(REG_B, pagepermission::read, num_bytes)) {
 		this->send_signal(SINSIGSEGV);
+		return;
+	}
+
+	size_t source = REG_B;
+	size_t remaining = REG_A;
+	uint16_t total = 0;
+
+	while (remaining > 0) {
+		size_t offset = source & (pagepermission::page_size - 1);
+		size_t num_words = std::min(remaining, (pagepermission::page_size - offset) / 2);
+
+		if (num_words == 0) {
+			total += (this->read_byte((word_t)source) << 8) | this->read_byte((word_t)(source + 1));
+			num_words = 1;
+		}
+		else {
+			total += vectorunit::sum(&this->get_read_page(source >> pagepermission::page_shift)[offset], num_words);
+		}
+
+		source += num_words * 2;
+		remaining -= num_words;
 	}
 
-	return;
+	this->cycles += REG_A * cyclecost::vector_word;
+	REG_A = total;
 }
@@ -0,0 +1,148 @@
+/*
+
+SIN Toolchain
+MemoryBanks.cpp
+Copyright 2019 Riley Lannon
+
+This file contains the implementations of the SINVM functions behind the bank syscalls:
+	1) void bank_select()	-	show the bank in A in the bank window, loading A with the bank that was shown before
+	2) void far_call()	-	call a function in another bank; used by the trampolines the linker writes
+	3) void far_return()	-	return from a function called with far_call()
+	4) void decode_in_bank(word_t, word_t, DecodedInstruction&)	-	decode an instruction in a bank that may not be selected; used by the profiler
+
+A bank the program doesn't have generates a SINSIGSYS signal. See ProgramImage.h and Doc/syscall.txt.
+
+*/
+
+#include "SINVM.h"
+
+
+bool SINVM::select_bank(word_t bank) {
+	/*
+
+	Shows 'bank' in the bank window; bank 0 is the conventional memory behind it.
+	Like the file window, the pages of the window point straight at the bank. Anything the program wrote to the window while bank 0 was selected is lost.
+
+	*/
+
+	if (bank > this->program->get_num_banks()) {
+		return false;
+	}
+	else if (bank == this->selected_bank) {
+		return true;
+	}
+
+	for (size_t page = _BANK_WINDOW_START >> pagepermission::page_shift; page <= (_BANK_WINDOW_END >> pagepermission::page_shift); page++) {
+		this->release_page(page);
+
+		if (bank == 0) {
+			this->set_read_page(page, this->program->get_page(page));
+			this->set_page_permissions(page, pagepermission::read | pagepermission::write | pagepermission::execute);
+		}
+		else {
+			this->set_read_page(page, this->program->get_bank_page(bank, page << pagepermission::page_shift));
+			this->set_page_permissions(page, pagepermission::read | pagepermission::execute);
+		}
+	}
+
+	this->selected_bank = bank;
+	return true;
+}
+
+
+void SINVM::decode_in_bank(word_t bank, word_t address, DecodedInstruction& instruction) {
+	/*
+
+	Decodes the instruction at 'address' as it is in 'bank', whether or not that bank is selected; used by the profiler, which reports on every bank the program ran code in.
+	The bank's decode cache is used if it holds the instruction. Otherwise, the window is pointed at the bank just long enough to decode it; no instruction runs in between, so nothing else sees the change.
+
+	*/
+
+	if ((bank == this->selected_bank) || (address < _BANK_WINDOW_START) || (address > _BANK_WINDOW_END)) {
+		this->decode_instruction(address, instruction);
+		return;
+	}
+
+	if ((bank != 0) && (this->bank_decode_caches[bank - 1] != nullptr)) {
+		instruction = this->bank_decode_caches[bank - 1][address - _BANK_WINDOW_START];
+		return;
+	}
+
+	size_t first_page = _BANK_WINDOW_START >> pagepermission::page_shift;
+	size_t last_page = _BANK_WINDOW_END >> pagepermission::page_shift;
+	std::vector<const uint8_t*> shown;
+
+	for (size_t page = first_page; page <= last_page; page++) {
+		shown.push_back(this->get_read_page(page));
+		this->set_read_page(page, (bank == 0) ? this->program->get_page(page) : this->program->get_bank_page(bank, page << pagepermission::page_shift));
+	}
+
+	this->decode_instruction(address, instruction);
+
+	for (size_t page = first_page; page <= last_page; page++) {
+		this->set_read_page(page, shown[page - first_page]);
+	}
+}
+
+
+void SINVM::bank_select()
+{
+	/*
+
+	Shows the bank in A in the bank window, and loads A with the bank that was shown before.
+	The code that does this must not be in the window itself; functions in banks are called with far_call() instead.
+
+	*/
+
+	word_t previous = this->selected_bank;
+	if (!this->select_bank(REG_A)) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	REG_A = previous;
+}
+
+void SINVM::far_call()
+{
+	/*
+
+	Calls a function in a bank. This is only used by the trampolines the linker writes, which look like this:
+		syscall #SYS_FARCALL
+		(the function's bank)
+		(the function's address)
+		syscall #SYS_FARRETURN
+		rts
+	The selected bank is saved on the call stack, followed by a return address that points at the second syscall; the function's bank is then selected and the function is called. When the function returns, far_return() restores the bank, and the RTS returns to whoever called the trampoline.
+	None of the registers are changed, so arguments and return values are passed just as they would be to any other function.
+
+	*/
+
+	// the PC is at the last byte of the syscall, so the bank and address follow it
+	word_t bank = this->read_word(this->PC + 1);
+	word_t address = this->read_word(this->PC + 1 + (this->_WORDSIZE / 8));
+
+	// both words must fit on the call stack
+	if (this->CALL_SP <= _CALL_STACK_BOTTOM + (this->_WORDSIZE / 8)) {
+		this->PC -= (this->_WORDSIZE / 8) + 1;
+		this->send_signal(SINSIGSTKFLT);
+		return;
+	}
+
+	word_t previous = this->selected_bank;
+	if (!this->select_bank(bank)) {
+		this->send_signal(SINSIGSYS);
+		return;
+	}
+
+	this->push_call_stack(previous);
+	this->push_call_stack(this->PC + 2 * (this->_WORDSIZE / 8));	// the byte before the second syscall, as RTS doesn't offset the address
+	this->PC = address - 1;	// as in JSR, the PC is incremented at the end of each cycle
+}
+
+void SINVM::far_return()
+{
+	if (!this->select_bank(this->pop_call_stack())) {
+		this->send_signal(SINSIGSYS);
+	}
+}
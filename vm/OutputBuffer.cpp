@@ -0,0 +1,78 @@
+/*
+
+SIN Toolchain
+OutputBuffer.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the OutputBuffer class.
+
+*/
+
+#include "OutputBuffer.h"
+
+
+void OutputBuffer::drain() {
+	if (!this->buffer.empty()) {
+		this->stream->write(this->buffer.data(), this->buffer.size());
+		this->buffer.clear();
+	}
+
+	// when unbuffered, every write must be seen right away
+	if (this->size == 0) {
+		this->stream->flush();
+	}
+}
+
+void OutputBuffer::write(const char* data, size_t length) {
+	if (this->buffer.size() + length < this->size) {
+		this->buffer.append(data, length);
+	}
+	else {
+		// there's no point in copying something that won't fit in the buffer; write it straight to the stream
+		this->drain();
+		if (length < this->size) {
+			this->buffer.append(data, length);
+		}
+		else {
+			this->stream->write(data, length);
+			if (this->size == 0) {
+				this->stream->flush();
+			}
+		}
+	}
+}
+
+void OutputBuffer::flush() {
+	this->drain();
+	this->stream->flush();
+}
+
+
+std::ostream& OutputBuffer::get_stream() {
+	return *this->stream;
+}
+
+void OutputBuffer::set_stream(std::ostream& stream) {
+	if (!this->buffer.empty()) {
+		this->flush();
+	}
+	this->stream = &stream;
+}
+
+void OutputBuffer::set_size(size_t size) {
+	this->drain();
+	this->size = size;
+	this->buffer.reserve(size);
+}
+
+
+OutputBuffer::OutputBuffer(std::ostream& stream, size_t size) :
+	stream(&stream),
+	size(size)
+{
+	this->buffer.reserve(size);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+}
@@ -0,0 +1,50 @@
+/*
+
+SIN Toolchain
+OutputBuffer.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the OutputBuffer class, which collects the program's output so that it may be written to the host in large pieces.
+
+The STD_OUT and STD_OUT_HEX syscalls (and BRK) write to the buffer rather than to the output stream, and the buffer is only written to the stream when it fills up. The stream is flushed when the program halts or fails, when control returns to the host (e.g., at the end of SINVM::run_for(...)), and before the program reads input, so that a prompt is always shown before the program waits for an answer.
+A buffer size of 0 writes everything through to the stream immediately, flushing it after every write.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <iostream>
+#include <cinttypes>
+
+
+namespace outputbuffer {
+	const size_t default_size = 4096;
+}
+
+
+class OutputBuffer
+{
+	std::ostream* stream;
+	std::string buffer;
+	size_t size;	// the number of characters held before they are written to the stream
+
+	void drain();	// write the buffer to the stream without flushing it
+public:
+	void put(char c) {
+		this->buffer.push_back(c);
+		if (this->buffer.size() >= this->size) {
+			this->drain();
+		}
+	}
+	void write(const char* data, size_t length);
+	void flush();	// write the buffer to the stream and flush the stream
+
+	std::ostream& get_stream();
+	void set_stream(std::ostream& stream);	// flushes anything written to the old stream first
+	void set_size(size_t size);
+
+	OutputBuffer(std::ostream& stream = std::cout, size_t size = outputbuffer::default_size);
+	~OutputBuffer();
+};
@@ -0,0 +1,48 @@
+/*
+
+SIN Toolchain
+PagePermissions.h
+Copyright 2019 Riley Lannon
+
+The constants used by the VM's page permission table.
+
+The VM's memory is divided into 256-byte pages. The ProgramImage builds a table with one entry per page from the memory map (see VMMemoryMap.h and ProgramImage::build_page_tables()); every access the program makes through get_data_from_memory or store_in_memory is then checked with a single lookup in this table rather than against the bounds of each region.
+An access that stays within one page needs no further checks; a word that runs over the end of a page must be allowed on the next page as well.
+
+The VM's page tables (this one, and the tables of where each page is read from and written to) are split into tables of 256 pages, each covering 64k of memory, so that the 32-bit VM's 16M doesn't need a full set of tables for every VM. A VM points at the ProgramImage's tables, which every VM running the image shares, and only gets its own copy of one when it changes an entry in it.
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace pagepermission
+{
+	// the size of a page, and the shift to get from an address to its page number
+	const size_t page_size = 0x100;
+	const size_t page_shift = 8;
+
+	// the number of pages in each table, and the shifts to get from a page number or an address to its table
+	const size_t table_size = 0x100;
+	const size_t table_page_shift = 8;
+	const size_t table_shift = page_shift + table_page_shift;
+
+	/*
+
+	The permission bits for each page:
+		read	-	the program may read from the page
+		write	-	the program may write to the page
+		execute	-	the page holds program code; not currently enforced when fetching, as programs may execute code they have copied elsewhere
+		privileged	-	only the VM itself may access the page (e.g., the call stack); the program may neither read nor write it
+		guarded	-	only part of the page may be accessed, so each address must be checked individually; used for the null word at $0000
+
+	*/
+
+	const uint8_t read = 1;
+	const uint8_t write = 2;
+	const uint8_t execute = 4;
+	const uint8_t privileged = 8;
+	const uint8_t guarded = 16;
+}
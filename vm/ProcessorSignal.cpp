@@ -22,6 +22,9 @@ void SINVM::send_signal(uint8_t sig) {
 
 	*/
 
+	// the signal handler (or the error message) may look at the flags, so make sure they are up to date
+	this->flags.resolve();
+
 	// set the interrupt flag
 	this->set_status_flag('I');
 
@@ -38,22 +41,16 @@ void SINVM::send_signal(uint8_t sig) {
 	// the RESET signal will always do the same thing
 	else if (sig == SINSIGRESET) {
 		/*
-		The RESET signal will essentially cause the processor to go back to its initial state without reloading any memory
-			1) clear the status register
-			2) reset the program counter (to _PRG_BOTTOM - 1, it will increment at the end of the cycle)
-			3) reset the stack pointers
-			4) clear our dynamic objects vector
+		The RESET signal will essentially cause the processor to go back to its initial state without reloading any memory (see reset_processor())
+		The PC is set to _PRG_BOTTOM - 1, as it will increment at the end of the cycle
 		*/
-		this->STATUS = 0;
+		this->reset_processor();
 		this->PC = _PRG_BOTTOM - 1;
-		this->SP = _STACK;
-		this->CALL_SP = _CALL_STACK;
-		this->dynamic_objects.clear();
 	}
 	// the rest can be trapped
 	else {
 		bool was_caught = false;
-		uint16_t vector_data = 0;
+		word_t vector_data = 0;
 		size_t vector_address = 0;
 		std::string sig_name = "";
 
@@ -79,13 +76,13 @@ void SINVM::send_signal(uint8_t sig) {
 		}
 
 		// get the data at the vector and see if we caught it (if caught, the memory at the vector will not be 0)
-		vector_data = (this->memory[vector_address] << 8) + (this->memory[vector_address + 1]);
+		vector_data = this->read_word(vector_address);
 		was_caught = vector_data != 0;
 
 		// if the signal was caught, jump to its handler
 		if (was_caught) {
 			// write the return address -- the current address - 1 -- to the call stack
-			uint16_t return_address = this->PC - 1;
+			word_t return_address = this->PC - 1;
 			this->push_call_stack(return_address);
 
 			// set the PC equal to vector_data - 1 to perform the jump
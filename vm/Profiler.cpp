@@ -0,0 +1,321 @@
+/*
+
+SIN Toolchain
+Profiler.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the Profiler class, along with the VM's profile report.
+
+*/
+
+#include "SINVM.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+
+FunctionProfile::FunctionProfile() {
+	this->calls = 0;
+	this->inclusive = 0;
+	this->exclusive = 0;
+	this->active = 0;
+}
+
+
+void Profiler::count_in_bank(location_t location) {
+	size_t bank = get_bank(location);
+	if (this->bank_counts.size() < bank) {
+		this->bank_counts.resize(bank);
+	}
+	if (this->bank_counts[bank - 1].empty()) {
+		this->bank_counts[bank - 1].resize(bank_size, 0);
+	}
+
+	this->bank_counts[bank - 1][get_address(location) - _BANK_WINDOW_START]++;
+}
+
+
+void Profiler::enter(location_t address) {
+	FunctionProfile& function = this->functions[address];	// entries in a std::map never move, so the frame may keep a pointer to it
+	function.calls++;
+	function.active++;
+
+	// find the call tree node for this path, creating it if this is the first time the path was taken
+	size_t node;
+	if (this->call_stack.empty()) {
+		node = 0;
+		this->call_tree.push_back(CallNode());
+		this->call_tree[node].parent = 0;
+		this->call_tree[node].instructions = 0;
+	}
+	else {
+		size_t parent = this->call_stack.back().node;
+		std::map<location_t, size_t>::iterator child = this->call_tree[parent].children.find(address);
+		if (child != this->call_tree[parent].children.end()) {
+			node = child->second;
+		}
+		else {
+			node = this->call_tree.size();
+			this->call_tree[parent].children[address] = node;
+			this->call_tree.push_back(CallNode());
+			this->call_tree[node].parent = parent;
+			this->call_tree[node].instructions = 0;
+		}
+	}
+	this->call_tree[node].address = address;
+
+	Frame frame;
+	frame.address = address;
+	frame.function = &function;
+	frame.entry_count = this->total;
+	frame.node = node;
+	this->call_stack.push_back(frame);
+}
+
+void Profiler::leave() {
+	// an RTS without a matching JSR (e.g., one that returns from a signal handler) must never pop the entry point
+	if (this->call_stack.size() <= 1) {
+		return;
+	}
+
+	Frame frame = this->call_stack.back();
+	this->call_stack.pop_back();
+
+	// if the function is still active further down the stack, this was a recursive call; its instructions will be counted when the outermost call returns
+	frame.function->active--;
+	if (frame.function->active == 0) {
+		frame.function->inclusive += this->total - frame.entry_count;
+	}
+}
+
+
+void Profiler::load_symbol_map(std::istream& map_file) {
+	// each line holds an address, in the form $1234, followed by the name of the symbol at that address and, if the symbol is in a bank, the bank
+	std::string line;
+	while (std::getline(map_file, line)) {
+		std::istringstream fields(line);
+		std::string address;
+		std::string name;
+		word_t bank = 0;
+
+		fields >> address >> name;
+		if (address == "") {
+			continue;
+		}
+
+		if ((address[0] != '$') || (name == "")) {
+			throw VMException("Invalid entry in symbol map: '" + line + "'");
+		}
+
+		if (!(fields >> std::dec >> bank)) {
+			bank = 0;
+		}
+
+		this->symbols[get_location(bank, (word_t)std::stoul(address.substr(1), nullptr, 16))] = name;
+	}
+}
+
+std::string Profiler::get_name(location_t location) {
+	std::stringstream name;
+	name << std::hex;
+
+	// find the last symbol at or before the location; it must be in the same bank
+	std::map<location_t, std::string>::iterator symbol = this->symbols.upper_bound(location);
+	if ((symbol == this->symbols.begin()) || (get_bank((--symbol)->first) != get_bank(location))) {
+		if (get_bank(location) != 0) {
+			name << "bank" << std::dec << get_bank(location) << std::hex << ":";
+		}
+		name << "$" << get_address(location);
+	}
+	else {
+		name << symbol->second;
+		if (symbol->first != location) {
+			name << "+$" << (location - symbol->first);
+		}
+	}
+
+	return name.str();
+}
+
+
+void Profiler::write_folded_stacks(std::ostream& output) {
+	std::map<location_t, std::string> names;	// looking up a name is relatively slow, and each function may appear in many paths
+
+	for (size_t i = 0; i < this->call_tree.size(); i++) {
+		if (this->call_tree[i].instructions == 0) {
+			continue;
+		}
+
+		// walk up to the root, then write the path from the root down
+		std::vector<location_t> path;
+		size_t node = i;
+		path.push_back(this->call_tree[node].address);
+		while (node != 0) {
+			node = this->call_tree[node].parent;
+			path.push_back(this->call_tree[node].address);
+		}
+
+		for (std::vector<location_t>::reverse_iterator it = path.rbegin(); it != path.rend(); it++) {
+			std::map<location_t, std::string>::iterator name = names.find(*it);
+			if (name == names.end()) {
+				name = names.insert(std::make_pair(*it, this->get_name(*it))).first;
+			}
+
+			if (it != path.rbegin()) {
+				output << ";";
+			}
+			output << name->second;
+		}
+		output << " " << std::dec << this->call_tree[i].instructions << std::endl;
+	}
+}
+
+
+Profiler::Profiler(location_t entry_point) :
+	address_counts(memory_size, 0)
+{
+	this->total = 0;
+	for (size_t i = 0; i < 256; i++) {
+		this->opcode_counts[i] = 0;
+	}
+
+	// count everything executed outside of a subroutine against the entry point
+	this->enter(entry_point);
+}
+
+Profiler::~Profiler()
+{
+}
+
+
+void SINVM::enable_profiling() {
+	/*
+
+	Starts profiling the program; everything executed from the current PC onwards is counted.
+	The profiled loop counts instructions one at a time, so fused instructions can't be used; if they were, the program is decoded again without them.
+
+	*/
+
+	if (this->profiler != nullptr) {
+		return;
+	}
+
+	bool used_fusion = this->uses_fusion();
+	this->profiler = new Profiler(Profiler::get_location(this->get_bank(this->PC), this->PC));
+
+	if (used_fusion) {
+		this->rebuild_caches();
+	}
+}
+
+void SINVM::load_symbol_map(std::istream& map_file) {
+	this->enable_profiling();
+	this->profiler->load_symbol_map(map_file);
+}
+
+void SINVM::write_folded_stacks(std::ostream& output) {
+	if (this->profiler != nullptr) {
+		this->profiler->write_folded_stacks(output);
+	}
+}
+
+
+void SINVM::_profile_report(std::ostream& output, size_t num_addresses) {
+	output << "Profile:" << std::endl;
+
+	if (this->profiler == nullptr) {
+		output << "\tProfiling was not enabled" << std::endl << std::endl;
+		return;
+	}
+
+	Profiler& profile = *this->profiler;
+	double total = (profile.total == 0) ? 1.0 : (double)profile.total;
+
+	output << std::dec << std::fixed << std::setprecision(2);
+	output << "\t" << profile.total << " instructions executed" << std::endl << std::endl;
+
+	// the most-executed locations, along with the instructions at them
+	std::vector<std::pair<uint64_t, Profiler::location_t>> addresses;
+	for (size_t i = 0; i < profile.address_counts.size(); i++) {
+		if (profile.address_counts[i] != 0) {
+			addresses.push_back(std::make_pair(profile.address_counts[i], Profiler::get_location(0, (word_t)i)));
+		}
+	}
+	for (size_t bank = 0; bank < profile.bank_counts.size(); bank++) {
+		for (size_t i = 0; i < profile.bank_counts[bank].size(); i++) {
+			if (profile.bank_counts[bank][i] != 0) {
+				addresses.push_back(std::make_pair(profile.bank_counts[bank][i], Profiler::get_location((word_t)(bank + 1), (word_t)(_BANK_WINDOW_START + i))));
+			}
+		}
+	}
+
+	num_addresses = std::min(num_addresses, addresses.size());
+	std::partial_sort(addresses.begin(), addresses.begin() + num_addresses, addresses.end(), [](const std::pair<uint64_t, Profiler::location_t>& a, const std::pair<uint64_t, Profiler::location_t>& b) {
+		return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+	});
+
+	output << "\tHottest instructions:" << std::endl;
+	for (size_t i = 0; i < num_addresses; i++) {
+		word_t bank = Profiler::get_bank(addresses[i].second);
+		word_t address = Profiler::get_address(addresses[i].second);
+
+		// the instruction is decoded from its own bank, which may not be the one selected now
+		DecodedInstruction instruction;
+		this->decode_in_bank(bank, address, instruction);
+
+		output << "\t\t$" << std::hex << address << std::dec << "\t" << addresses[i].first << "\t" << (100.0 * addresses[i].first / total) << "%\t" << disassemble(instruction) << "\t(" << profile.get_name(addresses[i].second) << ")" << std::endl;
+	}
+	output << std::endl;
+
+	// how often each opcode was executed
+	std::vector<std::pair<uint64_t, uint8_t>> opcodes;
+	for (size_t i = 0; i < 256; i++) {
+		if (profile.opcode_counts[i] != 0) {
+			opcodes.push_back(std::make_pair(profile.opcode_counts[i], (uint8_t)i));
+		}
+	}
+	std::sort(opcodes.begin(), opcodes.end(), [](const std::pair<uint64_t, uint8_t>& a, const std::pair<uint64_t, uint8_t>& b) {
+		return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+	});
+
+	output << "\tOpcodes:" << std::endl;
+	for (std::vector<std::pair<uint64_t, uint8_t>>::iterator it = opcodes.begin(); it != opcodes.end(); it++) {
+		std::string mnemonic;
+		try {
+			mnemonic = Assembler::get_mnemonic(it->second);
+		}
+		catch (std::exception&) {
+			std::stringstream unknown;
+			unknown << "??? ($" << std::hex << (word_t)it->second << ")";
+			mnemonic = unknown.str();
+		}
+
+		output << "\t\t" << mnemonic << "\t" << it->first << "\t" << (100.0 * it->first / total) << "%" << std::endl;
+	}
+	output << std::endl;
+
+	// the functions; calls that haven't returned yet (including the entry point's) are counted up to now
+	std::map<Profiler::location_t, FunctionProfile> functions = profile.functions;
+	for (std::vector<Profiler::Frame>::iterator it = profile.call_stack.begin(); it != profile.call_stack.end(); it++) {
+		FunctionProfile& function = functions[it->address];
+		if (function.active != 0) {
+			function.inclusive += profile.total - it->entry_count;
+			function.active = 0;	// only the outermost call is counted
+		}
+	}
+
+	std::vector<std::pair<Profiler::location_t, FunctionProfile>> sorted(functions.begin(), functions.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<Profiler::location_t, FunctionProfile>& a, const std::pair<Profiler::location_t, FunctionProfile>& b) {
+		return (a.second.inclusive > b.second.inclusive) || ((a.second.inclusive == b.second.inclusive) && (a.first < b.first));
+	});
+
+	output << "\tFunctions:" << std::endl;
+	output << "\t\tcalls\tinclusive\texclusive\tfunction" << std::endl;
+	for (std::vector<std::pair<Profiler::location_t, FunctionProfile>>::iterator it = sorted.begin(); it != sorted.end(); it++) {
+		output << "\t\t" << it->second.calls << "\t" << it->second.inclusive << " (" << (100.0 * it->second.inclusive / total) << "%)\t" << it->second.exclusive << " (" << (100.0 * it->second.exclusive / total) << "%)\t" << profile.get_name(it->first) << std::endl;
+	}
+	output << std::endl;
+
+	output << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,111 @@
+/*
+
+SIN Toolchain
+Profiler.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the Profiler class, which records where a program spends its time when the VM runs with profiling enabled (see SINVM::enable_profiling()).
+
+The profiler counts how many times each opcode, and each address, is executed. It also treats the target of every JSR as a function, keeping a shadow copy of the call stack so that it can count:
+	- inclusive instructions: those executed between the JSR and its matching RTS, including any in the functions it called
+	- exclusive instructions: those executed in the function itself
+Recursive calls only add to a function's inclusive count when the outermost call returns, so that no instruction is counted twice. Instructions executed before the first JSR are counted against the program's entry point.
+
+When profiling is enabled, the VM uses a separate dispatch loop that executes (and counts) one instruction at a time, without fusion; the regular dispatch loops are untouched, so profiling costs nothing when it is disabled.
+
+The profiler also builds a call tree -- one node for every distinct path of calls from the entry point -- counting the instructions executed in each. write_folded_stacks(...) exports it in the "folded stacks" format read by flamegraph tools: one line per path, with the names of the functions separated by semicolons, followed by the number of instructions executed in the last of them:
+	main;fact;fact;leaf 3
+
+Addresses are named using a symbol map written by the linker (see Linker::write_symbol_map(...)), if one is loaded.
+
+Code in a bank (see ProgramImage.h) runs at the same addresses as the code in every other bank, so the profiler keys everything by location instead: the bank the code is in, along with its address. Only code in the bank window is given a bank; everything else is in bank 0. Functions in different banks are therefore counted separately, even when they share an address.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <cinttypes>
+
+#include "../util/VMMemoryMap.h"	// for memory_size
+#include "WordAccess.h"
+
+
+struct FunctionProfile
+{
+	uint64_t calls;
+	uint64_t inclusive;	// instructions executed in the function and in everything it called
+	uint64_t exclusive;	// instructions executed in the function itself
+	size_t active;	// the number of calls to the function currently on the call stack
+
+	FunctionProfile();
+};
+
+
+class Profiler
+{
+	friend class SINVM;
+
+	typedef wordaccess::vm_word word_t;
+	typedef uint64_t location_t;	// a bank and an address; see get_location(...)
+
+	struct Frame {
+		location_t address;	// the location of the function
+		FunctionProfile* function;
+		uint64_t entry_count;	// the total instruction count when the function was called
+		size_t node;	// the call tree node for the path that led to this call
+	};
+
+	struct CallNode {
+		location_t address;	// the location of the function
+		size_t parent;	// the index of the caller's node; the root is its own parent
+		uint64_t instructions;	// the instructions executed in the function itself along this path
+		std::map<location_t, size_t> children;	// the nodes for the functions called along this path, indexed by location
+	};
+
+	uint64_t total;	// the number of instructions executed
+	uint64_t opcode_counts[256];
+	std::vector<uint64_t> address_counts;	// one entry for every address in memory, for the code in bank 0
+	std::vector<std::vector<uint64_t>> bank_counts;	// one entry for every address in the bank window, for each bank from 1 up; a bank's counts are allocated the first time code in it is executed
+
+	std::map<location_t, FunctionProfile> functions;	// indexed by the location of the function
+	std::vector<Frame> call_stack;	// the calls that have not yet returned; the bottom frame is the program's entry point
+	std::vector<CallNode> call_tree;	// node 0 is the entry point
+
+	std::map<location_t, std::string> symbols;	// the names of locations, from the linker's symbol map
+
+	// record one executed instruction
+	void count(location_t location, uint8_t opcode) {
+		this->total++;
+		this->opcode_counts[opcode]++;
+		if (get_bank(location) == 0) {
+			this->address_counts[get_address(location)]++;
+		}
+		else {
+			this->count_in_bank(location);
+		}
+		this->call_stack.back().function->exclusive++;
+		this->call_tree[this->call_stack.back().node].instructions++;
+	}
+	void count_in_bank(location_t location);
+
+	void enter(location_t location);	// a JSR (or a far call) to 'location' was executed
+	void leave();	// an RTS was executed
+public:
+	// the bank is kept above the address
+	static location_t get_location(word_t bank, word_t address) { return ((location_t)bank << SIN_WORDSIZE) | address; }
+	static word_t get_bank(location_t location) { return (word_t)(location >> SIN_WORDSIZE); }
+	static word_t get_address(location_t location) { return (word_t)location; }
+
+	void load_symbol_map(std::istream& map_file);
+	std::string get_name(location_t location);	// the name of the symbol at or before the location in the same bank, with an offset if necessary; the address in hex (and its bank, if it has one) if there is no symbol
+
+	void write_folded_stacks(std::ostream& output);	// write the call tree in the folded stacks format
+
+	Profiler(location_t entry_point);
+	~Profiler();
+};
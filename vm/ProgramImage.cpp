@@ -0,0 +1,188 @@
+/*
+
+SIN Toolchain
+ProgramImage.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the ProgramImage class.
+
+*/
+
+#include "ProgramImage.h"
+#include "../util/BinaryIO/BinaryIO.h"
+
+#include <cstring>
+
+
+const uint8_t ProgramImage::zero_page[pagepermission::page_size] = { 0 };
+const std::vector<const uint8_t*> ProgramImage::zero_read_table(pagepermission::table_size, ProgramImage::zero_page);
+const std::vector<uint8_t> ProgramImage::open_permission_table(pagepermission::table_size, pagepermission::read | pagepermission::write);
+uint8_t* const ProgramImage::unwritten_table[pagepermission::table_size] = { nullptr };
+
+
+void ProgramImage::check_size(size_t prg_size) {
+	// if the size of the program is greater than 0xF000 - 0x2600, it's too big
+	if (prg_size > (_PRG_TOP - _PRG_BOTTOM)) {
+		throw VMException("Program too large for conventional memory map!");
+	}
+	// the VM cannot execute an empty program
+	else if (prg_size == 0) {
+		throw VMException("Cannot execute an empty program; program size must be > 0");
+	}
+}
+
+void ProgramImage::check_banks() {
+	// the bank window must be left free for the banks
+	if ((this->num_banks != 0) && (this->prg_size > _BANK_WINDOW_START - _PRG_BOTTOM)) {
+		throw VMException("Program too large for conventional memory map; a program with banks must end before the bank window");
+	}
+}
+
+uint8_t ProgramImage::get_wordsize() const {
+	return this->wordsize;
+}
+
+size_t ProgramImage::get_size() const {
+	return this->prg_size;
+}
+
+size_t ProgramImage::get_num_banks() const {
+	return this->num_banks;
+}
+
+const uint8_t* ProgramImage::get_page(size_t page) const {
+	size_t page_start = page * pagepermission::page_size;
+
+	if ((page_start >= _PRG_BOTTOM) && (page_start < _PRG_BOTTOM + this->data.size())) {
+		return &this->data[page_start - _PRG_BOTTOM];
+	}
+	else {
+		return zero_page;
+	}
+}
+
+const uint8_t* ProgramImage::get_bank_page(size_t bank, size_t address) const {
+	return &this->banks[(bank - 1) * bank_size + ((address - _BANK_WINDOW_START) & ~(pagepermission::page_size - 1))];
+}
+
+const uint8_t* const* ProgramImage::get_read_table(size_t table) const {
+	return (table == 0) ? this->first_read_table : zero_read_table.data();
+}
+
+const uint8_t* ProgramImage::get_permission_table(size_t table) const {
+	return (table == 0) ? this->first_permission_table : open_permission_table.data();
+}
+
+uint8_t* const* ProgramImage::get_unwritten_table() {
+	return unwritten_table;
+}
+
+void ProgramImage::build_page_tables() {
+	/*
+
+	Builds the first table of each kind from the memory map; see PagePermissions.h.
+	Everything outside of the call stack may be read and written by the program; the call stack is only modified by JSR, RTS, and the VM's signal handling, so its pages are privileged. The first page holds the null word at $0000, so it is guarded.
+
+	*/
+
+	for (size_t page = 0; page < pagepermission::table_size; page++) {
+		size_t page_start = page * pagepermission::page_size;
+
+		this->first_read_table[page] = this->get_page(page);
+
+		if ((page_start >= _CALL_STACK_BOTTOM) && (page_start <= _CALL_STACK)) {
+			this->first_permission_table[page] = pagepermission::privileged;
+		}
+		else {
+			this->first_permission_table[page] = pagepermission::read | pagepermission::write;
+
+			if ((page_start >= _PRG_BOTTOM) && (page_start <= _PRG_TOP)) {
+				this->first_permission_table[page] |= pagepermission::execute;
+			}
+		}
+	}
+
+	this->first_permission_table[_MEMORY_MIN >> pagepermission::page_shift] |= pagepermission::guarded;
+}
+
+
+ProgramImage::ProgramImage(std::istream& file)
+{
+	/*
+
+	Reads the .sml file in 'file'.
+	The header is read first so that the program itself can be read in a single call, straight into the image's pages; the same goes for the banks, if there are any.
+
+	*/
+
+	this->wordsize = BinaryIO::readU8(file);
+	this->prg_size = (size_t)BinaryIO::readU32(file);
+	this->check_size(this->prg_size);
+
+	// round the program up to a whole number of pages; the padding is zeroed, just like the rest of memory
+	size_t num_pages = (this->prg_size + pagepermission::page_size - 1) / pagepermission::page_size;
+	this->data = std::vector<uint8_t>(num_pages * pagepermission::page_size, 0);
+
+	file.read((char*)this->data.data(), this->prg_size);
+	if ((size_t)file.gcount() != this->prg_size) {
+		throw VMException("Unexpected end of file; the program is shorter than its header says it is");
+	}
+
+	this->num_banks = 0;
+	if (file.peek() != std::char_traits<char>::eof()) {
+		this->num_banks = BinaryIO::readU16(file);
+		this->banks = std::vector<uint8_t>(this->num_banks * bank_size, 0);
+
+		file.read((char*)this->banks.data(), this->banks.size());
+		if ((size_t)file.gcount() != this->banks.size()) {
+			throw VMException("Unexpected end of file; there are fewer banks than the file says there are");
+		}
+	}
+	this->check_banks();
+	this->build_page_tables();
+
+	this->decoded_banks = std::vector<std::vector<DecodedInstruction>>(this->num_banks);
+}
+
+ProgramImage::ProgramImage(const uint8_t* image, size_t image_size)
+{
+	if (image_size < sml_header_size) {
+		throw VMException("Invalid program image; the image is too small to contain a header");
+	}
+
+	this->wordsize = image[0];
+	this->prg_size = (size_t)image[1] | ((size_t)image[2] << 8) | ((size_t)image[3] << 16) | ((size_t)image[4] << 24);
+	this->check_size(this->prg_size);
+
+	if (this->prg_size > image_size - sml_header_size) {
+		throw VMException("Invalid program image; the program is shorter than its header says it is");
+	}
+
+	size_t num_pages = (this->prg_size + pagepermission::page_size - 1) / pagepermission::page_size;
+	this->data = std::vector<uint8_t>(num_pages * pagepermission::page_size, 0);
+	memcpy(this->data.data(), image + sml_header_size, this->prg_size);
+
+	// anything after the program is the bank count and the banks
+	size_t banks_start = sml_header_size + this->prg_size;
+	this->num_banks = 0;
+	if (image_size > banks_start) {
+		if (image_size - banks_start < 2) {
+			throw VMException("Invalid program image; the bank count is incomplete");
+		}
+
+		this->num_banks = (size_t)image[banks_start] | ((size_t)image[banks_start + 1] << 8);
+		if (this->num_banks * bank_size > image_size - banks_start - 2) {
+			throw VMException("Invalid program image; there are fewer banks than the image says there are");
+		}
+
+		this->banks = std::vector<uint8_t>(image + banks_start + 2, image + banks_start + 2 + this->num_banks * bank_size);
+	}
+	this->check_banks();
+	this->build_page_tables();
+
+	this->decoded_banks = std::vector<std::vector<DecodedInstruction>>(this->num_banks);
+}
+
+ProgramImage::~ProgramImage()
+{
+}
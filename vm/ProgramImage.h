@@ -0,0 +1,82 @@
+/*
+
+SIN Toolchain
+ProgramImage.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the ProgramImage class, which holds a loaded .sml program so that any number of VMs may share it.
+
+The VM's memory is a table of 256-byte pages (see SINVM::read_pages). When a VM is created, every page in the program range -- the code along with the @db data the linker placed after it -- points into the ProgramImage, and every other page points to a single page of zeroes shared by all VMs. A VM only gets its own copy of a page the first time it writes to it, so VMs running the same image only hold the pages they have actually modified.
+The page tables themselves are shared in the same way (see PagePermissions.h). The image holds the table of where each page is read from and the table of permissions, as they are when a VM is created; a VM only gets its own copy of a table when it changes an entry in it.
+
+A program too large for conventional memory may also have banks (see Linker::place_object_files()). A bank is 4k of the program that is kept outside of the VM's memory; the program selects which bank is shown in the bank window (_BANK_WINDOW_START to _BANK_WINDOW_END) with the SYS_BANKSELECT syscall, and calls functions in other banks through trampolines that use SYS_FARCALL and SYS_FARRETURN. Banks are numbered from 1; bank 0 is the conventional memory behind the window, which is what the window shows when the program starts. The window's pages point straight at the selected bank, and may not be written to while a bank is selected.
+In a .sml file, the banks follow the program: the number of banks (2 bytes, little-endian), and then the contents of each bank. A file without banks ends after the program.
+
+A ProgramImage is never modified once it has been loaded; VMs share it through a std::shared_ptr, so it lives as long as the last VM using it.
+The one exception is the decoded program. The VMs running an image share its decode cache the same way they share its pages: the first VM to need the program (or a bank) decoded does it for all of them, and a VM only keeps its own copy of a page of decoded instructions once the program writes over code in it. See DecodeCache.cpp.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <istream>
+#include <mutex>
+#include <cinttypes>
+#include <cstddef>
+
+#include "../util/VMMemoryMap.h"
+#include "../util/Exceptions.h"
+#include "PagePermissions.h"
+#include "DecodedInstruction.h"
+
+
+class ProgramImage
+{
+	uint8_t wordsize;	// the wordsize the program was assembled for
+	size_t prg_size;	// the size of the program, in bytes
+	std::vector<uint8_t> data;	// the program, padded with zeroes to a whole number of pages; begins at _PRG_BOTTOM
+	size_t num_banks;
+	std::vector<uint8_t> banks;	// the contents of every bank, one after another
+
+	static const uint8_t zero_page[pagepermission::page_size];	// the contents of every page outside of the program
+
+	// the page tables each VM starts with. Everything the memory map sets apart is in the first 64k, so only the first table depends on the image; the tables for the rest of the 32-bit VM's memory are the same for every image
+	const uint8_t* first_read_table[pagepermission::table_size];
+	uint8_t first_permission_table[pagepermission::table_size];
+	static const std::vector<const uint8_t*> zero_read_table;
+	static const std::vector<uint8_t> open_permission_table;
+	static uint8_t* const unwritten_table[pagepermission::table_size];
+	void build_page_tables();
+
+	// the decoded program, without fusion and with it, and the decoded code in each bank; filled in by the first VM to ask for them, and never changed after that. See SINVM::get_decoded_program()
+	friend class SINVM;
+	mutable std::mutex decode_mutex;
+	mutable std::vector<DecodedInstruction> decoded_program[2];
+	mutable std::vector<std::vector<DecodedInstruction>> decoded_banks;
+
+	void check_size(size_t prg_size);	// throws if the program can't fit in the memory map
+	void check_banks();	// throws if the program would overlap the bank window
+public:
+	// a .sml file begins with the wordsize (1 byte) and the program size (4 bytes, little-endian)
+	static const size_t sml_header_size = 5;
+
+	uint8_t get_wordsize() const;
+	size_t get_size() const;
+	size_t get_num_banks() const;
+
+	// get the initial contents of a page of memory
+	const uint8_t* get_page(size_t page) const;
+
+	// get the contents of the page at 'address' while 'bank' (from 1 to get_num_banks()) is selected; 'address' must be within the bank window
+	const uint8_t* get_bank_page(size_t bank, size_t address) const;
+
+	// get the initial page tables for the 256 pages starting at page number 'table' << pagepermission::table_page_shift
+	const uint8_t* const* get_read_table(size_t table) const;
+	const uint8_t* get_permission_table(size_t table) const;
+	static uint8_t* const* get_unwritten_table();	// a table of nullptrs, for a VM that hasn't written to any of the table's pages
+
+	ProgramImage(std::istream& file);	// read a .sml file
+	ProgramImage(const uint8_t* image, size_t image_size);	// use a .sml file that has already been read into memory
+	~ProgramImage();
+};
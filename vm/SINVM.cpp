@@ -10,6 +10,9 @@ Contains the implementation of various functions related to the VM.
 
 
 #include "SINVM.h"
+#include "../util/SyscallConstants.h"
+
+#include <algorithm>
 
 
 const bool SINVM::address_is_valid(size_t address, bool privileged) {
@@ -36,15 +39,7 @@ const bool SINVM::address_is_valid(size_t address, bool privileged) {
 	}
 }
 
-std::vector<uint8_t> SINVM::get_properly_ordered_bytes(uint16_t value) {
-	std::vector<uint8_t> ordered_bytes;
-	for (uint8_t i = (this->_WORDSIZE / 8); i > 0; i--) {
-		ordered_bytes.push_back(value >> ((i - 1) * 8));
-	}
-	return ordered_bytes;
-}
-
-void SINVM::execute_bitshift(uint16_t opcode)
+void SINVM::execute_bitshift(const DecodedInstruction& instruction)
 {
 
 	// TODO: correct for wordsize -- currently, highest bit is always 7; should be highest bit in the wordsize
@@ -52,18 +47,17 @@ void SINVM::execute_bitshift(uint16_t opcode)
 	// LOGICAL SHIFTS: 0 always shifted in; bit shifted out goes into carry
 	// ROTATIONS: carry bit shifted in; bit shifted out goes into carry
 
+	uint8_t opcode = instruction.opcode;
+
 	// check our addressing mode
-	this->PC++;
-	uint8_t addressing_mode = this->memory[this->PC];
+	uint8_t addressing_mode = instruction.addressing_mode;
 
 	if (addressing_mode != addressingmode::reg_a) {
-		uint16_t value_at_address;
+		word_t value_at_address;
 		uint8_t high_byte_address;
 		bool carry_set_before_bitshift = false;
 
-		// increment PC so we can use get_data_of_wordsize()
-		this->PC++;
-		uint16_t address = this->get_data_of_wordsize();
+		word_t address = instruction.operand;
 
 		// if we have absolute addressing
 		if (addressing_mode == addressingmode::absolute) {
@@ -226,42 +220,24 @@ void SINVM::execute_bitshift(uint16_t opcode)
 }
 
 
-void SINVM::execute_comparison(uint16_t reg_to_compare) {
+void SINVM::execute_comparison(word_t reg_to_compare, const DecodedInstruction& instruction) {
 	// fetch the data for the comparison
-	uint16_t to_compare = this->execute_load();
-
-	// if the values are equal, set the Z flag; if they are not, clear it
-	if (reg_to_compare == to_compare) {
-		this->set_status_flag('Z');
-	}
-	else {
-		this->clear_status_flag('Z');
-		// we may need to set other flags too
-		if (reg_to_compare < to_compare) {
-			// set the carry flag if greater than, clear if less than
-			this->clear_status_flag('C');
-		}
-		else {	// if it's not equal, and it's not less, it's greater
-			this->set_status_flag('C');
-		}
-	}
-	return;
+	word_t to_compare = this->execute_load(instruction);
+	this->compare_values(reg_to_compare, to_compare);
 }
 
 
-void SINVM::execute_jmp() {
+void SINVM::execute_jmp(const DecodedInstruction& instruction) {
 	/*
 
-	Execute a JMP instruction. The VM first increments the PC to get the addressing mode, then increments it again to get the memory address
+	Execute a JMP instruction. The addressing mode and memory address come from the decoded instruction; the PC points to the last byte of the instruction when this is called
 
 	*/
 
-	this->PC++;
-	uint8_t addressing_mode = this->memory[this->PC];
+	uint8_t addressing_mode = instruction.addressing_mode;
 
 	// get the memory address to which we want to jump
-	this->PC++;
-	uint16_t memory_address = this->get_data_of_wordsize();
+	word_t memory_address = instruction.operand;
 
 	// check our addressing mode to see how we need to handle the data we just received
 	if (addressing_mode == addressingmode::absolute) {
@@ -315,7 +291,7 @@ void SINVM::execute_jmp() {
 	}
 	// invalid addressing modes will generate a SINSIGILL signal
 	else {
-		this->PC -= 3;	// we already read the data; back up 3 bytes
+		this->PC -= (this->_WORDSIZE / 8) + 1;	// we already read the data; back up to the opcode
 		this->send_signal(SINSIGILL);	// illegal to use the supplied addressing mode with the current instruction
 	}
 
@@ -324,128 +300,268 @@ void SINVM::execute_jmp() {
 
 
 // STATUS register operations
-void SINVM::set_status_flag(char flag) {
-	// sets the flag equal to 'flag' in the status register
+void SINVM::invalid_flag(char flag) {
+	throw std::runtime_error("Invalid STATUS flag selection: '" + std::string(1, flag) + "'");
+}
 
-	if (flag == 'N') {
-		this->STATUS |= StatusConstants::negative;
-	}
-	else if (flag == 'V') {
-		this->STATUS |= StatusConstants::overflow;
-	}
-	else if (flag == 'U') {
-		this->STATUS |= StatusConstants::undefined;
-	}
-	else if (flag == 'H') {
-		this->STATUS |= StatusConstants::halt;
-	}
-	else if (flag == 'I') {
-		this->STATUS |= StatusConstants::interrupt;
-	}
-	else if (flag == 'F') {
-		this->STATUS |= StatusConstants::floating_point;
-	}
-	else if (flag == 'Z') {
-		this->STATUS |= StatusConstants::zero;
-	}
-	else if (flag == 'C') {
-		this->STATUS |= StatusConstants::carry;
-	}
-	else {
-		throw std::runtime_error("Invalid STATUS flag selection");	// throw an exception if we call the function with an invalid flag
+uint8_t SINVM::get_processor_status() {
+	this->flags.resolve();
+	return this->STATUS;
+}
+
+
+void SINVM::run_instrumented_dispatch(int64_t& budget) {
+	/*
+
+	Executes the program one instruction at a time, calling each instruction's handler, and records every instruction for the profiler and the trace, if they are enabled.
+	JSR and RTS are only followed if they actually moved the call stack pointer; if they generated a signal instead, the call never happened.
+
+	*/
+
+	while (!(this->is_halted()) && (budget > 0)) {
+		const DecodedInstruction& instruction = this->fetch_instruction();
+		uint8_t opcode = instruction.opcode;
+		word_t call_sp = this->CALL_SP;
+
+		if (this->trace != nullptr) {
+			TraceRecord& record = this->trace->next();
+			record.PC = this->PC;
+			record.operand = instruction.operand;
+			record.REG_A = this->REG_A;
+			record.REG_B = this->REG_B;
+			record.REG_X = this->REG_X;
+			record.REG_Y = this->REG_Y;
+			record.SP = this->SP;
+			record.STATUS = this->STATUS;
+			record.flags = this->flags.get_pending();
+			record.opcode = opcode;
+			record.addressing_mode = instruction.addressing_mode;
+			record.length = instruction.length;
+		}
+
+		if (this->profiler != nullptr) {
+			this->profiler->count(Profiler::get_location(this->get_bank(this->PC), this->PC), opcode);
+		}
+
+		this->cycles += instruction.cycles;
+
+		this->PC += instruction.length - 1;
+		instruction.handler(*this, instruction);
+		this->PC++;
+		budget--;
+
+		if ((this->profiler != nullptr) && (this->CALL_SP != call_sp)) {
+			// a far call is counted as a call to the function in the bank, which has been selected by now; see far_call()
+			if ((opcode == JSR) || ((opcode == SYSCALL) && (instruction.operand == SYS_FARCALL) && (this->CALL_SP < call_sp))) {
+				this->profiler->enter(Profiler::get_location(this->get_bank(this->PC), this->PC));
+			}
+			else if (opcode == RTS) {
+				this->profiler->leave();
+			}
+		}
 	}
 
 	return;
 }
 
-void SINVM::clear_status_flag(char flag) {
-	// sets the flag equal to 'flag' in the status register
 
-	if (flag == 'N') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::negative);
-	}
-	else if (flag == 'V') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::overflow);
+bool SINVM::uses_fusion() {
+	// the switch and instrumented loops execute one instruction at a time; so does the threaded loop, without direct threading, as it is the switch loop
+	if ((this->profiler != nullptr) || (this->trace != nullptr) || (this->dispatch_mode == SWITCH_DISPATCH)) {
+		return false;
 	}
-	else if (flag == 'U') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::undefined);
-	}
-	else if (flag == 'H') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::halt);
+
+#if defined(SIN_DIRECT_THREADING)
+	return true;
+#else
+	return this->dispatch_mode != THREADED_DISPATCH;
+#endif
+}
+
+
+void SINVM::dispatch(int64_t& budget) {
+	if ((this->profiler != nullptr) || (this->trace != nullptr)) {
+		this->run_instrumented_dispatch(budget);
 	}
-	else if (flag == 'I') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::interrupt);
+	else if (this->dispatch_mode == THREADED_DISPATCH) {
+		this->run_threaded_dispatch(budget);
 	}
-	else if (flag == 'F') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::floating_point);
+	else if (this->dispatch_mode == BLOCK_DISPATCH) {
+		this->run_block_dispatch(budget);
 	}
-	else if (flag == 'Z') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::zero);
+	else {
+		this->run_switch_dispatch(budget);
 	}
-	else if (flag == 'C') {
-		this->STATUS = this->STATUS & (255 - StatusConstants::carry);
+}
+
+
+void SINVM::run_program() {
+	// run until the program halts; an unhandled signal will throw an exception
+	int64_t budget = INT64_MAX;
+	try {
+		while (!(this->is_halted())) {
+			this->dispatch(budget);
+			budget = INT64_MAX;
+		}
 	}
-	else {
-		throw std::runtime_error("Invalid STATUS flag selection");	// throw an exception if we call the function with an invalid flag
+	catch (std::exception&) {
+		this->output.flush();
+		this->write_trace();
+		throw;
 	}
 
+	this->output.flush();
+
 	return;
 }
 
-uint8_t SINVM::get_processor_status() {
-	return this->STATUS;
-}
 
-bool SINVM::is_flag_set(char flag) {
-	// TODO: add new flags
+RunStatus SINVM::run_for(uint64_t num_instructions) {
+	/*
+
+	Executes up to 'num_instructions' instructions and reports why it stopped.
+	Unlike run_program(), unhandled signals don't throw; the VM is marked as trapped, and every later call returns RUN_TRAPPED.
+
+	*/
 
-	// return the status of a single flag in the status register
-	// do this by performing an AND operation on that bit; if set, we will get true (the only bit that can be set is the bit in question)
-	if (flag == 'N') {
-		return this->STATUS & StatusConstants::negative; // will only return true if N is set; if any other bit is set, it will be AND'd against a 0
+	if (this->trapped) {
+		return RUN_TRAPPED;
 	}
-	else if (flag == 'V') {
-		return this->STATUS & StatusConstants::overflow;
+
+	int64_t budget = (num_instructions < (uint64_t)INT64_MAX) ? (int64_t)num_instructions : INT64_MAX;
+
+	try {
+		this->dispatch(budget);
 	}
-	else if (flag == 'U') {
-		return this->STATUS & StatusConstants::undefined;
+	catch (std::exception& e) {
+		this->output.flush();
+		this->trapped = true;
+		this->trap_message = e.what();
+		this->write_trace();
+		return RUN_TRAPPED;
 	}
-	else if (flag == 'H') {
-		return this->STATUS & StatusConstants::halt;
+
+	// the host may want to see the output before it runs the program again
+	this->output.flush();
+
+	return this->is_halted() ? RUN_HALTED : RUN_BUDGET_EXHAUSTED;
+}
+
+
+RunStatus SINVM::run_until(std::chrono::steady_clock::time_point deadline) {
+	/*
+
+	Executes instructions until the program stops or the deadline passes.
+	Checking the clock after every instruction would be far too slow, so the program is run in slices, checking the clock between them; the VM may therefore run up to one slice past the deadline.
+
+	*/
+
+	const uint64_t slice = 10000;
+
+	RunStatus status = RUN_BUDGET_EXHAUSTED;
+	while ((status == RUN_BUDGET_EXHAUSTED) && (std::chrono::steady_clock::now() < deadline)) {
+		status = this->run_for(slice);
 	}
-	else if (flag == 'I') {
-		return this->STATUS & StatusConstants::interrupt;
+
+	return status;
+}
+
+
+std::string SINVM::get_trap_message() {
+	return this->trap_message;
+}
+
+uint64_t SINVM::get_cycle_count() {
+	return this->cycles;
+}
+
+
+void SINVM::set_dispatch_mode(DispatchMode mode) {
+	// fusion is only used outside of the switch loop, so if we are switching to or from it, the program must be decoded again
+	bool used_fusion = this->uses_fusion();
+
+	this->dispatch_mode = mode;
+
+	if (this->uses_fusion() != used_fusion) {
+		this->rebuild_caches();
 	}
-	else if (flag == 'F') {
-		return this->STATUS & StatusConstants::floating_point;
+}
+
+void SINVM::set_file_root(std::string root) {
+	/*
+
+	Allows the program to open files, with the names it gives taken relative to the host directory 'root'. Names that are absolute or that would leave 'root' are refused (see get_file_path()); no other files may be opened.
+	Without a root, which is how every VM starts, the program has no access to the host's files.
+
+	*/
+
+	this->file_root = root;
+}
+
+void SINVM::enable_heap_compaction() {
+	/*
+
+	Allows the VM to compact the heap when it is too fragmented for an allocation.
+	Compaction moves objects, so it is only safe for a program that reaches them through handles, which it asks for with the MEMHANDLES syscall; a program that doesn't is stopped the first time it uses the heap (see check_heap_mode()). Objects allocated before this is called can't be moved, so this must be called before the program runs.
+
+	*/
+
+	this->compacting_heap = true;
+}
+
+void SINVM::enable_tracing(std::string file_name, size_t num_records) {
+	/*
+
+	Starts recording the instructions the program executes in a ring buffer, which is written to 'file_name' if the program fails.
+	Like the profiler, the trace needs a record for every instruction, so the program is decoded again without fusion if necessary.
+
+	*/
+
+	bool used_fusion = this->uses_fusion();
+
+	delete this->trace;
+	this->trace = new ExecutionTrace(num_records);
+	this->trace_file_name = file_name;
+
+	if (used_fusion) {
+		this->rebuild_caches();
 	}
-	else if (flag == 'Z') {
-		return this->STATUS & StatusConstants::zero;
+}
+
+void SINVM::write_trace() {
+	if (this->trace == nullptr) {
+		return;
 	}
-	else if (flag == 'C') {
-		return this->STATUS & StatusConstants::carry;
+
+	std::ofstream trace_file(this->trace_file_name, std::ios::out | std::ios::binary);
+	if (trace_file.is_open()) {
+		this->trace->write(trace_file);
 	}
 	else {
-		throw std::runtime_error("Invalid STATUS flag selection");	// throw an exception if we call the function with an invalid flag
+		std::cerr << "**** Could not write the execution trace to '" << this->trace_file_name << "'" << std::endl;
 	}
 }
 
+void SINVM::rebuild_caches() {
+	this->block_cache.clear();
+	this->block_coverage.clear();
+	this->build_decode_cache();
+}
 
-void SINVM::run_program() {
-	// as long as the HALT flag is not set
-	while (!(this->is_flag_set('H'))) {
-		// execute the instruction pointed to by the program counter
-		this->execute_instruction(this->memory[this->PC]);
 
-		// advance the program counter to point to the next instruction
-		this->PC++;
-	}
+void SINVM::set_io(std::istream& input, std::ostream& output) {
+	this->input = &input;
+	this->output.set_stream(output);
+}
 
-	return;
+void SINVM::set_output_buffer_size(size_t size) {
+	this->output.set_size(size);
 }
 
 
 void SINVM::_debug_values() {
+	this->flags.resolve();
+
 	std::cout << "SINVM Values:" << std::endl;
 	std::cout << "\t" << "Registers:" << "\n\t\tA: $" << std::hex << this->REG_A << std::endl;
 	std::cout << "\t\tB: $" << std::hex << this->REG_B << std::endl;
@@ -457,93 +573,234 @@ void SINVM::_debug_values() {
 	std::cout << "Memory: " << std::endl;
 	for (size_t i = 0; i < 0xFF; i++) {
 		// display the first two pages of memory
-		std::cout << "\t$000" << i << ": $" << std::hex << (uint16_t)this->memory[i] << "\t\t$0" << 0x100 + i << ": $" << (uint16_t)this->memory[256 + i] << std::endl;
+		std::cout << "\t$000" << i << ": $" << std::hex << (uint16_t)this->read_byte(i) << "\t\t$0" << 0x100 + i << ": $" << (uint16_t)this->read_byte(256 + i) << std::endl;
 	}
 
 	std::cout << "\nStack: " << std::endl;
 	for (size_t i = 0xff; i > 0x00; i--) {
 		// display the top page of the stack
 		if (i > 0x0f) {
-			std::cout << "\t$23" << i << ": $" << std::hex << (int)this->memory[0x2300 + i] << std::endl;
+			std::cout << "\t$23" << i << ": $" << std::hex << (int)this->read_byte(0x2300 + i) << std::endl;
 		}
 		else {
-			std::cout << "\t$230" << i << ": $" << std::hex << (int)this->memory[0x2300 + i] << std::endl;
+			std::cout << "\t$230" << i << ": $" << std::hex << (int)this->read_byte(0x2300 + i) << std::endl;
 		}
 	}
 
 	std::cout << std::endl;
 }
 
+void SINVM::_heap_report() {
+	HeapStatistics statistics = this->heap.get_statistics();
+
+	std::cout << std::dec << "Heap:" << std::endl;
+	std::cout << "\tHandles: " << (this->using_heap_handles ? "yes" : "no") << std::endl;
+	std::cout << "\tCompaction: " << (this->compacting_heap ? "enabled" : "disabled") << std::endl;
+	std::cout << "\tObjects: " << statistics.num_objects << " (" << statistics.used_bytes << " bytes)" << std::endl;
+	std::cout << "\tFree: " << statistics.free_bytes << " bytes in " << statistics.num_free_blocks << " blocks; the largest is " << statistics.largest_free_block << " bytes" << std::endl;
+	std::cout << "\tFragmentation: " << statistics.get_fragmentation() * 100.0 << "%" << std::endl;
+	std::cout << "\tAllocations: " << statistics.allocations << " (" << statistics.failed_allocations << " failed)" << std::endl;
+	std::cout << "\tCompactions: " << statistics.compactions << " (" << statistics.bytes_moved << " bytes moved)" << std::endl;
+	std::cout << std::endl;
+}
 
 
-SINVM::SINVM(std::istream& file)
-{
-	// TODO: redo the SINVM constructor...
 
-	// initialize our ALU and FPU
-	this->alu = ALU(&this->REG_A, &this->REG_B, &this->STATUS);
-	this->fpu = FPU(&this->REG_A, &this->REG_B, &this->STATUS);
+void SINVM::share_page_tables() {
+	/*
 
-	// initialize some memory addresses
-	for (size_t i = 0; i < 8; i++) {
-		this->memory[_SIG_VECTOR + i] = 0;	// initialize all signal vector data to 0 to start
-	}
+	Points each of the VM's page tables at the image's; see PagePermissions.h.
+	The VM hasn't written to any page yet, so every table of copies points at a table of nullptrs that is never written to. set_write_page(...) replaces it with the VM's own the first time the VM copies a page.
+	The first table is the exception; the VM keeps its own copy of it from the start.
 
-	// get the wordsize, make sure it is compatible with this VM
-	uint8_t file_wordsize = BinaryIO::readU8(file);
-	if (file_wordsize != _WORDSIZE) {
-		throw VMException("Incompatible word sizes; the VM uses a " + std::to_string(_WORDSIZE) + "-bit wordsize; file to execute uses a " + std::to_string(file_wordsize) + "-bit word.");
-	}
+	*/
+
+	for (size_t table = 0; table < num_page_tables; table++) {
+		this->read_pages[table] = this->program->get_read_table(table);
+		this->write_pages[table] = ProgramImage::get_unwritten_table();
+		this->page_permissions[table] = this->program->get_permission_table(table);
+		this->own_read_tables[table] = nullptr;
+		this->own_write_tables[table] = nullptr;
+		this->own_permission_tables[table] = nullptr;
+	}
+
+	std::copy(this->read_pages[0], this->read_pages[0] + pagepermission::table_size, this->first_read_pages);
+	std::fill(this->first_write_pages, this->first_write_pages + pagepermission::table_size, nullptr);
+	std::copy(this->page_permissions[0], this->page_permissions[0] + pagepermission::table_size, this->first_page_permissions);
+	this->read_pages[0] = this->own_read_tables[0] = this->first_read_pages;
+	this->write_pages[0] = this->own_write_tables[0] = this->first_write_pages;
+	this->page_permissions[0] = this->own_permission_tables[0] = this->first_page_permissions;
+}
 
-	size_t prg_size = (size_t)BinaryIO::readU32(file);
-	std::vector<uint8_t> prg_data;
 
-	for (size_t i = 0; i < prg_size; i++) {
-		uint8_t next_byte = BinaryIO::readU8(file);
-		prg_data.push_back(next_byte);
+void SINVM::initialize(std::shared_ptr<const ProgramImage> program) {
+	/*
+
+	Sets up the VM to run 'program'; used by every constructor.
+	Every page starts out shared, so memory outside of the program starts out cleared.
+
+	*/
+
+	// make sure the wordsize is compatible with this VM
+	if (program->get_wordsize() != _WORDSIZE) {
+		throw VMException("Incompatible word sizes; the VM uses a " + std::to_string(_WORDSIZE) + "-bit wordsize; file to execute uses a " + std::to_string(program->get_wordsize()) + "-bit word.");
 	}
 
-	// if the size of the program is greater than 0xF000 - 0x2600, it's too big
-	if (prg_data.size() > (_PRG_TOP - _PRG_BOTTOM)) {
-		throw VMException("Program too large for conventional memory map!");
+	this->program = program;
+
+	// every page, and every page table, starts out shared with the image
+	this->share_page_tables();
 
-		// TODO: remap memory if the program is too large instead of exiting?
+	// initialize our lazy flags, ALU, and FPU
+	this->flags = LazyFlags(&this->STATUS);
+	this->alu = ALU(&this->REG_A, &this->REG_B, &this->STATUS, &this->flags);
+	this->fpu = FPU(&this->REG_A, &this->REG_B, &this->STATUS, &this->flags);
 
+	// use the switch dispatch loop and the host's standard streams unless we are told otherwise
+	this->dispatch_mode = SWITCH_DISPATCH;
+	this->profiler = nullptr;
+	this->trace = nullptr;
+	this->compacting_heap = false;
+	for (size_t i = 0; i < fileio::max_files; i++) {
+		this->files[i] = nullptr;
 	}
+	this->mapped_descriptor = 0;
+	this->file_root = "";
+	this->selected_bank = 0;
+	this->bank_decode_caches = std::vector<const DecodedInstruction*>(this->program->get_num_banks(), nullptr);
+	this->input = &std::cin;
+	this->output.set_stream(std::cout);
 
-	// copy the program data into memory
-	std::vector<uint8_t>::iterator instruction_iter = prg_data.begin();
-	size_t memory_index = _PRG_BOTTOM;
-	while ((instruction_iter != prg_data.end())) {
-		this->memory[memory_index] = *instruction_iter;
-		memory_index++;
-		instruction_iter++;
+	// decode the program now so that we don't have to do it as we execute; if another VM has already run the program, it has done so for us
+	this->decode_cache_size = this->program->get_size();
+	for (size_t page = 0; page < decode_cache_pages; page++) {
+		this->own_decode_pages[page] = nullptr;
 	}
+	this->build_decode_cache();
 
-	// initialize our list of dynamic objects as an empty list
-	this->dynamic_objects = {};
+	this->REG_A = 0;
+	this->REG_B = 0;
+	this->REG_X = 0;
+	this->REG_Y = 0;
+	this->reset_processor();
 
-	// initialize the stack to location to our stack's upper limit; it grows downwards
-	this->SP = _STACK;
-	this->CALL_SP = _CALL_STACK;
+	this->trapped = false;
+	this->trap_message = "";
+	this->cycles = 0;
+}
+
+void SINVM::reset_processor() {
+	/*
+
+	Returns the processor to its initial state without touching memory (other than the bank window) or the general-purpose registers:
+		1) clear the status register
+		2) reset the program counter to the start of the program
+		3) reset the stack pointers
+		4) free everything on the heap
+		5) show conventional memory in the bank window again; the banks saved by far calls were on the call stack
 
-	// always initialize our status register so that all flags are not set
+	*/
+
+	this->flags.discard();
 	this->STATUS = 0;
 
-	// Set the word at 0x00 to 0 so that null pointers will not ever be valid
-	this->memory[0] = 0;
-	this->memory[1] = 0;
+	this->PC = _PRG_BOTTOM;
+	this->SP = _STACK;
+	this->CALL_SP = _CALL_STACK;
+	this->select_bank(0);
 
-	// initialize the program counter to start at the top of the program
-	if (prg_data.size() != 0) {
-		this->PC = _PRG_BOTTOM;	// make sure that we don't read memory that doesn't exist if our program is empty
+	this->heap.clear();
+	this->using_heap_handles = false;	// the program must ask for them again
+	this->heap_handles.clear();
+	this->free_handles.clear();
+	for (size_t handle = _POINTER_TABLE_TOP + 1 - sizeof(word_t); handle >= _HANDLE_TABLE_BOTTOM; handle -= sizeof(word_t)) {
+		this->free_handles.push_back((word_t)handle);
 	}
-	else {
-		// throw an exception; the VM cannot execute an empty program
-		throw VMException("Cannot execute an empty program; program size must be > 0");
+}
+
+void SINVM::reset() {
+	/*
+
+	Returns the VM to the state it was in right after it was loaded, so that it may run the program again.
+
+	Only the pages the program has written to need to be restored, and written_pages lists them; the VM's copies are released, and the pages are shared again. The cost therefore depends on how much memory the program touched rather than on the size of memory. The decode cache goes back to the shared decoded program in the same way; only the cached blocks in a restored page need to be invalidated, as the program may have written over them.
+
+	*/
+
+	// close the program's files, which also puts the file window's pages back
+	this->close_files();
+
+	size_t prg_end = _PRG_BOTTOM + this->program->get_size();
+
+	for (std::vector<size_t>::iterator it = this->written_pages.begin(); it != this->written_pages.end(); it++) {
+		size_t page = *it;
+
+		this->free_pages.push_back(this->get_write_page(page));
+		this->set_write_page(page, nullptr);
+		this->set_read_page(page, this->program->get_page(page));
+
+		size_t page_start = page * pagepermission::page_size;
+		if ((page_start + pagepermission::page_size > _PRG_BOTTOM) && (page_start < prg_end) && !this->block_cache.empty()) {
+			this->invalidate_block_cache(page_start, pagepermission::page_size);
+		}
 	}
+	this->written_pages.clear();
+
+	// the shared decoded program matches memory again
+	this->release_decode_pages();
+
+	this->REG_A = 0;
+	this->REG_B = 0;
+	this->REG_X = 0;
+	this->REG_Y = 0;
+	this->reset_processor();
+
+	this->trapped = false;
+	this->trap_message = "";
+	this->cycles = 0;
+}
+
+SINVM::SINVM(std::istream& file)
+{
+	this->initialize(std::make_shared<const ProgramImage>(file));
+}
+
+SINVM::SINVM(const uint8_t* image, size_t image_size)
+{
+	this->initialize(std::make_shared<const ProgramImage>(image, image_size));
+}
+
+SINVM::SINVM(std::shared_ptr<const ProgramImage> program)
+{
+	this->initialize(program);
 }
 
 SINVM::~SINVM()
 {
+	delete this->profiler;
+	delete this->trace;
+	this->close_files();
+
+	// free our copies of any pages
+	for (std::vector<size_t>::iterator it = this->written_pages.begin(); it != this->written_pages.end(); it++) {
+		delete[] this->get_write_page(*it);
+	}
+	for (std::vector<uint8_t*>::iterator it = this->free_pages.begin(); it != this->free_pages.end(); it++) {
+		delete[] *it;
+	}
+
+	// and of any page tables; the first is part of the VM
+	for (size_t table = 1; table < num_page_tables; table++) {
+		delete[] this->own_read_tables[table];
+		delete[] this->own_write_tables[table];
+		delete[] this->own_permission_tables[table];
+	}
+
+	// and of any pages of the decode cache
+	for (size_t page = 0; page < decode_cache_pages; page++) {
+		delete[] this->own_decode_pages[page];
+	}
+	for (std::vector<DecodedInstruction*>::iterator it = this->free_decode_pages.begin(); it != this->free_decode_pages.end(); it++) {
+		delete[] *it;
+	}
 }
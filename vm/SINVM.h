@@ -13,51 +13,203 @@ It still requires explicit host interaction through the SYSCALL instruction for
 
 #include <vector>
 #include <list>
+#include <map>
 #include <tuple>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <chrono>
+#include <exception>
 
 #include "../assemble/Assembler.h"
 #include "../util/SinObjectFile.h"	// to load a .SINC file
 #include "../util/VMMemoryMap.h"	// contains the constants that define where various blocks of memory begin and end in the VM
-#include "DynamicObject.h"	// for use in allocating objects on the heap
+#include "HeapAllocator.h"	// for use in allocating objects on the heap
+#include "DecodedInstruction.h"	// for the decode cache
+#include "DecodedBlock.h"	// for the block cache
+#include "BlockCompiler.h"	// for compiling the blocks
+#include "Fusion.h"	// for superinstruction fusion
+#include "PagePermissions.h"	// for the page permission table
+#include "WordAccess.h"	// for reading and writing whole words
+#include "ProgramImage.h"	// for the shared program image
+#include "Profiler.h"	// for the execution profiler
+#include "ExecutionTrace.h"	// for the execution trace
+#include "CycleCosts.h"	// for the cycle counter
+#include "OutputBuffer.h"	// for buffered output
+#include "FileIO.h"	// for the file I/O syscalls
+#include "VectorUnit.h"	// for the vector instructions
 #include "../util/Exceptions.h"	// for VMException
 #include "StatusConstants.h"
+#include "LazyFlags.h"
+#include "Inline.h"	// for SIN_FORCE_INLINE
 #include "ALU.h"
 #include "FPU.h"
 #include "../util/Signals.h"
 
 
+#if defined(SIN_DIRECT_THREADING)
+namespace threadedslot {
+	// the columns of the threaded dispatch loop's table of targets; an instruction that takes an operand from memory has a target for each of the common addressing modes, and the rest use 'generic'
+	const uint8_t generic = 0;
+	const uint8_t immediate = 1;
+	const uint8_t absolute = 2;
+	const uint8_t x_index = 3;
+	const uint8_t y_index = 4;
+	const uint8_t reg_b = 5;
+	const uint8_t num_slots = 6;
+
+	// the rows are indexed by opcode, plus one more for instructions that are executed by calling their handlers
+	const size_t call_handler = 256;
+	const size_t num_rows = 257;
+}
+#endif
+
+enum DispatchMode {
+	/*
+
+	How the VM gets from a decoded instruction to the code that executes it:
+		SWITCH_DISPATCH	-	the dispatch loop switches on the opcode
+		THREADED_DISPATCH	-	the code for each instruction jumps directly to the code for the next, using the address stored in the decoded instruction (GCC and Clang only; elsewhere, this is the same as SWITCH_DISPATCH)
+		BLOCK_DISPATCH	-	the VM caches the program as decoded blocks (straight-line runs of instructions) and compiles each to x86-64 code, or, on other hosts, calls the handlers for a whole block at a time
+
+	*/
+
+	SWITCH_DISPATCH,
+	THREADED_DISPATCH,
+	BLOCK_DISPATCH
+};
+
+
+enum RunStatus {
+	/*
+
+	Why run_for(...) or run_until(...) returned:
+		RUN_HALTED	-	the program set the H flag; it has finished
+		RUN_BUDGET_EXHAUSTED	-	the program ran out of instructions (or time) before it finished; calling run_for or run_until again resumes it
+		RUN_TRAPPED	-	the program generated a signal it did not handle (e.g., SINSIGSEGV) and cannot continue; see get_trap_message()
+
+	*/
+
+	RUN_HALTED,
+	RUN_BUDGET_EXHAUSTED,
+	RUN_TRAPPED
+};
+
+
 class SINVM
 {
+	// the instruction handlers need access to the VM's internals
+	friend struct InstructionHandlers;
+	friend struct FusedHandlers;
+	friend class BlockCompiler;
 
-	// the VM's word size
-	const uint8_t _WORDSIZE = 16;
-	uint16_t _DB_START;
+	// the VM's word size; see SIN_WORDSIZE in VMMemoryMap.h
+	static const uint8_t _WORDSIZE = SIN_WORDSIZE;
+	typedef wordaccess::word_type<_WORDSIZE>::type word_t;	// the type of the registers, addresses, and words in memory
+	word_t _DB_START;
 
 	// the VM will contain an ALU instance
 	ALU alu;	// todo: allocate alu and fpu on heap?
 	FPU fpu;
 
 	// create objects for our program counter and stack pointer
-	uint16_t PC;	// points to the memory address in the VM containing the next byte we want
-	uint16_t SP;	// points to the next byte to be written in the stack
-	uint16_t CALL_SP;	// the call stack pointer -- return addresses are not held on the regular stack; modified only by JSR and RTS
+	word_t PC;	// points to the memory address in the VM containing the next byte we want
+	word_t SP;	// points to the next byte to be written in the stack
+	word_t CALL_SP;	// the call stack pointer -- return addresses are not held on the regular stack; modified only by JSR and RTS
 
 	// create objects for our registers
-	uint16_t REG_A;
-	uint16_t REG_B;
-	uint16_t REG_X;
-	uint16_t REG_Y;
+	word_t REG_A;
+	word_t REG_B;
+	word_t REG_X;
+	word_t REG_Y;
 
 	uint16_t STATUS;	// a register to our status information
+	LazyFlags flags;	// the N, V, Z, and C flags from the last arithmetic or comparison, if they have not been written to STATUS yet
+
+	/*
 
-	// create an array to hold our program memory
-	uint8_t memory[memory_size];
+	The VM's memory, as a table of 256-byte pages.
+	Pages start out shared -- with the other VMs running the same ProgramImage for pages in the program, or with every VM for pages outside of it -- and the VM only gets its own copy of a page when it first writes to it (see ProgramImage.h).
+	All reads go through read_pages; all writes go through write_pages, copying the page first if the VM doesn't own it yet. No page is ever written through read_pages.
+	The tables are split into tables of 256 pages, which are shared with the ProgramImage in the same way; see PagePermissions.h. Use get_read_page(...) and friends rather than indexing them directly.
+	Every program writes to the first table's pages (the stacks are there), so the VM always has its own copy of the first table, which it keeps in first_read_pages and friends. These are checked before the directory; in the 16-bit VM, every page is in the first table, so the directory isn't looked at at all.
 
-	// create a list to hold our DynamicObjects
-	std::list<DynamicObject> dynamic_objects;
+	*/
+
+	static const size_t num_page_tables = memory_size >> pagepermission::table_shift;
+	std::shared_ptr<const ProgramImage> program;
+	const uint8_t* const* read_pages[num_page_tables];	// where each page is read from
+	uint8_t* const* write_pages[num_page_tables];	// the VM's own copy of each page, or nullptr if it hasn't written to the page
+	const uint8_t** own_read_tables[num_page_tables];	// the VM's own copies of the tables, or nullptr while it shares the image's
+	uint8_t** own_write_tables[num_page_tables];
+	const uint8_t* first_read_pages[pagepermission::table_size];
+	uint8_t* first_write_pages[pagepermission::table_size];
+	std::vector<uint8_t*> free_pages;	// copies released by reset() that may be reused
+	std::vector<size_t> written_pages;	// the pages the VM has its own copies of, i.e., those whose write_pages entry isn't nullptr; reset() only has to look at these
+
+	SIN_FORCE_INLINE const uint8_t* get_read_page(size_t page) {
+#if SIN_WORDSIZE == 32
+		if (SIN_LIKELY(page < pagepermission::table_size)) {
+			return this->first_read_pages[page];
+		}
+		return this->read_pages[page >> pagepermission::table_page_shift][page & (pagepermission::table_size - 1)];
+#else
+		return this->first_read_pages[page];
+#endif
+	}
+	SIN_FORCE_INLINE uint8_t* get_write_page(size_t page) {
+#if SIN_WORDSIZE == 32
+		if (SIN_LIKELY(page < pagepermission::table_size)) {
+			return this->first_write_pages[page];
+		}
+		return this->write_pages[page >> pagepermission::table_page_shift][page & (pagepermission::table_size - 1)];
+#else
+		return this->first_write_pages[page];
+#endif
+	}
+	void set_read_page(size_t page, const uint8_t* data);	// point a page somewhere else, e.g. at a file or bank shown in a window
+	void set_write_page(size_t page, uint8_t* data);
+	uint8_t* copy_page(size_t page);	// give the VM its own copy of a page
+	void release_page(size_t page);	// give up the VM's copy of a page, keeping it for reuse; the caller must point read_pages somewhere else
+	word_t read_word_across_pages(word_t address);
+	void write_word_across_pages(word_t address, word_t value);
+
+	// the objects allocated on the heap
+	HeapAllocator heap;
+
+	// a program that asks for handles (MEMHANDLES) reaches its objects through them, and only then may the heap be compacted; see HeapAllocator.h
+	bool using_heap_handles;
+	bool compacting_heap;	// whether the host allows compaction; see enable_heap_compaction()
+	std::map<word_t, word_t> heap_handles;	// maps each handle in use to the address of its object
+	std::vector<word_t> free_handles;	// the handles that aren't in use; the next one is taken from the back
+	bool allocate_heap_object(word_t size, word_t& address);	// allocate, compacting the heap first if the object doesn't fit and compaction is enabled
+	void compact_heap();
+	void check_heap_mode();	// refuse to touch the heap if compaction is enabled, but the program uses addresses
+
+	// the files the program has opened; the descriptor for files[i] is i + 1. See FileIO.h
+	VMFile* files[fileio::max_files];
+	word_t mapped_descriptor;	// the file shown in the file window, or 0 if none is
+	std::string file_root;	// the host directory the program's file names are relative to; empty if the program may not open files. See set_file_root()
+	bool get_file_path(std::string name, std::string& path);	// turn a name given by the program into a path inside file_root; false if the name is absolute or leaves it
+	VMFile* get_file(word_t descriptor);	// the open file with the descriptor, or nullptr if there isn't one
+	void unmap_file_window();
+	void close_files();
+
+	// the bank shown in the bank window, or 0 if the window shows conventional memory; see ProgramImage.h
+	word_t selected_bank;
+	std::vector<const DecodedInstruction*> bank_decode_caches;	// the decode cache for the window while each bank is selected, shared through the ProgramImage; nullptr until code in the bank is fetched
+	bool select_bank(word_t bank);	// returns false if the program has no such bank
+	word_t get_bank(word_t address) {
+		// the bank the address is in, given the bank that is selected
+		return ((this->selected_bank != 0) && (address >= _BANK_WINDOW_START) && (address <= _BANK_WINDOW_END)) ? this->selected_bank : 0;
+	}
+	void decode_in_bank(word_t bank, word_t address, DecodedInstruction& instruction);
+
+	// the streams used by the I/O syscalls (and BRK); std::cin and std::cout unless set_io(...) is called
+	// output is buffered, and only flushed when the program stops, returns control to the host, or reads input; see OutputBuffer.h
+	std::istream* input;
+	OutputBuffer output;
 
 	// send a processor signal
 	void send_signal(uint8_t sig);
@@ -65,53 +217,394 @@ class SINVM
 	// check whether a memory address is legal
 	static const bool address_is_valid(size_t address, bool privileged = false);
 
-	// read a value in memory
-	uint16_t get_data_of_wordsize();
-	std::vector<uint8_t> get_properly_ordered_bytes(uint16_t value);
+	// the permissions for each page of memory, in tables shared with the ProgramImage like the ones above; see PagePermissions.h
+	const uint8_t* page_permissions[num_page_tables];
+	uint8_t* own_permission_tables[num_page_tables];
+	uint8_t first_page_permissions[pagepermission::table_size];
+	SIN_FORCE_INLINE uint8_t get_page_permissions(size_t page) {
+#if SIN_WORDSIZE == 32
+		if (SIN_LIKELY(page < pagepermission::table_size)) {
+			return this->first_page_permissions[page];
+		}
+		return this->page_permissions[page >> pagepermission::table_page_shift][page & (pagepermission::table_size - 1)];
+#else
+		return this->first_page_permissions[page];
+#endif
+	}
+	void set_page_permissions(size_t page, uint8_t permissions);
+	void share_page_tables();	// point every table but the first at the image's
+
+	// check whether the program may access 'num_bytes' bytes at 'address' in the way given by 'permission'
+	SIN_FORCE_INLINE bool access_is_valid(word_t address, uint8_t permission, size_t num_bytes) {
+		// a 32-bit address may lie past the end of memory
+		if (address >= memory_size) {
+			return false;
+		}
+
+		uint8_t page = this->get_page_permissions(address >> pagepermission::page_shift);
+		if (!(page & permission) || ((page & pagepermission::guarded) && !address_is_valid(address))) {
+			return false;
+		}
+
+		// if the access runs past the end of the page, it must be allowed on the next one, too
+		size_t last = (size_t)address + num_bytes - 1;
+		if ((last >> pagepermission::page_shift) != (address >> pagepermission::page_shift)) {
+			return (last < memory_size) && (this->get_page_permissions(last >> pagepermission::page_shift) & permission);
+		}
+
+		return true;
+	}
+
+	bool range_is_valid(word_t address, uint8_t permission, size_t num_bytes);	// like access_is_valid(...), but for any number of pages; a range may not wrap around the end of memory
+
+	// read and write single bytes; the caller is responsible for checking the address
+	// addresses past the end of memory wrap around to the start of it, as a 16-bit address does in a 16-bit VM
+	SIN_FORCE_INLINE uint8_t read_byte(word_t address) {
+		address &= _MEMORY_MAX;
+		return this->get_read_page(address >> pagepermission::page_shift)[address & (pagepermission::page_size - 1)];
+	}
+	SIN_FORCE_INLINE void write_byte(word_t address, uint8_t value) {
+		address &= _MEMORY_MAX;
+		uint8_t* page = this->get_write_page(address >> pagepermission::page_shift);
+		if (page == nullptr) {
+			page = this->copy_page(address >> pagepermission::page_shift);
+		}
+		page[address & (pagepermission::page_size - 1)] = value;
+	}
+
+	// read and write the big-endian word at 'address'; the caller is responsible for checking the address
+	SIN_FORCE_INLINE word_t read_word(word_t address) {
+		address &= _MEMORY_MAX;
+		size_t offset = address & (pagepermission::page_size - 1);
+		if (offset <= pagepermission::page_size - sizeof(word_t)) {
+			return wordaccess::load<_WORDSIZE>(&this->get_read_page(address >> pagepermission::page_shift)[offset]);
+		}
+		else {
+			return this->read_word_across_pages(address);
+		}
+	}
+	SIN_FORCE_INLINE void write_word(word_t address, word_t value) {
+		address &= _MEMORY_MAX;
+		size_t offset = address & (pagepermission::page_size - 1);
+		if (offset <= pagepermission::page_size - sizeof(word_t)) {
+			uint8_t* page = this->get_write_page(address >> pagepermission::page_shift);
+			if (page == nullptr) {
+				page = this->copy_page(address >> pagepermission::page_shift);
+			}
+			wordaccess::store<_WORDSIZE>(&page[offset], value);
+		}
+		else {
+			this->write_word_across_pages(address, value);
+		}
+	}
+
+	// the decode cache; one entry for each byte of the program, starting at _PRG_BOTTOM, in pages that line up with memory's
+	// like memory, each page points into the ProgramImage until the program writes over code in it, when the VM gets its own copy; see DecodeCache.cpp
+	static const size_t decode_cache_pages = (_PRG_TOP + 1 - _PRG_BOTTOM) >> pagepermission::page_shift;
+	const DecodedInstruction* decode_pages[decode_cache_pages];	// where each page of entries is read from
+	DecodedInstruction* own_decode_pages[decode_cache_pages];	// the VM's own copy of each page, or nullptr if it shares the image's
+	std::vector<DecodedInstruction*> free_decode_pages;	// copies released by reset() or rebuild_caches(), to be reused
+	const DecodedInstruction* shared_decode_cache;	// the ProgramImage's decoded program, which the shared pages point into
+	const DecodedInstruction* unwritten_decode_cache;	// the same, until the VM gets its own copy of any page, and then nullptr; lets the fetch skip the page table in the common case
+	size_t decode_cache_size;	// the number of entries in the cache, i.e., the size of the program
+	DecodedInstruction uncached_instruction;	// holds instructions fetched from outside the cached range
 
-	// execute a single instruction
-	void execute_instruction(uint16_t opcode);
+	static uint8_t get_instruction_format(uint8_t opcode);
+	void decode_instruction(word_t address, DecodedInstruction& instruction);
+	void decode_image(word_t bank, word_t start, std::vector<DecodedInstruction>& decoded);	// decode the program as it was loaded, rather than as it is in memory
+	const DecodedInstruction* get_decoded_program();
+	const DecodedInstruction* get_decoded_bank(word_t bank);
+	DecodedInstruction* copy_decode_page(size_t page);	// give the VM its own copy of a page of the cache
+	void release_decode_pages();
+	void build_decode_cache();
+	// get the decoded instruction at the PC; the common case, a valid entry in the program's cache, is inlined into the dispatch loops
+	SIN_FORCE_INLINE const DecodedInstruction& fetch_instruction() {
+		return this->fetch_instruction(this->PC);
+	}
+	// the same, for a loop that keeps its own copy of the PC; 'pc' must be equal to this->PC
+	SIN_FORCE_INLINE const DecodedInstruction& fetch_instruction(word_t pc) {
+		size_t index = (size_t)pc - _PRG_BOTTOM;	// will wrap around (and fail the check below) if the PC is below the program
+		if (index < this->decode_cache_size) {
+			const DecodedInstruction& cached = (this->unwritten_decode_cache != nullptr) ? this->unwritten_decode_cache[index] : this->decode_pages[index >> pagepermission::page_shift][index & (pagepermission::page_size - 1)];
+			if (cached.valid) {
+				return cached;
+			}
+		}
+		return this->fetch_uncached_instruction();
+	}
+	const DecodedInstruction& fetch_uncached_instruction();	// everything else: stale entries, code in a bank, and code outside of the program
+	// must be called whenever the program writes to memory; most writes are to variables and the stacks, below the program, and return without leaving this check
+	SIN_FORCE_INLINE void invalidate_decode_cache(size_t address, size_t num_bytes) {
+		if ((address + num_bytes > _PRG_BOTTOM) && (address < _PRG_BOTTOM + this->decode_cache_size)) {
+			this->invalidate_decoded_range(address, num_bytes);
+		}
+	}
+	void invalidate_decoded_range(size_t address, size_t num_bytes);
+
+	// get the handler that executes an instruction
+	static InstructionHandler get_instruction_handler(uint8_t opcode, uint8_t addressing_mode);
+
+	// the number of cycles executed since the program was loaded; see CycleCosts.h
+	uint64_t cycles;
+	static uint16_t get_cycle_cost(uint8_t opcode, uint8_t addressing_mode, uint8_t length);
+
+	// the dispatch loops used by run_program(); each executes at most 'budget' instructions, decrementing it as it goes
+	// the loops count instructions and cycles in a DispatchCounters, which the compiler may keep in registers; the counts are written back to the VM when the loop returns or throws, and flush() must be called before any instruction that reads the cycle count (i.e., SYSCALL)
+	struct DispatchCounters {
+		SINVM& vm;
+		int64_t& budget;
+		int64_t remaining;	// what is left of the budget
+		uint64_t cycles;	// the cycles executed since the last flush
+
+		void flush() {
+			this->vm.cycles += this->cycles;
+			this->cycles = 0;
+		}
+
+		DispatchCounters(SINVM& vm, int64_t& budget) : vm(vm), budget(budget), remaining(budget), cycles(0) {}
+		~DispatchCounters() {
+			this->flush();
+			this->budget = this->remaining;
+		}
+	};
+	DispatchMode dispatch_mode;
+	void dispatch(int64_t& budget);
+	void run_switch_dispatch(int64_t& budget);
+	void run_threaded_dispatch(int64_t& budget);
+#if defined(SIN_DIRECT_THREADING)
+	typedef const void* ThreadedTargets[threadedslot::num_rows][threadedslot::num_slots];	// the code that executes each instruction; see run_threaded_code(...)
+	void run_threaded_code(int64_t& budget, const ThreadedTargets** targets_out);
+	const ThreadedTargets* get_threaded_targets();
+	const void* get_threaded_target(const DecodedInstruction& instruction);
+#endif
+	void run_block_dispatch(int64_t& budget);
+	void run_instrumented_dispatch(int64_t& budget);	// used in every mode when profiling or tracing is enabled
+
+	// whether the program has been stopped by a signal it didn't handle, and the error it generated
+	bool trapped;
+	std::string trap_message;
+
+	// the block cache; one entry for each byte of the program, indexed by the address at which the block begins
+	std::vector<DecodedBlock> block_cache;
+	std::vector<bool> block_coverage;	// whether each byte of the program is part of a cached block
+
+	static bool ends_block(uint8_t opcode);
+	void decode_block(word_t address, DecodedBlock& block);
+	void execute_block(DecodedBlock& block, int64_t& budget);
+	void invalidate_block_cache(size_t address, size_t num_bytes);
+#if defined(SIN_BLOCK_COMPILER)
+	BlockCompiler block_compiler;
+	int64_t block_budget;	// the budget while a compiled block runs, where the compiled code can find it
+	std::exception_ptr block_exception;	// what a handler called by a compiled block threw; see call_block_handler(...)
+	static bool call_block_handler(SINVM* vm, const DecodedInstruction* instruction);
+	void compile_block(DecodedBlock& block);
+	void run_compiled_block(DecodedBlock& block, int64_t& budget);
+#endif
+
+	// superinstruction fusion; see Fusion.h
+	FusionStatistics fusion_statistics;
+	void fuse_instruction(word_t address, DecodedInstruction& instruction);
+	void count_fusion(const DecodedInstruction& instruction);
+	bool uses_fusion();	// whether the dispatch loop in use can execute fused instructions
+	void rebuild_caches();	// decode the program again, e.g. because fusion was switched on or off
+
+	// the execution profiler; nullptr unless enable_profiling() has been called
+	Profiler* profiler;
+
+	// the execution trace; nullptr unless enable_tracing(...) has been called
+	ExecutionTrace* trace;
+	std::string trace_file_name;	// where the trace is written if the program fails
+	void write_trace();
 
 	// instruction-specific load/store functions
-	uint16_t execute_load();
-	void execute_store(uint16_t reg_to_store);
+	word_t execute_load(const DecodedInstruction& instruction);
+	void execute_store(word_t reg_to_store, const DecodedInstruction& instruction);
+
+	// load/store functions specialized for a single addressing mode; see SpecializedAccess.h
+	template<uint8_t mode> word_t load_operand(const DecodedInstruction& instruction);
+	template<uint8_t mode> void store_operand(word_t reg_to_store, const DecodedInstruction& instruction);
 
-	// generic load/store functions
-	uint16_t get_data_from_memory(uint16_t address, bool is_short = false);
-	void store_in_memory(uint16_t address, uint16_t new_value, bool is_short = false);
+	// generic load/store functions; every operand in memory goes through these, so they are inline, leaving only the signal out of line
+	SIN_FORCE_INLINE word_t get_data_from_memory(word_t address, bool is_short = false) {
+		// read a word (or a byte, with short addressing) from memory; unlike execute_load(), the addressing mode is not taken into consideration
+		if (this->access_is_valid(address, pagepermission::read, is_short ? 1 : (this->_WORDSIZE / 8))) {
+			return is_short ? this->read_byte(address) : this->read_word(address);
+		}
 
-	void execute_bitshift(uint16_t opcode);
+		// if we have an invalid memory address, we have an access violation
+		this->send_signal(SINSIGSEGV);
+		return wordaccess::word_max;
+	}
+	SIN_FORCE_INLINE void store_in_memory(word_t address, word_t new_value, bool is_short = false) {
+		// store a word (or, with short addressing, its low byte) in memory in big-endian format
+		if (this->access_is_valid(address, pagepermission::write, is_short ? 1 : (this->_WORDSIZE / 8))) {
+			if (is_short) {
+				this->write_byte(address, new_value & 0xFF);
+			}
+			else {
+				this->write_word(address, new_value);
+			}
 
-	void execute_comparison(uint16_t reg_to_compare);
-	void execute_jmp();
+			// if we wrote over any instructions, their decoded forms are stale
+			this->invalidate_decode_cache(address, is_short ? 1 : (this->_WORDSIZE / 8));
+		}
+		else {
+			this->send_signal(SINSIGSEGV);
+		}
+	}
 
-	void execute_syscall();
+	void execute_bitshift(const DecodedInstruction& instruction);
 
-	// stack functions
-	void push_stack(uint16_t reg_to_push);
-	uint16_t pop_stack();
+	void execute_comparison(word_t reg_to_compare, const DecodedInstruction& instruction);
+	SIN_FORCE_INLINE void compare_values(word_t reg_to_compare, word_t to_compare) {
+		// set the flags for a comparison; Z is set if the values are equal, and C if the register is greater; see PendingFlags::apply(...)
+		this->flags.record(flagoperation::compare, reg_to_compare, to_compare, 0);
+	}
+	void execute_jmp(const DecodedInstruction& instruction);
 
-	void push_call_stack(uint16_t to_push);
-	uint16_t pop_call_stack();
+	void execute_syscall(const DecodedInstruction& instruction);
+
+	// stack functions; PHA and PLA are common enough that the regular stack's are inline
+	SIN_FORCE_INLINE void push_stack(word_t reg_to_push) {
+		// push the value onto the stack, decrementing the SP (because the stack grows downwards); the word is stored big-endian, with its last byte at the SP
+		if (this->SP > _STACK_BOTTOM) {
+			this->SP -= (this->_WORDSIZE / 8);
+			this->write_word(this->SP + 1, reg_to_push);
+		}
+		else {
+			this->send_signal(SINSIGSTKFLT);
+		}
+	}
+	SIN_FORCE_INLINE word_t pop_stack() {
+		// first, make sure we aren't going to have an underflow
+		if (this->SP < _STACK) {
+			word_t popped_value = this->read_word(this->SP + 1);
+			this->SP += (this->_WORDSIZE / 8);
+			return popped_value;
+		}
+		else {
+			this->send_signal(SINSIGSTKFLT);
+			return static_cast<word_t>(SINSIGSTKFLT);
+		}
+	}
+
+	void push_call_stack(word_t to_push);
+	word_t pop_call_stack();
 
 	// syscall utility
 	void free_heap_memory();
 	void allocate_heap_memory();
 	void reallocate_heap_memory(bool error_if_not_found = true);
+	void use_heap_handles();
+
+	// block transfer instructions
+	void move_memory();
+	void fill_memory();
+
+	// vector instructions
+	void execute_vector_operation(uint8_t opcode);
+	void sum_vector();
+
+	void open_file(bool writable);
+	void close_file();
+	void read_file();
+	void write_file();
+	void seek_file();
+	void map_file();
+
+	void bank_select();
+	void far_call();
+	void far_return();
 
 	// status flag utility
-	void set_status_flag(char flag); // set the status flag whose abbreviation is equal to the character 'flag'
-	void clear_status_flag(char flag);	// clear the status flag whose abbreviation is equal to the character 'flag'
+	// every branch tests a flag, so these are inline; 'flag' is always a constant, so the lookup in get_flag_bit folds away
+	SIN_FORCE_INLINE static uint8_t get_flag_bit(char flag) {
+		// returns the bit in the status register for the flag whose abbreviation is equal to 'flag'
+		switch (flag) {
+			case 'N': return StatusConstants::negative;
+			case 'V': return StatusConstants::overflow;
+			case 'U': return StatusConstants::undefined;
+			case 'H': return StatusConstants::halt;
+			case 'I': return StatusConstants::interrupt;
+			case 'F': return StatusConstants::floating_point;
+			case 'Z': return StatusConstants::zero;
+			case 'C': return StatusConstants::carry;
+			default:
+				invalid_flag(flag);	// throw an exception if we call the function with an invalid flag
+		}
+	}
+	[[noreturn]] static void invalid_flag(char flag);	// out of line, so the throw doesn't keep the flag functions from being inlined
+	SIN_FORCE_INLINE void set_status_flag(char flag) {
+		// sets the flag equal to 'flag' in the status register
+		uint8_t bit = get_flag_bit(flag);
+
+		// if the flag may be pending, the pending flags must be written first so they don't overwrite this one later
+		if (bit & flagoperation::lazy_flags) {
+			this->flags.resolve();
+		}
+
+		this->STATUS |= bit;
+	}
+	SIN_FORCE_INLINE void clear_status_flag(char flag) {
+		// clears the flag equal to 'flag' in the status register
+		uint8_t bit = get_flag_bit(flag);
+
+		if (bit & flagoperation::lazy_flags) {
+			this->flags.resolve();
+		}
+
+		this->STATUS = this->STATUS & (255 - bit);
+	}
+	SIN_FORCE_INLINE bool is_flag_set(char flag) {
+		// tells us if a specific flag is set; N, V, Z, and C may not have been computed yet, but a single flag can be tested without resolving the others
+		uint8_t bit = get_flag_bit(flag);
+
+		if (bit & flagoperation::lazy_flags) {
+			return this->flags.test(bit);
+		}
+
+		return this->STATUS & bit;
+	}
 	uint8_t get_processor_status();	// return the status register
-	bool is_flag_set(char flag);	// tells us if a specific flag is set
+	SIN_FORCE_INLINE bool is_halted() { return this->STATUS & StatusConstants::halt; }	// checked after every instruction, so it skips the lookup in is_flag_set; H is never pending
+
+	// loading utility
+	void initialize(std::shared_ptr<const ProgramImage> program);	// set up the VM to run 'program'; used by every constructor
+	void reset_processor();	// return the registers, stacks, and heap to their initial states; used by RESET and reset()
 public:
 	// entry function for the VM -- execute a program
 	void run_program();
 
+	// run the program for a limited time, so that the host may do something else (e.g., run another VM) before resuming it
+	RunStatus run_for(uint64_t num_instructions);	// execute about 'num_instructions' instructions; a fused instruction may take the VM a few past the budget
+	RunStatus run_until(std::chrono::steady_clock::time_point deadline);	// execute instructions until the deadline passes
+	std::string get_trap_message();	// the error that stopped the program, if run_for or run_until returned RUN_TRAPPED
+	uint64_t get_cycle_count();	// the number of cycles the program has executed; see CycleCosts.h
+	void set_dispatch_mode(DispatchMode mode);	// select the dispatch loop run_program() will use
+	void set_io(std::istream& input, std::ostream& output);	// redirect the program's standard input and output
+	void set_output_buffer_size(size_t size);	// the number of characters of output held before they are written; 0 writes every character as soon as it is output
+
 	void _debug_values();	// for debug -- print values to screen
+	void _fusion_report();	// print how much of the program was fused into superinstructions
+
+	void enable_profiling();	// count every instruction the program executes from now on; see Profiler.h
+	void load_symbol_map(std::istream& map_file);	// name the functions in the profile report using a map written by the linker
+	void _profile_report(std::ostream& output, size_t num_addresses = 20);	// print the profile, including the 'num_addresses' most-executed addresses
+	void write_folded_stacks(std::ostream& output);	// write the profile's call paths for a flamegraph; see Profiler.h
+
+	void set_file_root(std::string root);	// allow the program to open files in the directory 'root' (and its subdirectories); until this is called, the file syscalls generate SINSIGSYS
+	void enable_heap_compaction();	// allow objects to be moved when the heap is fragmented; only for programs that use handles (MEMHANDLES). Must be called before the program runs
+	void _heap_report();	// print how the heap is being used
+
+	void enable_tracing(std::string file_name, size_t num_records = exectrace::default_records);	// record the last 'num_records' instructions, writing them to 'file_name' if the program fails; see ExecutionTrace.h
 
 	// constructor/destructor
-	SINVM(std::istream& file);	// if we have a .sinc file we want to load
+	SINVM(std::istream& file);	// if we have a .sml file we want to load
+	SINVM(const uint8_t* image, size_t image_size);	// if the .sml file has already been read into memory
+	SINVM(std::shared_ptr<const ProgramImage> program);	// to share a program image with other VMs
+	SINVM(const SINVM&) = delete;	// the VM owns its copies of pages, so it may not be copied
+
+	void reset();	// return the VM to the state it was in when the program was loaded; see SINVMPool
 	~SINVM();
 };
 
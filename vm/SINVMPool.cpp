@@ -0,0 +1,67 @@
+/*
+
+SIN Toolchain
+SINVMPool.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the SINVMPool class.
+
+*/
+
+#include "SINVMPool.h"
+
+
+SINVM* SINVMPool::acquire() {
+	// reuse an instance if we have one; otherwise, load a new one from the image
+	if (!this->available.empty()) {
+		SINVM* vm = this->available.back();
+		this->available.pop_back();
+		return vm;
+	}
+	else {
+		SINVM* vm = new SINVM(this->program);
+		vm->set_dispatch_mode(this->dispatch_mode);
+		return vm;
+	}
+}
+
+void SINVMPool::release(SINVM* vm) {
+	// the VM may have been halted by an exception partway through the program, but reset() doesn't care how the program ended
+	vm->reset();
+	this->available.push_back(vm);
+}
+
+size_t SINVMPool::get_available_count() {
+	return this->available.size();
+}
+
+
+SINVMPool::SINVMPool(std::istream& file, DispatchMode dispatch_mode) :
+	program(std::make_shared<const ProgramImage>(file)),
+	dispatch_mode(dispatch_mode)
+{
+	// load the first instance now so that an image the VM can't run (e.g., one with the wrong wordsize) is reported here, rather than on the first call to acquire()
+	this->available.push_back(this->acquire());
+}
+
+SINVMPool::SINVMPool(const uint8_t* image, size_t image_size, DispatchMode dispatch_mode) :
+	program(std::make_shared<const ProgramImage>(image, image_size)),
+	dispatch_mode(dispatch_mode)
+{
+	this->available.push_back(this->acquire());
+}
+
+SINVMPool::SINVMPool(std::shared_ptr<const ProgramImage> program, DispatchMode dispatch_mode) :
+	program(program),
+	dispatch_mode(dispatch_mode)
+{
+	this->available.push_back(this->acquire());
+}
+
+SINVMPool::~SINVMPool()
+{
+	// instances that are still checked out belong to the caller
+	for (std::vector<SINVM*>::iterator it = this->available.begin(); it != this->available.end(); it++) {
+		delete *it;
+	}
+}
@@ -0,0 +1,38 @@
+/*
+
+SIN Toolchain
+SINVMPool.h
+Copyright 2019 Riley Lannon
+
+Contains the definition of the SINVMPool class, which hands out VM instances that all run the same program.
+
+The pool loads the .sml file into a single ProgramImage, so the file only needs to be read once, and every instance shares the image's pages until it writes to them (see ProgramImage.h). Instances are created the first time they are needed; when one is released, it is reset (see SINVM::reset()) and kept for the next caller rather than deleted. Resetting an instance only releases the pages its program wrote to, which is much cheaper than creating a new VM for every run.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <istream>
+#include <cinttypes>
+
+#include "SINVM.h"
+
+
+class SINVMPool
+{
+	std::shared_ptr<const ProgramImage> program;	// the program every instance runs
+	std::vector<SINVM*> available;	// instances that have been reset and are ready to be handed out
+	DispatchMode dispatch_mode;	// the dispatch mode for every instance in the pool
+public:
+	SINVM* acquire();	// get a VM that is ready to run the program from the start
+	void release(SINVM* vm);	// reset the VM and return it to the pool; the caller must not use it afterwards
+
+	size_t get_available_count();	// the number of instances waiting in the pool
+
+	SINVMPool(std::istream& file, DispatchMode dispatch_mode = SWITCH_DISPATCH);
+	SINVMPool(const uint8_t* image, size_t image_size, DispatchMode dispatch_mode = SWITCH_DISPATCH);
+	SINVMPool(std::shared_ptr<const ProgramImage> program, DispatchMode dispatch_mode = SWITCH_DISPATCH);
+	~SINVMPool();
+};
@@ -0,0 +1,133 @@
+/*
+
+SIN Toolchain
+SpecializedAccess.h
+Copyright 2019 Riley Lannon
+
+Contains the implementations of SINVM::load_operand<mode>(...) and SINVM::store_operand<mode>(...), the addressing-mode-specialized versions of execute_load(...) and execute_store(...).
+Because the mode is a template parameter, every check on it below is a constant; each instantiation reduces to the few memory accesses its mode needs, with no branching on the mode at runtime.
+
+Modes not handled here (e.g., indirect, or a store with immediate addressing) fall back to execute_load/execute_store, which generate a SINSIGILL signal for them. get_instruction_handler(...) never picks an instantiation for such a mode; it uses a handler that generates the signal itself. The operandmode::generic instantiation is used wherever the mode is not known ahead of time (i.e., by the switch dispatch loop); it tests for the common modes, going to their instantiations, and falls back for the rest.
+
+These are only instantiated by the instruction handlers in ExecuteInstruction.cpp.
+
+*/
+
+#pragma once
+
+#include "SINVM.h"
+
+namespace operandmode {
+	// not a real addressing mode; selects the instantiation that reads the mode from the instruction at runtime
+	const uint8_t generic = 0xFF;
+}
+
+
+template<uint8_t mode>
+SIN_FORCE_INLINE SINVM::word_t SINVM::load_operand(const DecodedInstruction& instruction) {
+	const bool is_short = (mode != operandmode::generic) && (mode >= addressingmode::absolute_short);
+	const uint8_t base_mode = is_short ? (mode - addressingmode::absolute_short) : mode;
+
+	if (mode == operandmode::generic) {
+		// the common modes go to their own instantiations; anything else is left to execute_load
+		// this is a chain of tests, most common mode first, rather than a switch, which the compiler would turn into a second indirect jump in every instruction
+		uint8_t runtime_mode = instruction.addressing_mode;
+		if (runtime_mode == addressingmode::immediate) {
+			return instruction.operand;
+		}
+		else if (runtime_mode == addressingmode::absolute) {
+			return this->load_operand<addressingmode::absolute>(instruction);
+		}
+		else if (runtime_mode == addressingmode::x_index) {
+			return this->load_operand<addressingmode::x_index>(instruction);
+		}
+		else if (runtime_mode == addressingmode::y_index) {
+			return this->load_operand<addressingmode::y_index>(instruction);
+		}
+		else if (runtime_mode == addressingmode::reg_b) {
+			return this->REG_B;
+		}
+		else {
+			return this->execute_load(instruction);
+		}
+	}
+	else if (mode == addressingmode::reg_b) {
+		return this->REG_B;
+	}
+	else if (base_mode == addressingmode::immediate) {
+		return instruction.operand;
+	}
+	else if (base_mode == addressingmode::absolute) {
+		return this->get_data_from_memory(instruction.operand, is_short);
+	}
+	else if (base_mode == addressingmode::x_index) {
+		return this->get_data_from_memory(instruction.operand + this->REG_X, is_short);
+	}
+	else if (base_mode == addressingmode::y_index) {
+		return this->get_data_from_memory(instruction.operand + this->REG_Y, is_short);
+	}
+	else if (base_mode == addressingmode::indirect_indexed_x) {
+		return this->get_data_from_memory(this->get_data_from_memory(instruction.operand) + this->REG_X, is_short);
+	}
+	else if (base_mode == addressingmode::indirect_indexed_y) {
+		return this->get_data_from_memory(this->get_data_from_memory(instruction.operand) + this->REG_Y, is_short);
+	}
+	else if (base_mode == addressingmode::indexed_indirect_x) {
+		return this->get_data_from_memory(this->get_data_from_memory(instruction.operand + this->REG_X), is_short);
+	}
+	else if (base_mode == addressingmode::indexed_indirect_y) {
+		return this->get_data_from_memory(this->get_data_from_memory(instruction.operand + this->REG_Y), is_short);
+	}
+	else {
+		return this->execute_load(instruction);
+	}
+}
+
+
+template<uint8_t mode>
+SIN_FORCE_INLINE void SINVM::store_operand(word_t reg_to_store, const DecodedInstruction& instruction) {
+	const bool is_short = (mode != operandmode::generic) && (mode >= addressingmode::absolute_short);
+	const uint8_t base_mode = is_short ? (mode - addressingmode::absolute_short) : mode;
+
+	if (mode == operandmode::generic) {
+		uint8_t runtime_mode = instruction.addressing_mode;
+		if (runtime_mode == addressingmode::absolute) {
+			this->store_operand<addressingmode::absolute>(reg_to_store, instruction);
+		}
+		else if (runtime_mode == addressingmode::x_index) {
+			this->store_operand<addressingmode::x_index>(reg_to_store, instruction);
+		}
+		else if (runtime_mode == addressingmode::y_index) {
+			this->store_operand<addressingmode::y_index>(reg_to_store, instruction);
+		}
+		else {
+			this->execute_store(reg_to_store, instruction);
+		}
+	}
+	else if (base_mode == addressingmode::absolute) {
+		this->store_in_memory(instruction.operand, reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::x_index) {
+		this->store_in_memory(instruction.operand + this->REG_X, reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::y_index) {
+		this->store_in_memory(instruction.operand + this->REG_Y, reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::indirect_indexed_x) {
+		this->store_in_memory(this->get_data_from_memory(instruction.operand) + this->REG_X, reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::indirect_indexed_y) {
+		this->store_in_memory(this->get_data_from_memory(instruction.operand) + this->REG_Y, reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::indexed_indirect_x) {
+		this->store_in_memory(this->get_data_from_memory(instruction.operand + this->REG_X), reg_to_store, is_short);
+	}
+	else if (base_mode == addressingmode::indexed_indirect_y) {
+		this->store_in_memory(this->get_data_from_memory(instruction.operand + this->REG_Y), reg_to_store, is_short);
+	}
+	else {
+		this->execute_store(reg_to_store, instruction);
+	}
+
+	return;
+}
@@ -13,24 +13,31 @@ Note the SYSCALL instruction is akin to an INT instruction in Unix; it is like a
 #include "SINVM.h"
 #include "../util/SyscallConstants.h"
 
-void SINVM::execute_syscall() {
-	// get the addressing mode
-	this->PC++;
-	uint8_t addressing_mode = this->memory[this->PC];
-
-	// increment the PC to point at the data and get the syscall number
-	this->PC++;
-	uint16_t syscall_number = this->get_data_of_wordsize();
+void SINVM::execute_syscall(const DecodedInstruction& instruction) {
+	// the syscall number is the instruction's operand
+	word_t syscall_number = instruction.operand;
 
 	// TODO: implement more syscalls and split them into their own functions
-	if (syscall_number == STD_READ) {
+	if (syscall_number == STD_FILEOPEN_R) {
+		this->open_file(false);
+	}
+	else if (syscall_number == STD_FILEOPEN_w) {
+		this->open_file(true);
+	}
+	else if (syscall_number == STD_FILECLOSE) {
+		this->close_file();
+	}
+	else if (syscall_number == STD_READ) {
 		// get user input
+		// show anything the program has written first, as it is probably a prompt
+		this->output.flush();
+
 		// first, the program will look in the B register for the address where it should put the data
 		unsigned int start_address = REG_B;
 
 		// all input comes in as a string, but we want to save it as a series of bytes
 		std::string input;
-		std::getline(std::cin, input);
+		std::getline(*this->input, input);
 		input.push_back('\0');	// add a null terminator
 
 		// input will always return a series of ASCII-encoded bytes
@@ -46,59 +53,94 @@ void SINVM::execute_syscall() {
 		// the length of the input buffer is the max - min + 1, as we start at 0x00 and end at 0xFF
 		size_t buffer_length = _STRING_BUFFER_MAX - _STRING_BUFFER_START + 1;
 
-		// check to make sure the input data won't overflow the buffer
-		if (input_bytes.size() <= buffer_length) {
-			// store those bytes in memory
-			// use size() here because we want to index
-			for (size_t i = 0; i < input_bytes.size(); i++) {
-				this->memory[start_address + i] = input_bytes[i];
-			}
+		// if the data is longer than the input buffer, only copy in as many bytes as we have available in the buffer, truncating the input data; if we don't do this, the data could overflow into the stack
+		size_t num_bytes = (input_bytes.size() <= buffer_length) ? input_bytes.size() : buffer_length;
 
-			// finally, store the length of input_bytes (in bytes) in register A
-			this->REG_A = input_bytes.size();
+		// the program may only be given input where it could have stored it itself; this keeps it out of the read-only bank and file windows
+		if (!this->range_is_valid(start_address, pagepermission::write, num_bytes)) {
+			this->send_signal(SINSIGSEGV);
+			return;
 		}
-		// if the data is longer than the input buffer, only copy in as many bytes as we have available in the buffer, truncating the input data; if we don't do this, the data could overflow into the stack
-		else {
-			for (size_t i = 0; i < buffer_length; i++) {
-				this->memory[start_address + i] = input_bytes[i];
-			}
 
-			// store the length of the memory buffer in register A
-			this->REG_A = buffer_length;
+		// store those bytes in memory
+		for (size_t i = 0; i < num_bytes; i++) {
+			this->write_byte(start_address + i, input_bytes[i]);
 		}
+
+		// finally, store the number of bytes stored in register A
+		this->REG_A = num_bytes;
+
+		// the input may have been written over instructions
+		this->invalidate_decode_cache(start_address, num_bytes);
 	}
 	else if (syscall_number == STD_OUT) {
 		// If we want to print something to the screen, we must specify the address where it starts
 		// It will print a number of bytes from memory as specified by REG_A, formatted as ASCII
 		// The system will use the ASCII value corresponding to the hex value stored in memory and print that
 
+		// the string is written straight from the VM's pages, so the whole range must be readable
+		if (!this->range_is_valid(REG_B, pagepermission::read, REG_A)) {
+			this->send_signal(SINSIGSEGV);
+			return;
+		}
+
 		size_t num_bytes = REG_A;
 		// the current address from which we are reading data
-		unsigned int current_address = REG_B;
-		// the current character we are on; start at 'start_address'
-		uint8_t current_char = this->memory[current_address];
+		word_t current_address = REG_B;
+
+		// write the string straight from memory, one page at a time
+		while (num_bytes > 0) {
+			size_t offset = current_address & (pagepermission::page_size - 1);
+			size_t length = pagepermission::page_size - offset;
+			if (length > num_bytes) {
+				length = num_bytes;
+			}
 
-		std::string output_string;
+			this->output.write((const char*)&this->get_read_page(current_address >> pagepermission::page_shift)[offset], length);
 
-		for (size_t i = 0; i < num_bytes; i++) {
-			output_string.push_back(current_char);	// add the character to our output string
-			current_address++;	// increment the address by one byte
-			current_char = this->memory[current_address];	// get the next character
+			current_address += (word_t)length;
+			num_bytes -= length;
 		}
 
-		// print the string
-		std::cout << output_string << std::endl;
+		this->output.put('\n');
 	}
 	else if (syscall_number == STD_OUT_HEX) {
 		// Read out the number of bytes stored in A, starting at the address stored in B, and print them (as raw hex values) to the standard output
+		// Each byte is printed on its own line as $ followed by its hex value, without leading zeroes
+		const char hex_digits[] = "0123456789abcdef";
+
+		// read_byte(...) doesn't check the address, and would wrap a 32-bit address around to the start of memory
+		if (!this->range_is_valid(REG_B, pagepermission::read, REG_A)) {
+			this->send_signal(SINSIGSEGV);
+			return;
+		}
+
 		int num_bytes = REG_A;	// number of bytes is in A
 		int start_address = REG_B;	// start address is in B
 
 		for (int i = 0; i < num_bytes; i++) {
-			// note -- must cast to int before output -- otherwise, it will print the character, not the hex value
-			std::cout << "$" << std::hex << (int)this->memory[start_address + i] << std::endl;
+			uint8_t value = this->read_byte(start_address + i);
+
+			this->output.put('$');
+			if (value > 0x0F) {
+				this->output.put(hex_digits[value >> 4]);
+			}
+			this->output.put(hex_digits[value & 0x0F]);
+			this->output.put('\n');
 		}
 	}
+	else if (syscall_number == STD_FILEREAD) {
+		this->read_file();
+	}
+	else if (syscall_number == STD_FILEWRITE) {
+		this->write_file();
+	}
+	else if (syscall_number == STD_FILESEEK) {
+		this->seek_file();
+	}
+	else if (syscall_number == STD_FILEMAP) {
+		this->map_file();
+	}
 	else if (syscall_number == MEMFREE) {
 		this->free_heap_memory();
 	}
@@ -111,6 +153,23 @@ void SINVM::execute_syscall() {
 	else if (syscall_number == MEMREALLOC_SAFE) {
 		this->reallocate_heap_memory(false);	// reallocates heap memory, creating a new object if one isn't found
 	}
+	else if (syscall_number == MEMHANDLES) {
+		this->use_heap_handles();
+	}
+	else if (syscall_number == SYS_CYCLES) {
+		// load the low two words of the cycle count into B (high word) and A (low word)
+		this->REG_A = (word_t)this->cycles;
+		this->REG_B = (word_t)(this->cycles >> this->_WORDSIZE);
+	}
+	else if (syscall_number == SYS_BANKSELECT) {
+		this->bank_select();
+	}
+	else if (syscall_number == SYS_FARCALL) {
+		this->far_call();
+	}
+	else if (syscall_number == SYS_FARRETURN) {
+		this->far_return();
+	}
 	// if it is not a valid syscall number, generate a SINSIGSYS signal
 	else {
 		this->send_signal(SINSIGSYS);
@@ -0,0 +1,216 @@
+/*
+
+SIN Toolchain
+VectorUnit.cpp
+Copyright 2019 Riley Lannon
+
+Contains the implementation of the vector unit functions; see VectorUnit.h.
+
+*/
+
+#include "VectorUnit.h"
+#include "WordAccess.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define VECTORUNIT_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 can't be assumed, so its functions are compiled for it separately and only called if the CPU has it
+#if defined(VECTORUNIT_SSE2) && defined(_MSC_VER)
+#define VECTORUNIT_AVX2
+#define VECTORUNIT_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(VECTORUNIT_SSE2) && defined(__GNUC__)
+#define VECTORUNIT_AVX2
+#define VECTORUNIT_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+
+#ifdef VECTORUNIT_SSE2
+namespace {
+	const size_t lane_words = 8;	// the number of 16-bit words in an SSE2 register
+
+	// swap the bytes in each 16-bit lane, converting between big-endian and host order
+	inline __m128i swap_lanes(__m128i value) {
+		return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+	}
+
+	inline __m128i apply_lanes(uint8_t opcode, __m128i left, __m128i right) {
+		switch (opcode) {
+		case VADD:
+			return swap_lanes(_mm_add_epi16(swap_lanes(left), swap_lanes(right)));
+		case VSUB:
+			return swap_lanes(_mm_sub_epi16(swap_lanes(left), swap_lanes(right)));
+		case VAND:
+			return _mm_and_si128(left, right);
+		case VOR:
+			return _mm_or_si128(left, right);
+		case VXOR:
+			return _mm_xor_si128(left, right);
+		case VCMP:
+			return _mm_cmpeq_epi16(left, right);
+		default:
+			return left;
+		}
+	}
+}
+#endif
+
+
+#ifdef VECTORUNIT_AVX2
+namespace {
+	const size_t wide_lane_words = 16;	// the number of 16-bit words in an AVX2 register
+
+	bool host_has_avx2() {
+#if defined(_MSC_VER)
+		// the CPU must have AVX2, and the OS must save the YMM registers
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		if (!(info[2] & (1 << 27)) || ((_xgetbv(0) & 0x6) != 0x6)) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	const bool use_avx2 = host_has_avx2();
+
+	VECTORUNIT_AVX2_TARGET inline __m256i swap_wide_lanes(__m256i value) {
+		return _mm256_or_si256(_mm256_slli_epi16(value, 8), _mm256_srli_epi16(value, 8));
+	}
+
+	VECTORUNIT_AVX2_TARGET inline __m256i apply_wide_lanes(uint8_t opcode, __m256i left, __m256i right) {
+		switch (opcode) {
+		case VADD:
+			return swap_wide_lanes(_mm256_add_epi16(swap_wide_lanes(left), swap_wide_lanes(right)));
+		case VSUB:
+			return swap_wide_lanes(_mm256_sub_epi16(swap_wide_lanes(left), swap_wide_lanes(right)));
+		case VAND:
+			return _mm256_and_si256(left, right);
+		case VOR:
+			return _mm256_or_si256(left, right);
+		case VXOR:
+			return _mm256_xor_si256(left, right);
+		case VCMP:
+			return _mm256_cmpeq_epi16(left, right);
+		default:
+			return left;
+		}
+	}
+
+	// does as many groups of sixteen words as there are, returning the number of words done
+	VECTORUNIT_AVX2_TARGET size_t apply_wide(uint8_t opcode, uint8_t* destination, const uint8_t* source, size_t num_words) {
+		size_t i = 0;
+		for (; i + wide_lane_words <= num_words; i += wide_lane_words) {
+			__m256i left = _mm256_loadu_si256((const __m256i*)&destination[i * 2]);
+			__m256i right = _mm256_loadu_si256((const __m256i*)&source[i * 2]);
+			_mm256_storeu_si256((__m256i*)&destination[i * 2], apply_wide_lanes(opcode, left, right));
+		}
+		return i;
+	}
+
+	// adds up as many groups of sixteen words as there are into 'total', returning the number of words done
+	VECTORUNIT_AVX2_TARGET size_t sum_wide(const uint8_t* source, size_t num_words, uint16_t& total) {
+		size_t i = 0;
+		__m256i totals = _mm256_setzero_si256();
+		for (; i + wide_lane_words <= num_words; i += wide_lane_words) {
+			totals = _mm256_add_epi16(totals, swap_wide_lanes(_mm256_loadu_si256((const __m256i*)&source[i * 2])));
+		}
+
+		uint16_t lanes[wide_lane_words];
+		_mm256_storeu_si256((__m256i*)lanes, totals);
+		for (size_t lane = 0; lane < wide_lane_words; lane++) {
+			total += lanes[lane];
+		}
+		return i;
+	}
+}
+#endif
+
+
+uint16_t vectorunit::apply(uint8_t opcode, uint16_t left, uint16_t right) {
+	switch (opcode) {
+	case VADD:
+		return left + right;
+	case VSUB:
+		return left - right;
+	case VAND:
+		return left & right;
+	case VOR:
+		return left | right;
+	case VXOR:
+		return left ^ right;
+	case VCMP:
+		return (left == right) ? 0xFFFF : 0x0000;
+	default:
+		return left;
+	}
+}
+
+void vectorunit::apply(uint8_t opcode, uint8_t* destination, const uint8_t* source, size_t num_words) {
+	size_t i = 0;
+
+	// each group of words is loaded before any of it is stored, so a source after the destination is only read before it is overwritten
+#ifdef VECTORUNIT_AVX2
+	if (use_avx2) {
+		i = apply_wide(opcode, destination, source, num_words);
+	}
+#endif
+
+#ifdef VECTORUNIT_SSE2
+	for (; i + lane_words <= num_words; i += lane_words) {
+		__m128i left = _mm_loadu_si128((const __m128i*)&destination[i * 2]);
+		__m128i right = _mm_loadu_si128((const __m128i*)&source[i * 2]);
+		_mm_storeu_si128((__m128i*)&destination[i * 2], apply_lanes(opcode, left, right));
+	}
+#endif
+
+	for (; i < num_words; i++) {
+		uint16_t left = wordaccess::load<16>(&destination[i * 2]);
+		uint16_t right = wordaccess::load<16>(&source[i * 2]);
+		wordaccess::store<16>(&destination[i * 2], apply(opcode, left, right));
+	}
+}
+
+uint16_t vectorunit::sum(const uint8_t* source, size_t num_words) {
+	uint16_t total = 0;
+	size_t i = 0;
+
+#ifdef VECTORUNIT_AVX2
+	if (use_avx2 && (num_words >= wide_lane_words)) {
+		i = sum_wide(source, num_words, total);
+	}
+#endif
+
+#ifdef VECTORUNIT_SSE2
+	if (num_words - i >= lane_words) {
+		// keep eight running totals, and add them together at the end
+		__m128i totals = _mm_setzero_si128();
+		for (; i + lane_words <= num_words; i += lane_words) {
+			totals = _mm_add_epi16(totals, swap_lanes(_mm_loadu_si128((const __m128i*)&source[i * 2])));
+		}
+
+		uint16_t lanes[lane_words];
+		_mm_storeu_si128((__m128i*)lanes, totals);
+		for (size_t lane = 0; lane < lane_words; lane++) {
+			total += lanes[lane];
+		}
+	}
+#endif
+
+	for (; i < num_words; i++) {
+		total += wordaccess::load<16>(&source[i * 2]);
+	}
+
+	return total;
+}
@@ -0,0 +1,32 @@
+/*
+
+SIN Toolchain
+VectorUnit.h
+Copyright 2019 Riley Lannon
+
+Contains the functions the VM uses to carry out the vector instructions (VADD, VSUB, VAND, VOR, VXOR, VCMP, and VSUM), which work on a whole array of 16-bit words at once.
+
+The functions work on a run of words that lies within a single page of the source and destination; SINVM::execute_vector_operation() and SINVM::sum_vector() split the ranges up and deal with the permissions.
+When the host has SSE2 (any x64 host does), eight words are done at a time, with a scalar loop for whatever is left over; if the CPU also has AVX2 (checked once, when the program starts), sixteen words are done at a time before that. Words in SIN memory are big-endian, so for addition and subtraction the bytes in each lane are swapped on the way in and out; the logical operations and the comparison don't care about byte order. The result is the same either way.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cinttypes>
+
+#include "../util/OpcodeConstants.h"
+
+
+namespace vectorunit {
+	// carry out one element of the vector operation 'opcode'; 'left' is the word at the destination, 'right' the word at the source
+	uint16_t apply(uint8_t opcode, uint16_t left, uint16_t right);
+
+	// carry out the vector operation 'opcode' on 'num_words' words, storing the results over the destination
+	// the source may be the destination, or lie after it, but may not overlap the end of it
+	void apply(uint8_t opcode, uint8_t* destination, const uint8_t* source, size_t num_words);
+
+	// the sum of 'num_words' words, modulo 0x10000
+	uint16_t sum(const uint8_t* source, size_t num_words);
+}
@@ -0,0 +1,81 @@
+/*
+
+SIN Toolchain
+WordAccess.h
+Copyright 2019 Riley Lannon
+
+Contains the functions the VM uses to read and write whole words in its memory.
+
+Words in SIN memory are always big-endian. Rather than assembling a word one byte at a time, these functions copy the whole word with a single load or store and then swap its bytes if the host is little-endian; with a constant word size, the compiler reduces each of them to a load (or store) and a byteswap instruction.
+The functions are templated on the word size so that the same code serves a 16-bit VM and a 32-bit one; vm_word is the type of a word in the VM being built (see SIN_WORDSIZE in VMMemoryMap.h).
+
+*/
+
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "../util/VMMemoryMap.h"	// for SIN_WORDSIZE
+
+#if defined(_MSC_VER)
+#include <stdlib.h>	// for _byteswap_ushort and _byteswap_ulong
+#endif
+
+
+namespace wordaccess
+{
+	// the integer type that holds a word of the given size
+	template<uint8_t wordsize> struct word_type;
+	template<> struct word_type<16> { typedef uint16_t type; };
+	template<> struct word_type<32> { typedef uint32_t type; };
+
+	// the type of the VM's registers, addresses, and operands
+	typedef word_type<SIN_WORDSIZE>::type vm_word;
+
+	const vm_word word_max = (vm_word)~0;	// all bits set
+	const vm_word sign_bit = (vm_word)1 << (SIN_WORDSIZE - 1);
+
+	// reverse the order of the bytes in a value
+	inline uint16_t byteswap(uint16_t value) {
+#if defined(_MSC_VER)
+		return _byteswap_ushort(value);
+#else
+		return __builtin_bswap16(value);
+#endif
+	}
+
+	inline uint32_t byteswap(uint32_t value) {
+#if defined(_MSC_VER)
+		return _byteswap_ulong(value);
+#else
+		return __builtin_bswap32(value);
+#endif
+	}
+
+	// convert between host and big-endian byte order
+	template<typename T>
+	inline T to_big_endian(T value) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		return value;
+#else
+		return byteswap(value);
+#endif
+	}
+
+	// read the big-endian word at 'source'
+	template<uint8_t wordsize>
+	inline typename word_type<wordsize>::type load(const uint8_t* source) {
+		typename word_type<wordsize>::type value;
+		memcpy(&value, source, sizeof(value));
+		return to_big_endian(value);
+	}
+
+	// write 'value' to 'destination' as a big-endian word
+	template<uint8_t wordsize>
+	inline void store(uint8_t* destination, typename word_type<wordsize>::type value) {
+		value = to_big_endian(value);
+		memcpy(destination, &value, sizeof(value));
+	}
+}